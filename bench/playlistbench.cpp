@@ -0,0 +1,154 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+// Benchmark of playlist file parsers. Generates M3U, PLS and XSPF
+// playlists and measures ContentServer::parsePlaylistFile.
+//
+// Usage: playlistbench [entries] [runs]
+
+#include <QApplication>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QList>
+#include <algorithm>
+#include <cstdio>
+
+#include "contentserver.h"
+
+static QString entryUrl(int i)
+{
+    return QString("http://radio%1.example.org:8000/stream/%2.mp3").arg(i % 100).arg(i);
+}
+
+static QString entryTitle(int i)
+{
+    return QString("Artist %1 - Title of the track number %2").arg(i % 1000).arg(i);
+}
+
+static bool writeM3u(const QString &path, int entries)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    QTextStream s(&f);
+    s.setCodec("UTF-8");
+    s << "#EXTM3U\n";
+    for (int i = 0; i < entries; ++i) {
+        s << "#EXTINF:" << 180 + i % 120 << "," << entryTitle(i) << "\n";
+        s << entryUrl(i) << "\n";
+    }
+    return true;
+}
+
+static bool writePls(const QString &path, int entries)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    QTextStream s(&f);
+    s.setCodec("UTF-8");
+    s << "[playlist]\n";
+    for (int i = 1; i <= entries; ++i) {
+        s << "File" << i << "=" << entryUrl(i) << "\n";
+        s << "Title" << i << "=" << entryTitle(i) << "\n";
+        s << "Length" << i << "=" << 180 + i % 120 << "\n";
+    }
+    s << "NumberOfEntries=" << entries << "\n";
+    s << "Version=2\n";
+    return true;
+}
+
+static bool writeXspf(const QString &path, int entries)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    QTextStream s(&f);
+    s.setCodec("UTF-8");
+    s << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    s << "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n";
+    s << "<trackList>\n";
+    for (int i = 0; i < entries; ++i) {
+        s << "<track><location>" << entryUrl(i) << "</location>"
+          << "<title>" << entryTitle(i) << "</title>"
+          << "<duration>" << (180 + i % 120) * 1000 << "</duration></track>\n";
+    }
+    s << "</trackList>\n";
+    s << "</playlist>\n";
+    return true;
+}
+
+// Returns false when parser doesn't return all entries
+static bool bench(const QString &name, const QString &path, int entries, int runs)
+{
+    QList<qint64> times;
+    int count = 0;
+
+    for (int r = 0; r < runs; ++r) {
+        QElapsedTimer timer;
+        timer.start();
+        count = ContentServer::parsePlaylistFile(path).size();
+        times << timer.elapsed();
+    }
+
+    std::sort(times.begin(), times.end());
+
+    std::printf("%-5s entries: %d/%d, min: %lld ms, median: %lld ms, max: %lld ms\n",
+                qPrintable(name), count, entries,
+                static_cast<long long>(times.first()),
+                static_cast<long long>(times.at(times.size() / 2)),
+                static_cast<long long>(times.last()));
+
+    return count == entries;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    app.setApplicationName("jupii-playlistbench");
+
+    const auto args = app.arguments();
+    const int entries = args.size() > 1 ? args.at(1).toInt() : 100000;
+    const int runs = args.size() > 2 ? args.at(2).toInt() : 5;
+
+    if (entries <= 0 || runs <= 0) {
+        std::fprintf(stderr, "Usage: playlistbench [entries] [runs]\n");
+        return 2;
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::fprintf(stderr, "Cannot create temporary dir\n");
+        return 2;
+    }
+
+    const auto m3u = dir.filePath("bench.m3u");
+    const auto pls = dir.filePath("bench.pls");
+    const auto xspf = dir.filePath("bench.xspf");
+
+    if (!writeM3u(m3u, entries) || !writePls(pls, entries) ||
+            !writeXspf(xspf, entries)) {
+        std::fprintf(stderr, "Cannot write playlist files\n");
+        return 2;
+    }
+
+    // Debug output is disabled, so it doesn't affect timings
+    qInstallMessageHandler([](QtMsgType type, const QMessageLogContext&, const QString &msg) {
+        if (type != QtDebugMsg)
+            std::fprintf(stderr, "%s\n", qPrintable(msg));
+    });
+
+    bool ok = true;
+    ok &= bench("M3U", m3u, entries, runs);
+    ok &= bench("PLS", pls, entries, runs);
+    ok &= bench("XSPF", xspf, entries, runs);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+TARGET = playlistbench
+
+TEMPLATE = app
+
+CONFIG += c++11 json no_lflags_merge object_parallel_to_source console
+CONFIG -= app_bundle
+QT += core gui widgets network dbus sql multimedia xml
+
+PROJECTDIR = $$PWD/..
+
+# Benchmark is built against desktop variant of the core
+CONFIG += desktop
+DEFINES += DESKTOP
+
+include($$PROJECTDIR/core/jupii_core.pri)
+
+# Benchmark has its own main()
+SOURCES -= $$CORE_DIR/main.cpp
+
+DESKTOP_DIR = $$PROJECTDIR/desktop/src
+
+INCLUDEPATH += $$DESKTOP_DIR
+
+HEADERS += \
+    $$DESKTOP_DIR/filedownloader.h \
+    $$DESKTOP_DIR/mainwindow.h \
+    $$DESKTOP_DIR/settingsdialog.h \
+    $$DESKTOP_DIR/addurldialog.h
+
+SOURCES += \
+    playlistbench.cpp \
+    $$DESKTOP_DIR/mainwindow.cpp \
+    $$DESKTOP_DIR/filedownloader.cpp \
+    $$DESKTOP_DIR/settingsdialog.cpp \
+    $$DESKTOP_DIR/addurldialog.cpp
+
+FORMS += \
+    $$DESKTOP_DIR/mainwindow.ui \
+    $$DESKTOP_DIR/settingsdialog.ui \
+    $$DESKTOP_DIR/addurldialog.ui
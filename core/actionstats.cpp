@@ -0,0 +1,232 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QtMath>
+
+#include <upnp/upnp.h>
+#include <libupnpp/control/description.hxx>
+
+#include "actionstats.h"
+#include "directory.h"
+#include "services.h"
+
+ActionStats* ActionStats::m_instance = nullptr;
+
+const QVector<int> ActionStats::bounds = {
+    5, 10, 20, 30, 50, 75, 100, 150, 200, 300, 500, 750,
+    1000, 1500, 2000, 3000, 5000, 10000, 30000
+};
+
+ActionStats::ActionStats(QObject *parent) :
+    QObject(parent)
+{
+}
+
+ActionStats* ActionStats::instance(QObject *parent)
+{
+    if (ActionStats::m_instance == nullptr) {
+        ActionStats::m_instance = new ActionStats(parent);
+    }
+
+    return ActionStats::m_instance;
+}
+
+int ActionStats::Stats::percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+
+    int rank = qCeil(p * count);
+    int sum = 0;
+    for (int i = 0; i < buckets.size(); ++i) {
+        sum += buckets.at(i);
+        if (sum >= rank)
+            return i < bounds.size() ? qMin(bounds.at(i), max) : max;
+    }
+
+    return max;
+}
+
+void ActionStats::record(const QString &deviceId, const QString &action,
+                         int msec, int ret)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto &stats = m_stats[deviceId][action];
+    if (stats.buckets.isEmpty())
+        stats.buckets.fill(0, bounds.size() + 1);
+
+    int i = 0;
+    while (i < bounds.size() && msec > bounds.at(i))
+        ++i;
+    stats.buckets[i]++;
+
+    stats.count++;
+    stats.total += msec;
+    stats.max = qMax(stats.max, msec);
+
+    if (ret != 0) {
+        stats.errors++;
+        stats.errorCodes[ret]++;
+        if (ret == UPNP_E_TIMEDOUT)
+            stats.timeouts++;
+    }
+}
+
+QJsonObject ActionStats::statsToJson(const Stats &stats)
+{
+    QJsonObject obj;
+    obj["count"] = stats.count;
+    obj["errors"] = stats.errors;
+    obj["timeouts"] = stats.timeouts;
+    obj["mean"] = stats.count > 0 ? int(stats.total / stats.count) : 0;
+    obj["p50"] = stats.percentile(0.50);
+    obj["p95"] = stats.percentile(0.95);
+    obj["p99"] = stats.percentile(0.99);
+    obj["max"] = stats.max;
+
+    QJsonObject codes;
+    for (auto it = stats.errorCodes.begin(); it != stats.errorCodes.end(); ++it)
+        codes[QString::number(it.key())] = it.value();
+    obj["errorCodes"] = codes;
+
+    QJsonArray hist;
+    for (int i = 0; i < stats.buckets.size(); ++i) {
+        if (stats.buckets.at(i) == 0)
+            continue;
+        QJsonObject b;
+        b["le"] = i < bounds.size() ? bounds.at(i) : -1; // -1 is infinity
+        b["count"] = stats.buckets.at(i);
+        hist.append(b);
+    }
+    obj["histogram"] = hist;
+
+    return obj;
+}
+
+QJsonObject ActionStats::queueToJson(const TaskExecutor::QueueStats &stats)
+{
+    QJsonObject obj;
+    obj["depth"] = stats.depth;
+    obj["maxDepth"] = stats.maxDepth;
+    obj["coalesced"] = stats.coalesced;
+    obj["lastWait"] = stats.lastWait;
+    obj["maxWait"] = stats.maxWait;
+    return obj;
+}
+
+// Task queues of services, device id => service name => stats
+static QHash<QString, QJsonObject> queuesJson()
+{
+    QHash<QString, QJsonObject> queues;
+
+    auto add = [&queues](Service *service) {
+        auto id = service->getDeviceId();
+        if (!id.isEmpty())
+            queues[id][service->metaObject()->className()] =
+                    ActionStats::queueToJson(service->queueStats());
+    };
+
+    auto s = Services::instance();
+    add(s->avTransport.get());
+    add(s->renderingControl.get());
+    for (const auto &id : s->sessionIds()) {
+        auto session = s->session(id);
+        if (session) {
+            add(session->avTransport.get());
+            add(session->renderingControl.get());
+        }
+    }
+
+    return queues;
+}
+
+QString ActionStats::toJson() const
+{
+    auto d = Directory::instance();
+    auto queues = queuesJson();
+
+    QMutexLocker locker(&m_mutex);
+
+    // Devices with task queues but without any action yet are listed too
+    auto ids = m_stats.keys();
+    for (auto it = queues.cbegin(); it != queues.cend(); ++it) {
+        if (!m_stats.contains(it.key()))
+            ids << it.key();
+    }
+
+    QJsonArray devices;
+    for (const auto &id : ids) {
+        QJsonObject dev;
+        dev["id"] = id;
+
+        UPnPClient::UPnPDeviceDesc ddesc;
+        if (d->getDeviceDesc(id, ddesc)) {
+            dev["name"] = QString::fromStdString(ddesc.friendlyName);
+            dev["manufacturer"] = QString::fromStdString(ddesc.manufacturer);
+            dev["model"] = QString::fromStdString(ddesc.modelName);
+        }
+
+        QJsonObject actions;
+        const auto stats = m_stats.value(id);
+        for (auto ait = stats.begin(); ait != stats.end(); ++ait)
+            actions[ait.key()] = statsToJson(ait.value());
+        dev["actions"] = actions;
+        dev["queues"] = queues.value(id);
+
+        devices.append(dev);
+    }
+
+    QJsonObject root;
+    root["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["devices"] = devices;
+
+    return QString::fromUtf8(QJsonDocument(root).toJson());
+}
+
+QString ActionStats::dump(const QString &path) const
+{
+    QString file = path;
+    if (file.isEmpty()) {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        if (!dir.exists())
+            dir.mkpath(".");
+        file = dir.filePath("action-stats.json");
+    }
+
+    QSaveFile f(file);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot open action stats file:" << f.errorString();
+        return QString();
+    }
+
+    f.write(toJson().toUtf8());
+
+    if (!f.commit()) {
+        qWarning() << "Cannot write action stats file:" << f.errorString();
+        return QString();
+    }
+
+    qDebug() << "Action stats written to:" << file;
+
+    return file;
+}
+
+void ActionStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stats.clear();
+}
@@ -0,0 +1,65 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ACTIONSTATS_H
+#define ACTIONSTATS_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QMutex>
+#include <QJsonObject>
+
+#include "taskexecutor.h"
+
+// Round-trip times and results of UPnP control actions, kept per device
+// and per action. Times are counted in fixed buckets, so percentiles are
+// approximate (upper bound of bucket), but memory use doesn't grow.
+// JSON also contains task queue stats of services of each device.
+
+class ActionStats :
+        public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int count = 0;
+        int errors = 0;
+        int timeouts = 0;
+        qint64 total = 0; // msec
+        int max = 0; // msec
+        QVector<int> buckets;
+        QMap<int,int> errorCodes; // code => count
+        int percentile(double p) const;
+    };
+
+    static ActionStats* instance(QObject *parent = nullptr);
+
+    // Thread-safe, called from task threads
+    void record(const QString &deviceId, const QString &action,
+                int msec, int ret);
+    Q_INVOKABLE QString toJson() const;
+    // Returns path of written file or empty string on error
+    Q_INVOKABLE QString dump(const QString &path = QString()) const;
+    Q_INVOKABLE void reset();
+    static QJsonObject queueToJson(const TaskExecutor::QueueStats &stats);
+
+private:
+    static ActionStats* m_instance;
+    static const QVector<int> bounds; // upper bounds of buckets in msec
+
+    mutable QMutex m_mutex;
+    QHash<QString, QHash<QString, Stats>> m_stats; // device id => action => stats
+
+    explicit ActionStats(QObject *parent = nullptr);
+    static QJsonObject statsToJson(const Stats &stats);
+};
+
+#endif // ACTIONSTATS_H
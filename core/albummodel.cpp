@@ -15,6 +15,9 @@
 #include "albummodel.h"
 #include "trackercursor.h"
 #include "settings.h"
+#ifdef DESKTOP
+#include "library.h"
+#endif
 
 const QString AlbumModel::albumsQueryTemplate =
         "SELECT ?album nie:title(?album) AS title " \
@@ -28,97 +31,163 @@ const QString AlbumModel::albumsQueryTemplate =
         "nfo:duration ?length; " \
         "nmm:performer ?artist . " \
         "} GROUP BY ?album ?artist " \
-        "ORDER BY nie:title(?album) " \
-        "LIMIT 100";
+        "ORDER BY %3 " \
+        "LIMIT 100 OFFSET %2";
+const int AlbumModel::queryLimit = 100;
 
 AlbumModel::AlbumModel(QObject *parent) :
     SelectableItemModel(new AlbumItem, parent)
 {
     auto s = Settings::instance();
     m_queryType = s->getAlbumQueryType();
+#ifdef DESKTOP
+    connect(Library::instance(), &Library::changed,
+            this, [this]{ updateModel(); });
+#endif
 }
 
 QList<ListItem*> AlbumModel::makeItems()
 {
-    const QString query = albumsQueryTemplate.arg(getFilter());
-    auto tracker = Tracker::instance();
-    if (tracker->query(query, false)) {
-        auto result = tracker->getResult();
-        return processTrackerReply(result.first, result.second);
-    } else {
-        qWarning() << "Tracker query error";
+    const QString type = metaObject()->className();
+    const QString filter = getFilter();
+    auto cache = QueryCache::instance();
+    const QVariantList after = pageKey();
+    QueryCache::Rows rows;
+
+#ifdef DESKTOP
+    const QString key = QString("library:%1").arg(m_queryType);
+#else
+    const QString key = QString("tracker:%1").arg(m_queryType);
+#endif
+
+    // Only first page is cached
+    if (after.isEmpty() && cache->find(type, key, filter, rows)) {
+        setNextPageKey(nextPageKey(rows, after));
+        return makeAlbumItems(rows);
     }
 
-    return QList<ListItem*>();
-}
+    int generation = cache->generation();
 
-QList<ListItem*> AlbumModel::processTrackerReply(
-        const QStringList& varNames,
-        const QByteArray& data)
-{
-    auto tracker = Tracker::instance();
+#ifdef DESKTOP
+    auto albums = Library::instance()->albums(filter, m_queryType == 1,
+                                              after, queryLimit,
+                                              [this]{ return isCancelled(); });
+    if (isCancelled())
+        return QList<ListItem*>();
 
-    QList<ListItem*> items;
+    for (const auto &album : albums) {
+        rows << QVariantList{QString::number(album.id), album.title,
+                             album.artist, album.count, album.length,
+                             album.art};
+    }
+
+    if (after.isEmpty())
+        cache->insert(type, key, filter, generation, rows, false);
+#else
+    const int offset = after.isEmpty() ? 0 : after.first().toInt();
+    // Sorting is done by the query, so pages follow each other
+    const QString order = m_queryType == 1 ?
+                "nmm:artistName(?artist) nie:title(?album)" : // by artist
+                "nie:title(?album)"; // by album title
+    const QString query = albumsQueryTemplate.arg(filter, QString::number(offset), order);
 
-    TrackerCursor cursor(varNames, data);
-    int n = cursor.columnCount();
+    // Rows for the same album are merged,
+    // so items are made when whole result is received
+    bool ok = Tracker::instance()->queryStream(query,
+                [this, &rows](TrackerCursor& cursor) {
+        while (cursor.next()) {
+            if (cursor.columnCount() < 5) {
+                qWarning() << "Tracker reply for albums is incorrect";
+                return false;
+            }
+            rows << cursor.values();
+        }
+        return !isCancelled();
+    }, [this]{ return isCancelled(); });
 
-    if (n > 4) {
-        QHash<QString, AlbumData> albums; // album id => album data
+    if (!ok) {
+        if (!isCancelled())
+            qWarning() << "Tracker query error";
+        return QList<ListItem*>();
+    }
 
-        while(cursor.next()) {
-            auto id = cursor.value(0).toString();
+    if (after.isEmpty())
+        cache->insert(type, key, filter, generation, rows,
+                      rows.size() < queryLimit, QList<int>() << 1 << 2);
+#endif
 
-            if (albums.contains(id)) {
-                qDebug() << "Duplicate album id, updating count, length and skiping";
+    setNextPageKey(nextPageKey(rows, after));
 
-                AlbumData& album = albums[id];
-                album.count += cursor.value(3).toInt();
-                album.length += cursor.value(4).toInt();
+    return makeAlbumItems(rows);
+}
 
-                continue;
-            }
+QVariantList AlbumModel::nextPageKey(const QueryCache::Rows& rows,
+                                     const QVariantList& after)
+{
+    if (rows.size() < queryLimit)
+        return QVariantList(); // no more rows
+
+#ifdef DESKTOP
+    Q_UNUSED(after)
+    const auto &last = rows.last();
+    if (m_queryType == 1) // by artist
+        return QVariantList{last.at(2), last.at(1), last.at(0).toLongLong()};
+    return QVariantList{last.at(1), last.at(0).toLongLong()};
+#else
+    // Tracker results are paged with offset
+    int offset = after.isEmpty() ? 0 : after.first().toInt();
+    return QVariantList{offset + rows.size()};
+#endif
+}
+
+QList<ListItem*> AlbumModel::makeAlbumItems(const QueryCache::Rows& rows)
+{
+    QHash<QString, AlbumData> albums; // album id => album data
+    QStringList ids; // album ids in query order
+
+    for (const auto &row : rows) {
+        auto id = row.at(0).toString();
+
+        if (albums.contains(id)) {
+            qDebug() << "Duplicate album id, updating count, length and skiping";
 
-            auto imgFilePath = tracker->genAlbumArtFile(cursor.value(1).toString(),
-                                                        cursor.value(2).toString());
-            QFileInfo imgFile(imgFilePath);
             AlbumData& album = albums[id];
-            album.id = id;
-            album.title = cursor.value(1).toString();
-            album.artist = cursor.value(2).toString();
-            album.icon = imgFile.exists() ? QUrl(imgFilePath) : QUrl();
-            album.count = cursor.value(3).toInt();
-            album.length = cursor.value(4).toInt();
-        }
+            album.count += row.at(3).toInt();
+            album.length += row.at(4).toInt();
 
-        auto end = albums.cend();
-        for (auto it = albums.cbegin(); it != end; ++it) {
-            const AlbumData& album = it.value();
-            items << new AlbumItem(
-                        album.id,
-                        album.title,
-                        album.artist,
-                        album.icon,
-                        album.count,
-                        album.length);
+            continue;
         }
 
-        // Sorting
-        if (m_queryType == 0) { // by album title
-            std::sort(items.begin(), items.end(), [](ListItem *a, ListItem *b) {
-                auto aa = dynamic_cast<AlbumItem*>(a);
-                auto bb = dynamic_cast<AlbumItem*>(b);
-                return aa->title().compare(bb->title(), Qt::CaseInsensitive) < 0;
-            });
-        } else { // by artist
-            std::sort(items.begin(), items.end(), [](ListItem *a, ListItem *b) {
-                auto aa = dynamic_cast<AlbumItem*>(a);
-                auto bb = dynamic_cast<AlbumItem*>(b);
-                return aa->artist().compare(bb->artist(), Qt::CaseInsensitive) < 0;
-            });
-        }
-    } else {
-        qWarning() << "Tracker reply for albums is incorrect";
+        ids << id;
+        AlbumData& album = albums[id];
+        album.id = id;
+        album.title = row.at(1).toString();
+        album.artist = row.at(2).toString();
+#ifdef DESKTOP
+        auto art = row.at(5).toString();
+        album.icon = art.isEmpty() ? QUrl() : QUrl::fromLocalFile(art);
+#else
+        auto imgFilePath = Tracker::instance()->genAlbumArtFile(album.title,
+                                                                album.artist);
+        QFileInfo imgFile(imgFilePath);
+        album.icon = imgFile.exists() ? QUrl(imgFilePath) : QUrl();
+#endif
+        album.count = row.at(3).toInt();
+        album.length = row.at(4).toInt();
+    }
+
+    QList<ListItem*> items;
+
+    // Rows are already sorted by the query
+    for (const auto &id : ids) {
+        const AlbumData& album = albums[id];
+        items << new AlbumItem(
+                    album.id,
+                    album.title,
+                    album.artist,
+                    album.icon,
+                    album.count,
+                    album.length);
     }
 
     return items;
@@ -145,16 +214,25 @@ AlbumItem::AlbumItem(const QString &id,
                    const QString &artist,
                    const QUrl &icon,
                    int count,
-                   int length,
-                   QObject *parent) :
-    SelectableItem(parent),
-    m_id(id),
-    m_title(title),
-    m_artist(artist),
-    m_icon(icon),
-    m_count(count),
-    m_length(length)
+                   int length)
+{
+    setValue(IdRole, id);
+    setValue(TitleRole, title);
+    setValue(ArtistRole, artist);
+    setValue(IconRole, icon);
+    setValue(CountRole, count);
+    setValue(LengthRole, length);
+}
+
+QList<RowStore::Column> AlbumItem::columns() const
 {
+    return QList<RowStore::Column>()
+            << RowStore::Column{IdRole, RowStore::String}
+            << RowStore::Column{TitleRole, RowStore::String}
+            << RowStore::Column{ArtistRole, RowStore::String}
+            << RowStore::Column{IconRole, RowStore::Url}
+            << RowStore::Column{CountRole, RowStore::Int}
+            << RowStore::Column{LengthRole, RowStore::Int};
 }
 
 QHash<int, QByteArray> AlbumItem::roleNames() const
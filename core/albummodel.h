@@ -19,10 +19,10 @@
 
 #include "listmodel.h"
 #include "itemmodel.h"
+#include "querycache.h"
 
 class AlbumItem : public SelectableItem
 {
-    Q_OBJECT
 
 public:
     enum Roles {
@@ -35,30 +35,24 @@ public:
     };
 
 public:
-    AlbumItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    AlbumItem() {}
     explicit AlbumItem(const QString &id,
                       const QString &title,
                       const QString &artist,
                       const QUrl &icon,
                       int count,
-                      int length,
-                      QObject *parent = nullptr);
+                      int length);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
-    inline QString id() const { return m_id; }
-    inline QString title() const { return m_title; }
-    inline QString artist() const { return m_artist; }
-    inline QUrl icon() const { return m_icon; }
-    inline int count() const { return m_count; }
-    inline int length() const { return m_length; }
+    inline QString id() const { return value(IdRole).toString(); }
+    inline QString title() const { return value(TitleRole).toString(); }
+    inline QString artist() const { return value(ArtistRole).toString(); }
+    inline QUrl icon() const { return value(IconRole).toUrl(); }
+    inline int count() const { return value(CountRole).toInt(); }
+    inline int length() const { return value(LengthRole).toInt(); }
 
-private:
-    QString m_id;
-    QString m_title;
-    QString m_artist;
-    QUrl m_icon;
-    int m_count = 0;
-    int m_length = 0;
+protected:
+    QList<RowStore::Column> columns() const;
 };
 
 class AlbumModel : public SelectableItemModel
@@ -86,11 +80,12 @@ private:
     };
 
     static const QString albumsQueryTemplate;
+    static const int queryLimit;
     int m_queryType = 0;
     QList<ListItem*> makeItems();
-    QList<ListItem*> processTrackerReply(
-            const QStringList& varNames,
-            const QByteArray& data);
+    QVariantList nextPageKey(const QueryCache::Rows& rows,
+                             const QVariantList& after);
+    QList<ListItem*> makeAlbumItems(const QueryCache::Rows& rows);
 };
 
 #endif // ALBUMMODEL_H
@@ -13,6 +13,9 @@
 #include "tracker.h"
 #include "artistmodel.h"
 #include "trackercursor.h"
+#ifdef DESKTOP
+#include "library.h"
+#endif
 
 const QString ArtistModel::artistsQueryTemplate =
         "SELECT ?artist nmm:artistName(?artist) AS artist " \
@@ -25,60 +28,131 @@ const QString ArtistModel::artistsQueryTemplate =
         "nmm:performer ?artist . } " \
         "GROUP BY ?artist " \
         "ORDER BY nmm:artistName(?artist) " \
-        "LIMIT 100";
+        "LIMIT 100 OFFSET %2";
+const int ArtistModel::queryLimit = 100;
 
 ArtistModel::ArtistModel(QObject *parent) :
     SelectableItemModel(new ArtistItem, parent)
 {
+#ifdef DESKTOP
+    connect(Library::instance(), &Library::changed,
+            this, [this]{ updateModel(); });
+#endif
 }
 
 QList<ListItem*> ArtistModel::makeItems()
 {
-    const QString query = artistsQueryTemplate.arg(getFilter());
-    auto tracker = Tracker::instance();
+    const QString type = metaObject()->className();
+    const QString filter = getFilter();
+    auto cache = QueryCache::instance();
+    const QVariantList after = pageKey();
+    QueryCache::Rows rows;
+    QSet<QString> artists;
+
+#ifdef DESKTOP
+    const QString key("library");
+#else
+    const QString &key = artistsQueryTemplate;
+#endif
+
+    // Only first page is cached
+    if (after.isEmpty() && cache->find(type, key, filter, rows)) {
+        setNextPageKey(nextPageKey(rows, after));
+        return makeItemsFromRows(rows, artists);
+    }
+
+    int generation = cache->generation();
+
+#ifdef DESKTOP
+    auto list = Library::instance()->artists(filter, after, queryLimit,
+                                             [this]{ return isCancelled(); });
+    if (isCancelled())
+        return QList<ListItem*>();
+
+    for (const auto &artist : list) {
+        rows << QVariantList{QString::number(artist.id), artist.name,
+                             artist.count, artist.length};
+    }
 
-    if (tracker->query(query, false)) {
-        auto result = tracker->getResult();
-        return processTrackerReply(result.first, result.second);
-    } else {
+    if (after.isEmpty())
+        cache->insert(type, key, filter, generation, rows, false);
+
+    setNextPageKey(nextPageKey(rows, after));
+
+    return makeItemsFromRows(rows, artists);
+#else
+    const int offset = after.isEmpty() ? 0 : after.first().toInt();
+    const QString query = artistsQueryTemplate.arg(filter, QString::number(offset));
+
+    bool ok = Tracker::instance()->queryStream(query,
+                [this, &rows, &artists](TrackerCursor& cursor) {
+        QueryCache::Rows part;
+        while (cursor.next()) {
+            if (cursor.columnCount() < 4) {
+                qWarning() << "Tracker reply for artists is incorrect";
+                return false;
+            }
+            part << cursor.values();
+        }
+
+        rows << part;
+        deliverItems(makeItemsFromRows(part, artists));
+        return !isCancelled();
+    }, [this]{ return isCancelled(); });
+
+    if (ok) {
+        if (after.isEmpty())
+            cache->insert(type, key, filter, generation, rows,
+                          rows.size() < queryLimit, QList<int>() << 1);
+        setNextPageKey(nextPageKey(rows, after));
+    } else if (!isCancelled()) {
         qWarning() << "Tracker query error";
     }
 
+    // all items have been already delivered
     return QList<ListItem*>();
+#endif
 }
 
-QList<ListItem*> ArtistModel::processTrackerReply(
-        const QStringList& varNames,
-        const QByteArray& data)
+QVariantList ArtistModel::nextPageKey(const QueryCache::Rows& rows,
+                                       const QVariantList& after)
 {
-    QList<ListItem*> items;
-
-    TrackerCursor cursor(varNames, data);
-    int n = cursor.columnCount();
+    if (rows.size() < queryLimit)
+        return QVariantList(); // no more rows
+
+#ifdef DESKTOP
+    Q_UNUSED(after)
+    const auto &last = rows.last();
+    return QVariantList{last.at(1), last.at(0).toLongLong()};
+#else
+    // Tracker results are paged with offset
+    int offset = after.isEmpty() ? 0 : after.first().toInt();
+    return QVariantList{offset + rows.size()};
+#endif
+}
 
-    if (n > 3) {
-        QStringList artists;
+QList<ListItem*> ArtistModel::makeItemsFromRows(const QueryCache::Rows& rows,
+                                                QSet<QString>& artists)
+{
+    QList<ListItem*> items;
 
-        while(cursor.next()) {
-            QString id = cursor.value(0).toString();
+    for (const auto &row : rows) {
+        QString id = row.at(0).toString();
 
-            if (artists.contains(id)) {
-                qDebug() << "Duplicate artist, skiping";
-                continue;
-            }
+        if (artists.contains(id)) {
+            qDebug() << "Duplicate artist, skiping";
+            continue;
+        }
 
-            items << new ArtistItem(
-                         id,
-                         cursor.value(1).toString(),
-                         QUrl(), // icon
-                         cursor.value(2).toInt(),
-                         cursor.value(3).toInt()
-                         );
+        items << new ArtistItem(
+                     id,
+                     row.at(1).toString(),
+                     QUrl(), // icon
+                     row.at(2).toInt(),
+                     row.at(3).toInt()
+                     );
 
-            artists << id;
-        }
-    } else {
-        qWarning() << "Tracker reply for artists is incorrect";
+        artists.insert(id);
     }
 
     return items;
@@ -88,9 +162,7 @@ ArtistItem::ArtistItem(const QString &id,
                    const QString &name,
                    const QUrl &icon,
                    int count,
-                   int length,
-                   QObject *parent) :
-    SelectableItem(parent),
+                   int length) :
     m_id(id),
     m_name(name),
     m_icon(icon),
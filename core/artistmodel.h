@@ -11,6 +11,7 @@
 #include <QString>
 #include <QStringList>
 #include <QHash>
+#include <QSet>
 #include <QDebug>
 #include <QByteArray>
 #include <QModelIndex>
@@ -19,10 +20,10 @@
 
 #include "listmodel.h"
 #include "itemmodel.h"
+#include "querycache.h"
 
 class ArtistItem : public SelectableItem
 {
-    Q_OBJECT
 
 public:
     enum Roles {
@@ -34,13 +35,12 @@ public:
     };
 
 public:
-    ArtistItem(QObject *parent = 0): SelectableItem(parent) {}
+    ArtistItem() {}
     explicit ArtistItem(const QString &id,
                       const QString &name,
                       const QUrl &icon,
                       int count,
-                      int length,
-                      QObject *parent = nullptr);
+                      int length);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -66,11 +66,13 @@ public:
 
 private:
     static  const QString artistsQueryTemplate;
+    static const int queryLimit;
 
     QList<ListItem*> makeItems();
-    QList<ListItem*> processTrackerReply(
-            const QStringList& varNames,
-            const QByteArray& data);
+    QVariantList nextPageKey(const QueryCache::Rows& rows,
+                             const QVariantList& after);
+    QList<ListItem*> makeItemsFromRows(const QueryCache::Rows& rows,
+                                       QSet<QString>& artists);
 };
 
 #endif // ARTISTMODEL_H
@@ -10,6 +10,7 @@
 #include <QThread>
 #include <QGuiApplication>
 #include <QTime>
+#include <QElapsedTimer>
 
 #include "avtransport.h"
 #include "directory.h"
@@ -17,6 +18,7 @@
 #include "utils.h"
 #include "taskexecutor.h"
 #include "contentserver.h"
+#include "settings.h"
 
 
 AVTransport::AVTransport(QObject *parent) :
@@ -33,6 +35,51 @@ AVTransport::AVTransport(QObject *parent) :
     m_seekTimer.setInterval(500);
     m_seekTimer.setSingleShot(true);
     QObject::connect(&m_seekTimer, &QTimer::timeout, this, &AVTransport::seekTimeout);
+    QObject::connect(Utils::instance(), &Utils::networkIfChanged,
+                     this, &AVTransport::handleNetworkIfChanged);
+}
+
+// URLs given to renderer contain address of content server, so they are
+// issued again when that address changes. Current track is set again only
+// if its address is gone, otherwise it plays to the end and next one
+// is taken from the new address.
+void AVTransport::handleNetworkIfChanged()
+{
+    if (!getInited())
+        return;
+
+    QString ifname, addr;
+    if (!Utils::instance()->getNetworkIfFor(getDeviceHost(), ifname, addr))
+        return;
+
+    auto cs = ContentServer::instance();
+    auto u = Utils::instance();
+    int port = Settings::instance()->getPort();
+
+    auto isStale = [&addr, port](const QUrl &url) {
+        return url.isValid() && url.port() == port && url.host() != addr;
+    };
+
+    QUrl cURL(m_currentURI), nURL(m_nextURI);
+    bool cStale = isStale(cURL);
+    bool nStale = isStale(nURL);
+
+    if (!cStale && !nStale)
+        return;
+
+    auto cid = cs->idFromUrl(cURL);
+    auto nid = cs->idFromUrl(nURL);
+
+    if (cStale && !cid.isEmpty() && m_transportState == Playing &&
+            !u->hasNetworkAddress(cURL.host())) {
+        qDebug() << "Server address changed, setting current URL again";
+        // Position is restored by content task, so seek can't be done
+        // before new URL is set
+        setLocalContent(cid, nid, m_relativeTimePosition);
+    } else if (nStale && !nid.isEmpty() && m_transportState == Playing) {
+        qDebug() << "Server address changed, setting next URL again";
+        setLocalContent("", nid);
+    }
 }
 
 QUrl AVTransport::getCurrentId()
@@ -44,7 +91,7 @@ QUrl AVTransport::getCurrentId()
 
 void AVTransport::changed(const QString& name, const QVariant& _value)
 {
-    if (!getInited()) {
+    if (!isInitedOrIniting()) {
         qWarning() << "AVTransport service is not inited";
         return;
     }
@@ -84,7 +131,6 @@ void AVTransport::changed(const QString& name, const QVariant& _value)
             if (!m_seekTimer.isActive()) {
                 if (m_relativeTimePosition != value) {
                     m_relativeTimePosition = value;
-                    m_oldTimePosition = value;
                     emit relativeTimePositionChanged();
                 }
             }
@@ -93,6 +139,17 @@ void AVTransport::changed(const QString& name, const QVariant& _value)
                 m_absoluteTimePosition = value;
                 emit absoluteTimePositionChanged();
             }
+        } else if (name == "CurrentTransportActions") {
+            if (m_currentTransportActions != value) {
+                m_currentTransportActions = value;
+                emit transportActionsChanged();
+                emit preControlableChanged();
+            }
+        } else if (name == "CurrentPlayMode") {
+            if (m_playmode != value) {
+                m_playmode = value;
+                emit playModeChanged();
+            }
         }
     }
 
@@ -101,6 +158,10 @@ void AVTransport::changed(const QString& name, const QVariant& _value)
 
         if (name == "AVTransportURI" || name == "CurrentTrackURI") {
             if (m_currentURI != value) {
+                // Evented meta data may belong to previous track. Meta data
+                // of new track can come in the same event before the URI.
+                if (m_metaURI != value)
+                    m_metaEvented = false;
 
                 if (m_blockEmitUriChanged) {
                     qDebug() << "currentURI change blocked";
@@ -166,6 +227,21 @@ void AVTransport::changed(const QString& name, const QVariant& _value)
     }
 }
 
+void AVTransport::metaChanged(const QString &name, const UPnPClient::UPnPDirObject &meta)
+{
+    if (!isInitedOrIniting()) {
+        qWarning() << "AVTransport service is not inited";
+        return;
+    }
+
+    if (name == "CurrentTrackMetaData" || name == "AVTransportURIMetaData") {
+        m_metaURI = meta.m_resources.empty() ? QString() :
+                        QString::fromStdString(meta.m_resources.front().m_uri);
+        m_metaEvented = true;
+        updateTrackMeta(meta);
+    }
+}
+
 UPnPClient::Service* AVTransport::createUpnpService(const UPnPClient::UPnPDeviceDesc &ddesc,
                                                     const UPnPClient::UPnPServiceDesc &sdesc)
 {
@@ -175,7 +251,13 @@ UPnPClient::Service* AVTransport::createUpnpService(const UPnPClient::UPnPDevice
 void AVTransport::postInit()
 {
     qDebug() << "--> UPDATE postInit";
-    update();
+    update(500, 500, true);
+}
+
+void AVTransport::postResubscribe()
+{
+    qDebug() << "--> UPDATE postResubscribe";
+    update(0, 0, true);
 }
 
 void AVTransport::reset()
@@ -200,8 +282,12 @@ void AVTransport::reset()
     m_currentAlbum.clear();
     m_currentTransportActions = 0;
     m_futureSeek = 0;
+    m_positionRtt = 0;
+    m_positionPollInterval = 1;
+    m_secsToPositionPoll = 0;
     m_nextURISupported = true;
     m_stopCalled = false;
+    m_metaEvented = false;
     updateMeta();
 
     emit currentURIChanged();
@@ -263,6 +349,8 @@ void AVTransport::transportStateHandler()
 
     m_stopCalled = false;
 
+    kickPositionPolling();
+
     //qDebug() << "--> aUPDATE transportStateHandler";
     asyncUpdate();
 }
@@ -271,14 +359,20 @@ void AVTransport::handleApplicationStateChanged(Qt::ApplicationState state)
 {
     //qDebug() << "State changed:" << state;
     //qDebug() << "--> aUPDATE handleApplicationStateChanged";
-    Q_UNUSED(state)
-
     if (!getInited()) {
         qWarning() << "AVTransport service is not inited";
         return;
     }
 
-    asyncUpdate();
+    bool visible = isUiVisible(state);
+
+    if (visible)
+        kickPositionPolling();
+
+    // Events could have been lost while device was sleeping,
+    // so full update when app is back in foreground. When UI
+    // is hidden, update stops position polling.
+    asyncUpdate(0, 500, visible);
 }
 
 void AVTransport::trackChangedHandler()
@@ -291,7 +385,22 @@ void AVTransport::trackChangedHandler()
         return;
     }
 
-    asyncUpdate();
+    kickPositionPolling();
+
+    if (getEventsActive()) {
+        // Meta data of new track is not always evented
+        // Queued task can be replaced by newer one, so request for
+        // media info is kept outside of the task and is not lost
+        if (!m_metaEvented.exchange(false))
+            m_mediaInfoNeeded = true;
+        startTask("trackChanged", TP_Background, [this](){
+            if (m_mediaInfoNeeded.exchange(false))
+                updateMediaInfo();
+            update();
+        });
+    } else {
+        asyncUpdate();
+    }
 }
 
 void AVTransport::controlableChangedHandler()
@@ -583,9 +692,10 @@ bool AVTransport::isIgnoreActions()
     return ignore;
 }
 
-void AVTransport::setLocalContent(const QString &cid, const QString &nid)
+void AVTransport::setLocalContent(const QString &cid, const QString &nid,
+                                  int startPos)
 {
-    qDebug() << "setLocalContent:" << cid << nid;
+    qDebug() << "setLocalContent:" << cid << nid << startPos;
 
     if (!getInited()) {
         qWarning() << "AVTransport service is not inited";
@@ -600,11 +710,32 @@ void AVTransport::setLocalContent(const QString &cid, const QString &nid)
 
     //qDebug() << ">>> setLocalContent thread:" << QThread::currentThreadId();
 
-    startTask([this, cid, nid](){
+    {
+        // Queued content task can be replaced by newer one, so current
+        // track is kept outside of the task and is not lost when newer
+        // task updates only next URI
+        QMutexLocker locker(&m_contentMutex);
+        if (!cid.isEmpty()) {
+            m_pendingCid = cid;
+            m_pendingStartPos = startPos;
+        }
+    }
+
+    startTask("content", TP_User, [this, nid](){
+        QString cid; int startPos;
+        {
+            QMutexLocker locker(&m_contentMutex);
+            cid = m_pendingCid;
+            startPos = m_pendingStartPos;
+            m_pendingCid.clear();
+            m_pendingStartPos = 0;
+        }
+
         auto cs = ContentServer::instance();
 
         bool do_current = !cid.isEmpty();
         bool do_play = false;
+        bool current_ok = false, play_ok = false;
         bool do_next = m_nextURISupported && !nid.isEmpty();
         bool do_clearNext = m_nextURISupported && !do_next;
         QUrl cURL, nURL;
@@ -614,7 +745,7 @@ void AVTransport::setLocalContent(const QString &cid, const QString &nid)
         //qDebug() << "2| cid, nid:" << cid << nid;
 
         if (do_current) {
-            if (!cs->getContentUrl(cid, cURL, cmeta, m_currentURI)) {
+            if (!cs->getContentUrl(cid, cURL, cmeta, m_currentURI, getDeviceHost())) {
                 qWarning() << "Id" << cid << "cannot be converted to URL";
                 emit error(E_InvalidPath);
                 return;
@@ -631,7 +762,7 @@ void AVTransport::setLocalContent(const QString &cid, const QString &nid)
         }
 
         if (do_next) {
-            if (!cs->getContentUrl(nid, nURL, nmeta, m_nextURI)) {
+            if (!cs->getContentUrl(nid, nURL, nmeta, m_nextURI, getDeviceHost())) {
                 qWarning() << "Id" << nid << "cannot be converted to URL";
                 emit error(E_InvalidPath);
                 return;
@@ -725,6 +856,8 @@ void AVTransport::setLocalContent(const QString &cid, const QString &nid)
                     qWarning() << "AVTransport service is not inited";
                     return;
                 }
+            } else {
+                current_ok = true;
             }
             tsleep();
             do_play = true;
@@ -738,11 +871,27 @@ void AVTransport::setLocalContent(const QString &cid, const QString &nid)
                     qWarning() << "AVTransport service is not inited";
                     return;
                 }
+            } else {
+                play_ok = true;
             }
         }
 
         tsleep();
 
+        // Seek is done under the same lock, so it can't overtake
+        // setAVTransportURI
+        if (startPos > 0 && current_ok && play_ok) {
+            qDebug() << "Calling: seek to start position:" << startPos;
+            if (handleError(srv->seek(UPnPClient::AVTransport::SEEK_REL_TIME,
+                                      startPos))) {
+                m_relativeTimePosition = startPos;
+                kickPositionPolling();
+                tsleep();
+            } else {
+                qWarning() << "Error response for seek(" << startPos << ")";
+            }
+        }
+
         m_updateMutex.unlock();
 
         //qDebug() << "--> UPDATE setLocalContent";
@@ -766,7 +915,7 @@ void AVTransport::play()
         return;
     }
 
-    startTask([this](){
+    startTask(QString(), TP_User, [this](){
         m_updateMutex.lock();    
 
         qDebug() << "Calling: play";
@@ -809,7 +958,7 @@ void AVTransport::pause()
         return;
     }
 
-    startTask([this](){
+    startTask(QString(), TP_User, [this](){
         m_updateMutex.lock();
 
         auto srv = s();
@@ -852,7 +1001,7 @@ void AVTransport::stop()
     emit relativeTimePositionChanged();
     emit absoluteTimePositionChanged();
 
-    startTask([this](){
+    startTask(QString(), TP_User, [this](){
         m_updateMutex.lock();
 
         auto srv = s();
@@ -891,7 +1040,7 @@ void AVTransport::next()
         return;
     }
 
-    startTask([this](){
+    startTask(QString(), TP_User, [this](){
         m_updateMutex.lock();
 
         auto srv = s();
@@ -928,7 +1077,7 @@ void AVTransport::previous()
         return;
     }
 
-    startTask([this](){
+    startTask(QString(), TP_User, [this](){
         m_updateMutex.lock();
 
         auto srv = s();
@@ -965,7 +1114,7 @@ void AVTransport::setPlayMode(int value)
         return;
     }
 
-    startTask([this, value](){
+    startTask("playMode", TP_User, [this, value](){
         qDebug() << "setPlayMode:" << value;
 
         m_updateMutex.lock();
@@ -1016,7 +1165,7 @@ void AVTransport::seekTimeout()
         return;
     }
 
-    startTask([this](){
+    startTask("seek", TP_User, [this](){
         qDebug() << "Seek timeout:" << m_futureSeek;
 
         m_updateMutex.lock();
@@ -1034,7 +1183,7 @@ void AVTransport::seekTimeout()
         if (handleError(srv->seek(UPnPClient::AVTransport::SEEK_REL_TIME,
                                   m_futureSeek))) {
             m_relativeTimePosition = m_futureSeek;
-            m_oldTimePosition = m_futureSeek - 5;
+            kickPositionPolling();
             tsleep();
             m_updateMutex.unlock();
 
@@ -1050,11 +1199,18 @@ void AVTransport::seekTimeout()
 void AVTransport::fakeUpdateRelativeTimePosition()
 {
     if (m_currentTrackDuration == 0 || m_relativeTimePosition < m_currentTrackDuration) {
-        if (m_oldTimePosition < m_relativeTimePosition - 5) {
+        m_relativeTimePosition++;
+        emit relativeTimePositionChanged();
+
+        // Poll earlier if the track ends before the next scheduled poll
+        int remaining = m_currentTrackDuration - m_relativeTimePosition;
+        if (m_currentTrackDuration > 0 && remaining < m_secsToPositionPoll)
+            m_secsToPositionPoll = remaining;
+
+        if (--m_secsToPositionPoll <= 0) {
+            // Next poll is rescheduled when the result comes
+            m_secsToPositionPoll = m_positionPollInterval.load();
             asyncUpdatePositionInfo();
-        } else {
-            m_relativeTimePosition++;
-            emit relativeTimePositionChanged();
         }
     } else {
         qDebug() << "--> aUPDATE fakeUpdateRelativeTimePosition";
@@ -1062,7 +1218,47 @@ void AVTransport::fakeUpdateRelativeTimePosition()
     }
 }
 
-void AVTransport::update(int initDelay, int postDelay)
+void AVTransport::kickPositionPolling()
+{
+    // Position is likely to jump after play, seek or track change,
+    // so checking it often until it is stable again
+    int interval = minPositionPollInterval();
+    m_positionPollInterval = interval;
+    m_secsToPositionPoll = interval;
+}
+
+int AVTransport::minPositionPollInterval()
+{
+    // Don't keep slow renderer busy with polls, request should take
+    // at most 1/4 of the polling period
+    return qMax(1, (4 * m_positionRtt + 999) / 1000);
+}
+
+void AVTransport::adaptPositionPolling(int drift)
+{
+    // Position is not evented, so it is polled. When state changes are
+    // evented, position is also re-read after every change, therefore
+    // steady playback can be checked rarely.
+    int maxInterval = getEventsActive() ? 30 : 8;
+    int minInterval = minPositionPollInterval();
+    int interval = m_positionPollInterval;
+
+    if (drift > 1) {
+        // Local clock diverges from renderer, checking more often
+        interval = qMax(minInterval, interval / 2);
+    } else {
+        interval = qMin(maxInterval, interval * 2);
+    }
+
+    interval = qMax(minInterval, interval);
+    m_positionPollInterval = interval;
+    m_secsToPositionPoll = interval;
+
+    qDebug() << "Position drift:" << drift << "rtt:" << m_positionRtt.load()
+             << "next poll in:" << interval;
+}
+
+void AVTransport::update(int initDelay, int postDelay, bool full)
 {
     if (!isInitedOrIniting()) {
         qWarning() << "AVTransport service is not inited";
@@ -1078,11 +1274,17 @@ void AVTransport::update(int initDelay, int postDelay)
 
     tsleep(initDelay);
 
-    updatePositionInfo();
-    updateTransportInfo();
-    updateMediaInfo();
-    updateCurrentTransportActions();
-    //updateTransportSettings();
+    if (full || !getEventsActive()) {
+        updatePositionInfo();
+        updateTransportInfo();
+        updateMediaInfo();
+        updateCurrentTransportActions();
+        //updateTransportSettings();
+    } else {
+        // Other state variables are delivered in LastChange events
+        qDebug() << "Events are active, updating only position";
+        updatePositionInfo();
+    }
 
     tsleep(postDelay);
 
@@ -1118,29 +1320,23 @@ void AVTransport::update(int initDelay, int postDelay)
 
 void AVTransport::needTimerCheck()
 {
-    auto app = static_cast<QGuiApplication*>(QGuiApplication::instance());
-    //qDebug() << "applicationState:" << app->applicationState();
-
-    if (m_transportState == Playing
-#ifdef SAILFISH
-           && app->applicationState() == Qt::ApplicationActive
-#endif
-       ) {
+    // Position is not needed when nobody sees it
+    if (m_transportState == Playing && isUiVisible()) {
        emit needTimer(true);
     } else {
        emit needTimer(false);
     }
 }
 
-void AVTransport::asyncUpdate(int initDelay, int postDelay)
+void AVTransport::asyncUpdate(int initDelay, int postDelay, bool full)
 {
     if (!isInitedOrIniting()) {
         qWarning() << "AVTransport service is not inited";
         return;
     }
 
-    startTask([this, initDelay, postDelay](){
-        update(initDelay, postDelay);
+    startTask(full ? "fullUpdate" : "update", TP_Background, [this, initDelay, postDelay, full](){
+        update(initDelay, postDelay, full);
     });
 }
 
@@ -1151,9 +1347,10 @@ void AVTransport::asyncUpdatePositionInfo()
         return;
     }
 
-    startTask([this](){
+    startTask("position", TP_Background, [this](){
         updatePositionInfo();
-        updateCurrentTransportActions();
+        if (!getEventsActive())
+            updateCurrentTransportActions();
     });
 }
 
@@ -1168,6 +1365,9 @@ void AVTransport::updatePositionInfo()
 
     UPnPClient::AVTransport::PositionInfo pi;
 
+    QElapsedTimer rtt;
+    rtt.start();
+
     if (!handleError(srv->getPositionInfo(pi))) {
         qWarning() << "Unable to get Position Info";
         pi.abscount = 0;
@@ -1177,6 +1377,11 @@ void AVTransport::updatePositionInfo()
         pi.track = 0;
         pi.trackduration = 0;
 
+    } else {
+        int elapsed = static_cast<int>(rtt.elapsed());
+        int prevRtt = m_positionRtt;
+        m_positionRtt = prevRtt == 0 ? elapsed : (7 * prevRtt + elapsed) / 8;
+        adaptPositionPolling(qAbs(pi.reltime - m_relativeTimePosition));
     }
 
     qDebug() << "PositionInfo:";
@@ -1206,7 +1411,6 @@ void AVTransport::updatePositionInfo()
 
     if (m_relativeTimePosition != pi.reltime) {
         m_relativeTimePosition = pi.reltime;
-        m_oldTimePosition = m_relativeTimePosition;
         emit relativeTimePositionChanged();
     }
 }
@@ -1218,7 +1422,7 @@ void AVTransport::asyncUpdateTransportInfo()
         return;
     }
 
-    startTask([this](){
+    startTask("transportInfo", TP_Background, [this](){
         updateTransportInfo();
     });
 }
@@ -1272,13 +1476,25 @@ void AVTransport::updateTransportInfo()
 
 void AVTransport::updateTrackMeta(const UPnPClient::UPnPDirObject &trackmeta)
 {
-    m_id = QString::fromStdString(trackmeta.m_id);
-    m_currentTitle = QString::fromStdString(trackmeta.m_title);
-    m_currentClass = QString::fromStdString(trackmeta.getprop("upnp:class"));
-    m_currentAuthor = QString::fromStdString(trackmeta.getprop("upnp:artist")).split(",").first();
-    m_currentDescription  = QString::fromStdString(trackmeta.getprop("upnp:longDescription"));
-    m_currentAlbum = QString::fromStdString(trackmeta.getprop("upnp:album"));
-    emit currentMetaDataChanged();
+    auto id = QString::fromStdString(trackmeta.m_id);
+    auto title = QString::fromStdString(trackmeta.m_title);
+    auto clazz = QString::fromStdString(trackmeta.getprop("upnp:class"));
+    auto author = QString::fromStdString(trackmeta.getprop("upnp:artist")).split(",").first();
+    auto description = QString::fromStdString(trackmeta.getprop("upnp:longDescription"));
+    auto album = QString::fromStdString(trackmeta.getprop("upnp:album"));
+
+    // Same meta data is delivered both in events and in update responses
+    if (m_id != id || m_currentTitle != title || m_currentClass != clazz ||
+        m_currentAuthor != author || m_currentDescription != description ||
+        m_currentAlbum != album) {
+        m_id = id;
+        m_currentTitle = title;
+        m_currentClass = clazz;
+        m_currentAuthor = author;
+        m_currentDescription = description;
+        m_currentAlbum = album;
+        emit currentMetaDataChanged();
+    }
 
     auto new_albumArtURI = QUrl(QString::fromStdString(trackmeta.getprop("upnp:albumArtURI")));
     if (m_currentAlbumArtURI != new_albumArtURI) {
@@ -1320,7 +1536,7 @@ void AVTransport::asyncUpdateMediaInfo()
         return;
     }
 
-    startTask([this](){
+    startTask("mediaInfo", TP_Background, [this](){
         updateMediaInfo();
     });
 }
@@ -1422,7 +1638,7 @@ void AVTransport::asyncUpdateCurrentTransportActions()
         return;
     }
 
-    startTask([this](){
+    startTask("transportActions", TP_Background, [this](){
         updateCurrentTransportActions();
     });
 }
@@ -1489,7 +1705,7 @@ void AVTransport::asyncUpdateTransportSettings()
         return;
     }
 
-    startTask([this](){
+    startTask("transportSettings", TP_Background, [this](){
         updateTransportSettings();
     });
 }
@@ -13,6 +13,7 @@
 #include <QMutex>
 #include <QMetaMethod>
 #include <QUrl>
+#include <atomic>
 
 #include "libupnpp/control/avtransport.hxx"
 #include "libupnpp/control/service.hxx"
@@ -110,8 +111,9 @@ public:
     Q_INVOKABLE void next();
     Q_INVOKABLE void previous();
     Q_INVOKABLE void seek(int value);
-    Q_INVOKABLE void setLocalContent(const QString &cid, const QString &nid);
-    Q_INVOKABLE void asyncUpdate(int initDelay = 0, int postDelay = 500);
+    Q_INVOKABLE void setLocalContent(const QString &cid, const QString &nid,
+                                     int startPos = 0);
+    Q_INVOKABLE void asyncUpdate(int initDelay = 0, int postDelay = 500, bool full = false);
     Q_INVOKABLE void setPlayMode(int value);
 
     int getTransportState();
@@ -180,6 +182,7 @@ private slots:
     void trackChangedHandler();
     void seekTimeout();
     void handleApplicationStateChanged(Qt::ApplicationState state);
+    void handleNetworkIfChanged();
 
 private:
     int m_transportState = Unknown;
@@ -193,7 +196,12 @@ private:
     int m_absoluteTimePosition = 0;
     int m_speed = 1;
     int m_currentTransportActions = 0;
-    int m_oldTimePosition = 0;
+
+    // Adaptive position polling, updated by position task
+    // and counted down in main thread
+    std::atomic<int> m_positionPollInterval{1}; // seconds
+    std::atomic<int> m_secsToPositionPoll{0};
+    std::atomic<int> m_positionRtt{0}; // smoothed getPositionInfo round-trip in ms
     QString m_id;
     QString m_currentClass;
     QString m_currentTitle;
@@ -212,27 +220,41 @@ private:
     bool m_blockEmitUriChanged = false;
     bool m_pendingControlableSignal = false;
     bool m_stopCalled = false;
-    const ContentServer::ItemMeta* m_currentMeta = nullptr;
+    // Set from event thread, meta data for current track was evented
+    std::atomic<bool> m_metaEvented{false};
+    QString m_metaURI; // URI of evented meta data, used only in event thread
+    std::atomic<bool> m_mediaInfoNeeded{false}; // for queued trackChanged task
+    std::shared_ptr<const ContentServer::ItemMeta> m_currentMeta;
 
     QTimer m_seekTimer;
     int m_futureSeek = 0;
 
     QMutex m_updateMutex;
+    // Current track of queued content task, kept when task is replaced
+    // by one which sets only next URI
+    QMutex m_contentMutex;
+    QString m_pendingCid;
+    int m_pendingStartPos = 0;
 
     void changed(const QString &name, const QVariant &value);
+    void metaChanged(const QString &name, const UPnPClient::UPnPDirObject &meta);
     UPnPClient::Service* createUpnpService(const UPnPClient::UPnPDeviceDesc &ddesc,
                                            const UPnPClient::UPnPServiceDesc &sdesc);
     void postInit();
+    void postResubscribe();
     void reset();
 
     UPnPClient::AVTransport* s();
     void fakeUpdateRelativeTimePosition();
+    void kickPositionPolling();
+    void adaptPositionPolling(int drift);
+    int minPositionPollInterval();
     void updateTransportInfo();
     void updateTransportSettings();
     void updatePositionInfo();
     void updateMediaInfo();
     void updateCurrentTransportActions();
-    void update(int initDelay = 500, int postDelay = 500);
+    void update(int initDelay = 500, int postDelay = 500, bool full = false);
     void asyncUpdateTransportInfo();
     void asyncUpdateTransportSettings();
     void asyncUpdatePositionInfo();
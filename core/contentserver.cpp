@@ -18,17 +18,17 @@
 #include <QAudioFormat>
 #include <QAudioDeviceInfo>
 #include <QAudioInput>
-#include <QDomDocument>
-#include <QDomElement>
-#include <QDomNode>
-#include <QDomNodeList>
-#include <QDomText>
 #include <QSslConfiguration>
 #include <QTextStream>
 #include <QStandardPaths>
 #include <QEventLoop>
+#include <QDateTime>
+#include <QFile>
+#include <QTextCodec>
+#include <QXmlStreamReader>
 #include <iomanip>
 #include <limits>
+#include <string.h>
 
 #include <QDBusInterface>
 #include <QDBusMessage>
@@ -337,17 +337,20 @@ void ContentServerWorker::requestHandler(QHttpRequest *req, QHttpResponse *resp)
 
     auto cs = ContentServer::instance();
 
-    const ContentServer::ItemMeta *meta;
+    std::shared_ptr<const ContentServer::ItemMeta> meta;
 
     if (isArt) {
         // Album Cover Art
         qWarning() << "Requested content is album cover!";
-        meta = cs->makeMetaUsingExtension(id);
-        requestForFileHandler(id, meta, req, resp);
-        delete meta;
+        meta.reset(cs->makeMetaUsingExtension(id));
+        requestForFileHandler(id, meta.get(), req, resp);
         return;
     } else {
-        meta = cs->getMetaForId(id);
+        // Expired meta is not refreshed here, serving must not wait
+        // for probing. Meta is created only if it was never cached.
+        meta = cs->getMetaForId(id, false);
+        if (!meta)
+            meta = cs->getMetaForId(id);
         if (!meta) {
             qWarning() << "No meta item found";
             sendEmptyResponse(resp, 404);
@@ -356,16 +359,16 @@ void ContentServerWorker::requestHandler(QHttpRequest *req, QHttpResponse *resp)
     }
 
     if (isFile) {
-        requestForFileHandler(id, meta, req, resp);
+        requestForFileHandler(id, meta.get(), req, resp);
     } else {
         if (Utils::isUrlScreen(id)) {
-            requestForScreenCaptureHandler(id, meta, req, resp);
+            requestForScreenCaptureHandler(id, meta.get(), req, resp);
         } else if (Utils::isUrlMic(id)) {
-            requestForMicHandler(id, meta, req, resp);
+            requestForMicHandler(id, meta.get(), req, resp);
         } else if (Utils::isUrlPulse(id)) {
-            requestForAudioCaptureHandler(id, meta, req, resp);
+            requestForAudioCaptureHandler(id, meta.get(), req, resp);
         } else {
-            requestForUrlHandler(id, meta, req, resp);
+            requestForUrlHandler(id, meta.get(), req, resp);
         }
     }
 }
@@ -444,7 +447,7 @@ void ContentServerWorker::requestForFileHandler(const QUrl &id,
         }
         streamFile(data.path, data.mime, req, resp);
     } else {
-        streamFile(meta->path, meta->mime, req, resp);
+        streamFile(meta->path, meta->mime, req, resp, meta->dlnaProfile);
     }
 
     qDebug() << "requestForFileHandler done";
@@ -1233,7 +1236,8 @@ void ContentServerWorker::streamFileNoRange(QFile *file,
 }
 
 void ContentServerWorker::streamFile(const QString& path, const QString& mime,
-                           QHttpRequest *req, QHttpResponse *resp)
+                           QHttpRequest *req, QHttpResponse *resp,
+                           const QString &dlnaProfile)
 {
     auto file = new QFile(path);
 
@@ -1254,7 +1258,8 @@ void ContentServerWorker::streamFile(const QString& path, const QString& mime,
         resp->setHeader("Connection", "close");
         resp->setHeader("Cache-Control", "no-cache");
         resp->setHeader("TransferMode.DLNA.ORG", "Streaming");
-        resp->setHeader("contentFeatures.DLNA.ORG", ContentServer::dlnaContentFeaturesHeader(mime));
+        resp->setHeader("contentFeatures.DLNA.ORG",
+                        ContentServer::dlnaContentFeaturesHeader(mime, true, true, dlnaProfile));
 
         if (range) {
             streamFileRange(file, req, resp);
@@ -1358,9 +1363,134 @@ QString ContentServer::dlnaOrgPnFlags(const QString &mime)
     return QString();
 }
 
-QString ContentServer::dlnaContentFeaturesHeader(const QString& mime, bool seek, bool flags)
+QString ContentServer::dlnaProfileFromMeta(const ItemMeta &meta)
+{
+    // Subset of DLNA media format profiles, based on codecs and
+    // resolution detected by libavformat. Demuxer name is shared by
+    // mov/mp4/3gp, so MP4 profiles are given only to MP4 mime types.
+    const bool mp4 = meta.mime == "video/mp4" || meta.mime == "audio/mp4";
+    const bool ts = meta.container == "mpegts";
+    const bool ps = meta.container == "mpeg";
+    const bool stereo = meta.channels > 0 && meta.channels <= 2;
+    const bool sd = meta.width <= 720 && meta.height <= 576;
+    const bool hd = meta.width <= 1920 && meta.height <= 1080;
+    const bool pal = qAbs(meta.frameRate - 25.0) < 0.01 ||
+                     qAbs(meta.frameRate - 50.0) < 0.01;
+
+    if (meta.videoCodec == AV_CODEC_ID_NONE) {
+        switch (meta.audioCodec) {
+        case AV_CODEC_ID_MP3:
+            if (stereo && (meta.sampleRate == 32000 || meta.sampleRate == 44100 ||
+                           meta.sampleRate == 48000))
+                return meta.bitrate <= 320000 ? "MP3" : "MP3X";
+            return QString();
+        case AV_CODEC_ID_AAC:
+            if (!mp4 && meta.container != "aac")
+                return QString();
+            if (meta.audioProfile == FF_PROFILE_AAC_HE ||
+                meta.audioProfile == FF_PROFILE_AAC_HE_V2)
+                return mp4 ? "HEAAC_L2_ISO" : "HEAAC_L2_ADTS";
+            if (!stereo || meta.sampleRate > 48000)
+                return mp4 ? "AAC_MULT5_ISO" : "AAC_MULT5_ADTS";
+            if (meta.bitrate > 0 && meta.bitrate <= 320000)
+                return mp4 ? "AAC_ISO_320" : "AAC_ADTS_320";
+            return mp4 ? "AAC_ISO" : "AAC_ADTS";
+        case AV_CODEC_ID_PCM_S16LE:
+        case AV_CODEC_ID_PCM_S16BE:
+            if (stereo && meta.sampleRate <= 48000)
+                return "LPCM";
+            return QString();
+        case AV_CODEC_ID_WMAV1:
+        case AV_CODEC_ID_WMAV2:
+            return meta.sampleRate <= 48000 && meta.bitrate <= 192999 ?
+                        "WMABASE" : "WMAFULL";
+        case AV_CODEC_ID_WMAPRO:
+            return "WMAPRO";
+        case AV_CODEC_ID_AC3:
+            return "AC3";
+        default:
+            return QString();
+        }
+    }
+
+    const auto audio = meta.audioCodec;
+    const bool aac = audio == AV_CODEC_ID_AAC || audio == AV_CODEC_ID_NONE;
+
+    switch (meta.videoCodec) {
+    case AV_CODEC_ID_H264:
+        // Only Baseline and Main (High for HD) profiles are covered
+        if (meta.videoProfile != FF_PROFILE_H264_BASELINE &&
+            meta.videoProfile != FF_PROFILE_H264_CONSTRAINED_BASELINE &&
+            meta.videoProfile != FF_PROFILE_H264_MAIN &&
+            !(meta.videoProfile == FF_PROFILE_H264_HIGH && mp4 && !sd))
+            return QString();
+        if (mp4) {
+            if (meta.videoProfile == FF_PROFILE_H264_BASELINE ||
+                meta.videoProfile == FF_PROFILE_H264_CONSTRAINED_BASELINE) {
+                if (aac && meta.width <= 352 && meta.height <= 288)
+                    return meta.frameRate <= 15.0 ? "AVC_MP4_BL_CIF15_AAC_520" :
+                                                    "AVC_MP4_BL_CIF30_AAC_940";
+            }
+            if (sd) {
+                if (aac)
+                    return "AVC_MP4_MP_SD_AAC_MULT5";
+                if (audio == AV_CODEC_ID_MP3)
+                    return "AVC_MP4_MP_SD_MPEG1_L3";
+                if (audio == AV_CODEC_ID_AC3)
+                    return "AVC_MP4_MP_SD_AC3";
+                return QString();
+            }
+            if (hd && aac) {
+                if (meta.videoProfile == FF_PROFILE_H264_HIGH)
+                    return "AVC_MP4_HP_HD_AAC";
+                return meta.height <= 720 ? "AVC_MP4_MP_HD_720p_AAC" :
+                                            "AVC_MP4_MP_HD_1080i_AAC";
+            }
+        } else if (ts) {
+            const QString res = sd ? "SD" : hd ? "HD" : QString();
+            if (res.isEmpty())
+                return QString();
+            if (aac)
+                return QString("AVC_TS_MP_%1_AAC_MULT5_ISO").arg(res);
+            if (audio == AV_CODEC_ID_MP3)
+                return QString("AVC_TS_MP_%1_MPEG1_L3_ISO").arg(res);
+            if (audio == AV_CODEC_ID_AC3)
+                return QString("AVC_TS_MP_%1_AC3_ISO").arg(res);
+        }
+        return QString();
+    case AV_CODEC_ID_MPEG2VIDEO:
+        if (ps && sd)
+            return pal ? "MPEG_PS_PAL" : "MPEG_PS_NTSC";
+        if (ts) {
+            if (sd)
+                return pal ? "MPEG_TS_SD_EU_ISO" : "MPEG_TS_SD_NA_ISO";
+            if (hd)
+                return "MPEG_TS_HD_NA_ISO";
+        }
+        return QString();
+    case AV_CODEC_ID_MPEG1VIDEO:
+        return ps ? "MPEG1" : QString();
+    case AV_CODEC_ID_MPEG4:
+        if (mp4 && aac)
+            return meta.videoProfile == FF_PROFILE_MPEG4_SIMPLE ?
+                        "MPEG4_P2_MP4_SP_AAC" : "MPEG4_P2_MP4_ASP_AAC";
+        return QString();
+    case AV_CODEC_ID_WMV3:
+        if (meta.container != "asf")
+            return QString();
+        if (sd && (audio == AV_CODEC_ID_WMAV1 || audio == AV_CODEC_ID_WMAV2))
+            return "WMVMED_BASE";
+        return hd ? "WMVHIGH_FULL" : QString();
+    default:
+        return QString();
+    }
+}
+
+QString ContentServer::dlnaContentFeaturesHeader(const QString& mime, bool seek, bool flags,
+                                                 const QString& profile)
 {
-    QString pnFlags = dlnaOrgPnFlags(mime);
+    QString pnFlags = profile.isEmpty() ? dlnaOrgPnFlags(mime) :
+                                          QString("DLNA.ORG_PN=%1").arg(profile);
     if (pnFlags.isEmpty()) {
         if (flags)
             return QString("%1;%2;%3").arg(
@@ -1616,7 +1746,7 @@ bool ContentServer::getContentMeta(const QString &id, const QUrl &url,
                                            icon,
                                        artCookie);
             QUrl artUrl;
-            if (makeUrl(id, artUrl))
+            if (makeUrl(id, artUrl, url.host()))
                 m << "<upnp:albumArtURI>" << artUrl.toString() << "</upnp:albumArtURI>";
             else
                 qWarning() << "Cannot make Url form art path";
@@ -1669,11 +1799,24 @@ bool ContentServer::getContentMeta(const QString &id, const QUrl &url,
             m << "size=\"" << QString::number(item->size) << "\" ";
         //m << "protocolInfo=\"http-get:*:" << item->mime << ":*\" ";
         m << "protocolInfo=\"http-get:*:" << item->mime << ":"
-          << dlnaContentFeaturesHeader(item->mime, item->seekSupported, false)
+          << dlnaContentFeaturesHeader(item->mime, item->seekSupported, false,
+                                       item->dlnaProfile)
           << "\" ";
-    }
-
-    if (item->duration > 0) {
+        if (item->width > 0 && item->height > 0)
+            m << "resolution=\"" << item->width << "x" << item->height << "\" ";
+    }
+
+    if (item->preciseDuration > 0) {
+        int64_t ms = item->preciseDuration % 1000;
+        int64_t seconds = (item->preciseDuration / 1000) % 60;
+        int64_t minutes = (item->preciseDuration / 60000) % 60;
+        int64_t hours = item->preciseDuration / 3600000;
+        m << "duration=\"" << QString("%1:%2:%3.%4")
+             .arg(hours)
+             .arg(minutes, 2, 10, QChar('0'))
+             .arg(seconds, 2, 10, QChar('0'))
+             .arg(ms, 3, 10, QChar('0')) << "\" ";
+    } else if (item->duration > 0) {
         int seconds = item->duration % 60;
         int minutes = ((item->duration - seconds) / 60) % 60;
         int hours = (item->duration - (minutes * 60) - seconds) / 3600;
@@ -1709,13 +1852,13 @@ bool ContentServer::getContentMeta(const QString &id, const QUrl &url,
 }
 
 bool ContentServer::getContentUrl(const QString &id, QUrl &url, QString &meta,
-                                  QString cUrl)
+                                  QString cUrl, const QString &peer)
 {
     if (!Utils::isIdValid(id)) {
         return false;
     }
 
-    if (!makeUrl(id, url)) {
+    if (!makeUrl(id, url, peer)) {
         qWarning() << "Cannot make Url form id";
         return false;
     }
@@ -1731,7 +1874,7 @@ bool ContentServer::getContentUrl(const QString &id, QUrl &url, QString &meta,
         return false;
     }
 
-    if (!getContentMeta(id, url, meta, item)) {
+    if (!getContentMeta(id, url, meta, item.get())) {
         qWarning() << "Cannot get content meta data";
         return false;
     }
@@ -1755,12 +1898,16 @@ QString ContentServer::bestName(const ContentServer::ItemMeta &meta)
     return name;
 }
 
-bool ContentServer::makeUrl(const QString& id, QUrl& url)
+bool ContentServer::makeUrl(const QString& id, QUrl& url, const QString& peer)
 {
     QString hash = QString::fromUtf8(encrypt(id.toUtf8()));
 
+    // Server listens on all interfaces, so address is the one
+    // that is reachable from peer
     QString ifname, addr;
-    if (!Utils::instance()->getNetworkIf(ifname, addr)) {
+    if (!(peer.isEmpty() ?
+          Utils::instance()->getNetworkIf(ifname, addr) :
+          Utils::instance()->getNetworkIfFor(peer, ifname, addr))) {
         qWarning() << "Cannot find valid network interface";
         return false;
     }
@@ -2190,23 +2337,62 @@ bool ContentServer::extractAudio(const QString& path,
     return true;
 }
 
-const ContentServer::ItemMeta* ContentServer::getMeta(const QUrl &url, bool createNew)
+std::shared_ptr<const ContentServer::ItemMeta>
+ContentServer::getMeta(const QUrl &url, bool createNew)
 {
+    std::shared_ptr<const ItemMeta> meta;
+
     metaCacheMutex.lock();
     auto it = getMetaCacheIterator(url, createNew);
-    auto meta = it == metaCache.end() ? nullptr : &it.value();
+    if (it != metaCache.end())
+        meta = it.value();
     metaCacheMutex.unlock();
 
     return meta;
 }
 
-const ContentServer::ItemMeta* ContentServer::getMetaForId(const QUrl &id, bool createNew)
+std::shared_ptr<const ContentServer::ItemMeta>
+ContentServer::getMetaForId(const QUrl &id, bool createNew)
 {
     auto url = Utils::urlFromId(id);
     return getMeta(url, createNew);
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+// Remote meta data older than remoteMetaTtl is probed again. Probing is
+// done without lock. Expired item can be replaced in the cache, because
+// users hold their own references to it.
+std::shared_ptr<const ContentServer::ItemMeta>
+ContentServer::getMetaRefreshed(const QUrl &url)
+{
+    std::shared_ptr<const ItemMeta> meta;
+
+    metaCacheMutex.lock();
+    auto it = getMetaCacheIterator(url, true);
+    if (it != metaCache.end())
+        meta = it.value();
+    metaCacheMutex.unlock();
+
+    if (!meta || meta->local || meta->timestamp <= 0 ||
+        QDateTime::currentMSecsSinceEpoch() - meta->timestamp <= remoteMetaTtl)
+        return meta;
+
+    qDebug() << "Meta data for" << url << "expired";
+
+    ItemMeta newMeta;
+    if (!makeRemoteMeta(url, newMeta)) {
+        qWarning() << "Cannot refresh meta data, using old one";
+        return meta;
+    }
+
+    auto newPtr = std::make_shared<ItemMeta>(newMeta);
+
+    QMutexLocker locker(&metaCacheMutex);
+    metaCache.insert(url, newPtr);
+
+    return newPtr;
+}
+
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::getMetaCacheIterator(const QUrl &url, bool createNew)
 {    
     const auto i = metaCache.find(url);
@@ -2222,20 +2408,20 @@ ContentServer::getMetaCacheIterator(const QUrl &url, bool createNew)
     return i;
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::getMetaCacheIteratorForId(const QUrl &id, bool createNew)
 {
     auto url = Utils::urlFromId(id);
     return getMetaCacheIterator(url, createNew);
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::metaCacheIteratorEnd()
 {
     return metaCache.end();
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeItemMetaUsingTracker(const QUrl &url)
 {
     const QString fileUrl = url.toString(QUrl::EncodeUnicode|QUrl::EncodeSpaces);
@@ -2267,7 +2453,9 @@ ContentServer::makeItemMetaUsingTracker(const QUrl &url)
 
             QFileInfo file(path);
 
-            auto& meta = metaCache[url];
+            auto ptr = std::make_shared<ItemMeta>();
+            metaCache.insert(url, ptr);
+            auto& meta = *ptr;
             meta.valid = true;
             meta.trackerId = cursor.value(0).toString();
             meta.url = url;
@@ -2319,7 +2507,7 @@ void ContentServer::updateMetaUsingTaglib(const QString& path, const QString& ti
     }
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeItemMetaUsingTaglib(const QUrl &url)
 {
     QString path = url.toLocalFile();
@@ -2372,10 +2560,139 @@ ContentServer::makeItemMetaUsingTaglib(const QUrl &url)
             meta.album = tr("Unknown");*/
     }
 
-    return metaCache.insert(url, meta);
+    return metaCache.insert(url, std::make_shared<ItemMeta>(meta));
+}
+
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
+ContentServer::makeItemMetaUsingAvProbe(const QUrl &url)
+{
+    const QString path = url.toLocalFile();
+    const auto type = getContentTypeByExtension(path);
+
+    if (type != TypeMusic && type != TypeVideo) {
+        // Images and playlists are not probed
+        return metaCache.end();
+    }
+
+    auto f = path.toUtf8();
+    AVFormatContext *ic = nullptr;
+    AVDictionary *opts = nullptr;
+
+    // Only header and index are needed, so limiting how much
+    // data is read to find stream parameters
+    av_dict_set_int(&opts, "probesize", avProbeSize, 0);
+    av_dict_set_int(&opts, "analyzeduration", avAnalyzeDuration, 0);
+
+    if (avformat_open_input(&ic, f.constData(), nullptr, &opts) < 0) {
+        qWarning() << "avformat_open_input error";
+        av_dict_free(&opts);
+        return metaCache.end();
+    }
+
+    av_dict_free(&opts);
+
+    if (avformat_find_stream_info(ic, nullptr) < 0) {
+        qWarning() << "avformat_find_stream_info error";
+        avformat_close_input(&ic);
+        return metaCache.end();
+    }
+
+    AVStream *as = nullptr;
+    AVStream *vs = nullptr;
+    for (unsigned int i = 0; i < ic->nb_streams; ++i) {
+        auto stream = ic->streams[i];
+        auto codec = stream->codecpar;
+        if (!as && codec->codec_type == AVMEDIA_TYPE_AUDIO) {
+            as = stream;
+        } else if (!vs && codec->codec_type == AVMEDIA_TYPE_VIDEO &&
+                   !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            // Cover art is reported as a video stream
+            vs = stream;
+        }
+    }
+
+    if (!as && !vs) {
+        qWarning() << "No audio or video stream found";
+        avformat_close_input(&ic);
+        return metaCache.end();
+    }
+
+    QFileInfo file(path);
+
+    ContentServer::ItemMeta meta;
+    meta.valid = true;
+    meta.url = url;
+    meta.path = path;
+    meta.mime = getContentMimeByExtension(path);
+    meta.type = type;
+    meta.size = file.size();
+    meta.filename = file.fileName();
+    meta.local = true;
+    meta.seekSupported = true;
+    meta.container = QString::fromLatin1(ic->iformat->name);
+
+    if (ic->duration != AV_NOPTS_VALUE && ic->duration > 0) {
+        meta.preciseDuration = ic->duration / (AV_TIME_BASE / 1000);
+        meta.duration = static_cast<int>(ic->duration / AV_TIME_BASE);
+    }
+
+    if (ic->bit_rate > 0)
+        meta.bitrate = ic->bit_rate;
+
+    if (as) {
+        auto codec = as->codecpar;
+        meta.audioCodec = codec->codec_id;
+        meta.audioProfile = codec->profile;
+        meta.sampleRate = codec->sample_rate;
+        meta.channels = codec->channels;
+        if (!vs && codec->bit_rate > 0)
+            meta.bitrate = codec->bit_rate;
+    }
+
+    if (vs) {
+        auto codec = vs->codecpar;
+        meta.videoCodec = codec->codec_id;
+        meta.videoProfile = codec->profile;
+        meta.width = codec->width;
+        meta.height = codec->height;
+        auto rate = vs->avg_frame_rate.num > 0 ? vs->avg_frame_rate : vs->r_frame_rate;
+        if (rate.num > 0 && rate.den > 0)
+            meta.frameRate = av_q2d(rate);
+    }
+
+    auto tag = [ic, as](const char* key) -> QString {
+        // Ogg keeps tags in the stream, other containers in the format context
+        auto e = av_dict_get(ic->metadata, key, nullptr, 0);
+        if (!e && as)
+            e = av_dict_get(as->metadata, key, nullptr, 0);
+        return e ? QString::fromUtf8(e->value) : QString();
+    };
+
+    meta.title = tag("title");
+    meta.artist = tag("artist");
+    meta.album = tag("album");
+    meta.comment = tag("comment");
+
+    avformat_close_input(&ic);
+
+    meta.dlnaProfile = dlnaProfileFromMeta(meta);
+
+    qDebug() << "Probed:" << meta.container << meta.audioCodec << meta.videoCodec
+             << meta.width << meta.height << meta.frameRate << meta.preciseDuration
+             << meta.dlnaProfile;
+
+    if (meta.type == TypeMusic) {
+#ifdef SAILFISH
+        meta.albumArt = Tracker::instance()->genAlbumArtFile(meta.album, meta.artist);
+#endif
+        if (meta.albumArt.isEmpty() && meta.mime == "audio/mpeg")
+            fillCoverArt(meta);
+    }
+
+    return metaCache.insert(url, std::make_shared<ItemMeta>(meta));
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeMicItemMeta(const QUrl &url)
 {
     // modes:
@@ -2399,10 +2716,10 @@ ContentServer::makeMicItemMeta(const QUrl &url)
     meta.albumArt = IconProvider::pathToId("icon-x-mic-cover");
 #endif
 
-    return metaCache.insert(url, meta);
+    return metaCache.insert(url, std::make_shared<ItemMeta>(meta));
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeAudioCaptureItemMeta(const QUrl &url)
 {
     // modes:
@@ -2423,10 +2740,10 @@ ContentServer::makeAudioCaptureItemMeta(const QUrl &url)
     meta.albumArt = IconProvider::pathToId("icon-x-pulse-cover");
 #endif
 
-    return metaCache.insert(url, meta);
+    return metaCache.insert(url, std::make_shared<ItemMeta>(meta));
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeScreenCaptureItemMeta(const QUrl &url)
 {
     ContentServer::ItemMeta meta;
@@ -2442,7 +2759,7 @@ ContentServer::makeScreenCaptureItemMeta(const QUrl &url)
     meta.albumArt = IconProvider::pathToId("icon-x-screen-cover");
 #endif
 
-    return metaCache.insert(url, meta);
+    return metaCache.insert(url, std::make_shared<ItemMeta>(meta));
 }
 
 QString ContentServer::mimeFromDisposition(const QString &disposition)
@@ -2467,26 +2784,124 @@ QString ContentServer::mimeFromDisposition(const QString &disposition)
     return mime;
 }
 
+QString ContentServer::mimeFromReply(const QNetworkReply *reply)
+{
+    // Bug in Qt? "Content-Disposition" cannot be retrived with QNetworkRequest::ContentDispositionHeader
+    //auto disposition = reply->header(QNetworkRequest::ContentDispositionHeader).toString().toLower();
+    auto disposition = QString(reply->rawHeader("Content-Disposition")).toLower();
+    auto mime = mimeFromDisposition(disposition);
+    if (mime.isEmpty())
+        mime = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+    // Removing parameters, e.g. "audio/mpeg; charset=UTF-8"
+    return mime.split(';').first().trimmed();
+}
+
+bool ContentServer::mimeIsGeneric(const QString &mime)
+{
+    return mime.isEmpty() ||
+           mime == "application/octet-stream" ||
+           mime == "binary/octet-stream" ||
+           mime == "application/x-octet-stream" ||
+           mime == "application/download" ||
+           mime == "text/plain";
+}
+
+QString ContentServer::mimeFromData(const QByteArray &data)
+{
+    if (data.size() < 12)
+        return QString();
+
+    auto d = reinterpret_cast<const unsigned char*>(data.constData());
+
+    // Playlists
+    auto head = data.left(256).trimmed();
+    if (head.startsWith("#EXTM3U"))
+        return "application/x-mpegurl";
+    if (head.toLower().startsWith("[playlist]"))
+        return "audio/x-scpls";
+    if (head.startsWith("<?xml") && data.left(1024).contains("<playlist"))
+        return "application/xspf+xml";
+
+    // Containers
+    if (data.startsWith("fLaC"))
+        return "audio/flac";
+    if (data.startsWith("OggS"))
+        return data.left(64).contains("theora") ? "video/ogg" : "audio/ogg";
+    if (data.startsWith("RIFF")) {
+        if (data.mid(8, 4) == "WAVE")
+            return "audio/vnd.wav";
+        if (data.mid(8, 4) == "AVI ")
+            return "video/x-msvideo";
+    }
+    if (data.mid(4, 4) == "ftyp") {
+        auto brand = data.mid(8, 4);
+        if (brand == "qt  ")
+            return "video/quicktime";
+        return brand == "M4A " || brand == "M4B " ? "audio/mp4" : "video/mp4";
+    }
+    if (d[0] == 0x1A && d[1] == 0x45 && d[2] == 0xDF && d[3] == 0xA3)
+        return data.left(64).contains("webm") ? "video/webm" : "video/x-matroska";
+    if (data.startsWith("FLV"))
+        return "video/x-flv";
+    if (d[0] == 0x30 && d[1] == 0x26 && d[2] == 0xB2 && d[3] == 0x75)
+        return "video/x-ms-wmv";
+    if (d[0] == 0x00 && d[1] == 0x00 && d[2] == 0x01 && d[3] == 0xBA)
+        return "video/mpeg";
+    if (data.size() > 188 && d[0] == 0x47 && d[188] == 0x47)
+        return "video/MP2T";
+
+    // Images
+    if (d[0] == 0xFF && d[1] == 0xD8 && d[2] == 0xFF)
+        return "image/jpeg";
+    if (data.startsWith("\x89PNG"))
+        return "image/png";
+    if (data.startsWith("GIF8"))
+        return "image/gif";
+
+    // Elementary audio streams
+    if (data.startsWith("ID3"))
+        return "audio/mpeg";
+    if (d[0] == 0xFF && (d[1] & 0xF6) == 0xF0)
+        return "audio/aac"; // ADTS
+    if (d[0] == 0xFF && (d[1] & 0xE0) == 0xE0 && (d[1] & 0x06) != 0)
+        return "audio/mpeg";
+
+    return QString();
+}
+
 bool ContentServer::hlsPlaylist(const QByteArray &data)
 {
     return data.contains("#EXT-X-");
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
-ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
-                                            std::shared_ptr<QNetworkAccessManager> nam,
-                                            int counter)
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
+ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url)
+{
+    ItemMeta meta;
+    if (!makeRemoteMeta(url, meta))
+        return metaCache.end();
+    // Meta is cached for final URL, i.e. after redirections
+    return metaCache.insert(meta.url, std::make_shared<ItemMeta>(meta));
+}
+
+bool ContentServer::makeRemoteMeta(const QUrl &url, ItemMeta &meta,
+                                   std::shared_ptr<QNetworkAccessManager> nam,
+                                   int counter)
 {
     qDebug() << ">> makeItemMetaUsingHTTPRequest in thread:" << QThread::currentThreadId();
     if (counter >= maxRedirections) {
         qWarning() << "Max redirections reached";
-        return metaCache.end();
+        return false;
     }
 
     qDebug() << "Sending HTTP request for url:" << url;
     QNetworkRequest request;
     request.setUrl(url);
     request.setRawHeader("User-Agent", userAgent);
+    // Asking only for the beginning of the content, enough to get headers,
+    // small playlists and data for content sniffing
+    request.setRawHeader("Range", QByteArray("bytes=0-") +
+                         QByteArray::number(remoteProbeSize - 1));
     request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
 
     if (!nam) {
@@ -2502,29 +2917,37 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
 
     auto reply = nam->get(request);
 
+    QByteArray data;
+    bool playlist = false;
+
     QEventLoop loop;
-    connect(reply, &QNetworkReply::metaDataChanged, [reply]{
+    connect(reply, &QNetworkReply::metaDataChanged, &loop, [reply, &playlist]{
         qDebug() << ">> metaDataChanged in thread:" << QThread::currentThreadId();
         qDebug() << "Received meta data of HTTP reply for url:" << reply->url();
 
-        // Bug in Qt? "Content-Disposition" cannot be retrived with QNetworkRequest::ContentDispositionHeader
-        //auto disposition = reply->header(QNetworkRequest::ContentDispositionHeader).toString().toLower();
-        auto disposition = QString(reply->rawHeader("Content-Disposition")).toLower();
-
-        auto mime = mimeFromDisposition(disposition);
-        if (mime.isEmpty())
-            mime = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+        auto mime = mimeFromReply(reply);
         auto type = typeFromMime(mime);
 
         if (type == ContentServer::TypePlaylist) {
             qDebug() << "Content is a playlist";
             // Content is needed, so not aborting
+            playlist = true;
+        } else if (mimeIsGeneric(mime)) {
+            qDebug() << "Content type is missing or generic:" << mime;
+            // Beginning of content is needed for sniffing, so not aborting
         } else {
             // Content is no needed, so aborting
             if (!reply->isFinished())
                 reply->abort();
         }
     });
+    connect(reply, &QNetworkReply::readyRead, &loop, [reply, &data, &playlist]{
+        data.append(reply->readAll());
+        if (!playlist && data.size() >= sniffSize && !reply->isFinished()) {
+            qDebug() << "Enough data for sniffing received";
+            reply->abort();
+        }
+    });
     connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
     QTimer::singleShot(httpTimeout, &loop, &QEventLoop::quit); // timeout
     loop.exec(); // waiting for HTTP reply...
@@ -2533,7 +2956,7 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
         qWarning() << "Timeout occured";
         reply->abort();
         reply->deleteLater();
-        return metaCache.end();
+        return false;
     }
 
     qDebug() << "Received HTTP reply for url:" << url;
@@ -2552,7 +2975,7 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
         error != QNetworkReply::OperationCanceledError) {
         qWarning() << "Error:" << error;
         reply->deleteLater();
-        return metaCache.end();
+        return false;
     }
 
     if (code > 299 && code < 399) {
@@ -2562,36 +2985,43 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
             newUrl = url.resolved(newUrl);
         reply->deleteLater();
         if (newUrl.isValid())
-            return makeItemMetaUsingHTTPRequest(newUrl, nam, counter + 1);
+            return makeRemoteMeta(newUrl, meta, nam, counter + 1);
         else
-            return metaCache.end();
+            return false;
     }
 
     if (code > 299) {
         qWarning() << "Unsupported response code:" << reply->error() << code << reason;
         reply->deleteLater();
-        return metaCache.end();
+        return false;
     }
 
-    // Bug in Qt? "Content-Disposition" cannot be retrived with QNetworkRequest::ContentDispositionHeader
-    //auto disposition = reply->header(QNetworkRequest::ContentDispositionHeader).toString().toLower();
-    auto disposition = QString(reply->rawHeader("Content-Disposition")).toLower();
-    auto mime = mimeFromDisposition(disposition);
-    if (mime.isEmpty())
-        mime = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+    if (error == QNetworkReply::NoError)
+        data.append(reply->readAll());
+
+    auto mime = mimeFromReply(reply);
+    if (mimeIsGeneric(mime)) {
+        auto sniffedMime = mimeFromData(data);
+        if (sniffedMime.isEmpty()) {
+            auto extMime = getContentMimeByExtension(url);
+            qDebug() << "Cannot sniff content type, using extension:" << extMime;
+            mime = extMime;
+        } else {
+            qDebug() << "Sniffed content type:" << sniffedMime;
+            mime = sniffedMime;
+        }
+    }
     auto type = typeFromMime(mime);
 
     if (type == ContentServer::TypePlaylist) {
         qDebug() << "Content is a playlist";
 
-        auto size = reply->bytesAvailable();
-        if (size > 0) {
+        if (!data.isEmpty()) {
             auto ptype = playlistTypeFromMime(mime);
-            auto data = reply->readAll();
 
             if (hlsPlaylist(data)) {
                 qDebug() <<  "HLS playlist";
-                ContentServer::ItemMeta meta;
+                meta = ContentServer::ItemMeta();
                 meta.valid = true;
                 meta.url = url;
                 meta.mime = mime;
@@ -2600,42 +3030,49 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
                 meta.local = false;
                 meta.seekSupported = false;
                 meta.mode = 2; // playlist proxy
+                meta.timestamp = QDateTime::currentMSecsSinceEpoch();
                 reply->deleteLater();
-                return metaCache.insert(url, meta);
+                return true;
             } else {
-                auto items = ptype == PlaylistPLS ?
-                             parsePls(data, reply->url().toString()) :
-                                ptype == PlaylistXSPF ?
-                                parseXspf(data, reply->url().toString()) :
-                                    parseM3u(data, reply->url().toString());
+                auto items = parsePlaylist(data, ptype, reply->url().toString());
                 if (!items.isEmpty()) {
                     QUrl url = items.first().url;
                     qDebug() << "Trying get meta data for first item in the playlist:" << url;
                     reply->deleteLater();
-                    return makeItemMetaUsingHTTPRequest(url, nam, counter + 1);
+                    return makeRemoteMeta(url, meta, nam, counter + 1);
                 }
             }
         }
 
         qWarning() << "Playlist content is empty";
         reply->deleteLater();
-        return metaCache.end();
+        return false;
     }
 
     if (type != TypeMusic && type != TypeVideo && type != TypeImage) {
         qWarning() << "Unsupported type";
         reply->deleteLater();
-        return metaCache.end();
+        return false;
     }
 
-    auto ranges = QString(reply->rawHeader("Accept-Ranges")).toLower().contains("bytes");
-    int size = reply->header(QNetworkRequest::ContentLengthHeader).toInt();
+    bool ranges; int64_t size = 0;
+    if (code == 206) {
+        // Partial content, so ranges are supported and total
+        // size is in Content-Range header, e.g. "bytes 0-65535/1234567"
+        ranges = true;
+        auto total = reply->rawHeader("Content-Range").split('/').last();
+        if (total != "*")
+            size = total.toLongLong();
+    } else {
+        ranges = QString(reply->rawHeader("Accept-Ranges")).toLower().contains("bytes");
+        size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    }
 
     const QByteArray icy_name_h = "icy-name";
     const QByteArray icy_br_h = "icy-br";
     const QByteArray icy_sr_h = "icy-sr";
 
-    ContentServer::ItemMeta meta;
+    meta = ContentServer::ItemMeta();
     meta.valid = true;
     meta.url = url;
     meta.mime = mime;
@@ -2644,6 +3081,7 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
     meta.filename = url.fileName();
     meta.local = false;
     meta.seekSupported = size > 0 ? ranges : false;
+    meta.timestamp = QDateTime::currentMSecsSinceEpoch();
 
     if (reply->hasRawHeader(icy_name_h))
         meta.title = QString(reply->rawHeader(icy_name_h));
@@ -2655,13 +3093,13 @@ ContentServer::makeItemMetaUsingHTTPRequest(const QUrl &url,
         meta.sampleRate = reply->rawHeader(icy_sr_h).toDouble();*/
 
     reply->deleteLater();
-    return metaCache.insert(url, meta);
+    return true;
 }
 
-/*const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+/*const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeItemMetaUsingExtension(const QUrl &url)
 {
-    return metaCache.insert(url, makeItemMetaUsingExtension2(url));
+    return metaCache.insert(url, std::make_shared<ItemMeta>(makeItemMetaUsingExtension2(url)));
 }*/
 
 ContentServer::ItemMeta*
@@ -2681,13 +3119,17 @@ ContentServer::makeMetaUsingExtension(const QUrl &url)
     return item;
 }
 
-const QHash<QUrl, ContentServer::ItemMeta>::const_iterator
+const QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator
 ContentServer::makeItemMeta(const QUrl &url)
 {
-    QHash<QUrl, ContentServer::ItemMeta>::const_iterator it;
+    QHash<QUrl, std::shared_ptr<ContentServer::ItemMeta>>::const_iterator it;
     if (url.isLocalFile()) {
         if (QFile::exists(url.toLocalFile())) {
-            it = makeItemMetaUsingTracker(url);
+            it = makeItemMetaUsingAvProbe(url);
+            if (it == metaCache.end()) {
+                qDebug() << "Cannot get meta using libavformat, so fallbacking to Tracker";
+                it = makeItemMetaUsingTracker(url);
+            }
             if (it == metaCache.end()) {
                 qWarning() << "Cannot get meta using Tacker, so fallbacking to Taglib";
                 it = makeItemMetaUsingTaglib(url);
@@ -2716,8 +3158,28 @@ ContentServer::makeItemMeta(const QUrl &url)
         qDebug() << "Unsupported Jupii URL detected";
         it = metaCache.end();
     } else {
-        qDebug() << "Geting meta using HTTP request";
-        it = makeItemMetaUsingHTTPRequest(url);
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        const auto failed = metaFailureCache.find(url);
+        if (failed != metaFailureCache.end() &&
+            now - failed.value() < remoteMetaFailureTtl) {
+            qWarning() << "HTTP request for url failed recently, not retrying:" << url;
+            it = metaCache.end();
+        } else {
+            qDebug() << "Geting meta using HTTP request";
+            it = makeItemMetaUsingHTTPRequest(url);
+            if (it == metaCache.end()) {
+                // Expired failures are dropped, so cache doesn't grow
+                for (auto f = metaFailureCache.begin(); f != metaFailureCache.end();) {
+                    if (now - f.value() >= remoteMetaFailureTtl)
+                        f = metaFailureCache.erase(f);
+                    else
+                        ++f;
+                }
+                metaFailureCache.insert(url, now);
+            } else {
+                metaFailureCache.remove(url);
+            }
+        }
     }
     /*if (it == metaCache.end()) {
         qWarning() << "Fallbacking to extension";
@@ -2857,103 +3319,210 @@ void ContentServer::shoutcastMetadataHandler(const QUrl &id,
     emit streamTitleChanged(id, stream.title);
 }
 
+// Calls 'handler' for every line in data. Line is passed as pointer to
+// data and length (without line break), so nothing is copied.
+// Handler returns false to stop.
+template<typename Handler>
+static void forEachLine(const QByteArray &data, Handler handler)
+{
+    const char *p = data.constData();
+    const char *end = p + data.size();
+
+    while (p < end) {
+        auto nl = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+        auto le = nl ? nl : end;
+        auto e = le;
+        if (e > p && e[-1] == '\r')
+            --e;
+        if (!handler(p, int(e - p)))
+            return;
+        p = le + 1;
+    }
+}
+
+static inline bool startsWithNoCase(const char *p, int len,
+                                    const char *prefix, int plen)
+{
+    return len >= plen && qstrnicmp(p, prefix, uint(plen)) == 0;
+}
+
+static inline void trimLine(const char *&p, int &len)
+{
+    while (len > 0 && (*p == ' ' || *p == '\t')) { ++p; --len; }
+    while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) --len;
+}
+
+// Parses leading decimal integer, returns -1 when there is no number
+static int parseInt(const char *&p, const char *end)
+{
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+
+    if (p >= end || *p < '0' || *p > '9')
+        return -1;
+
+    int n = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        n = n * 10 + (*p++ - '0');
+
+    return neg ? -n : n;
+}
+
+// Data without BOM and in UTF-8, when data is already in UTF-8
+// no copy is made
+static QByteArray utf8Data(const QByteArray &data)
+{
+    if (data.startsWith("\xEF\xBB\xBF"))
+        return QByteArray::fromRawData(data.constData() + 3, data.size() - 3);
+
+    if (data.startsWith("\xFF\xFE") || data.startsWith("\xFE\xFF")) {
+        auto codec = QTextCodec::codecForUtfText(data);
+        auto text = codec->toUnicode(data);
+        if (!text.isEmpty() && text.at(0) == QChar::ByteOrderMark)
+            text.remove(0, 1);
+        return text.toUtf8();
+    }
+
+    return data;
+}
+
+QList<ContentServer::PlaylistItemMeta>
+ContentServer::parsePlaylist(const QByteArray &data, PlaylistType type,
+                             const QString context)
+{
+    return type == PlaylistPLS ? parsePls(data, context) :
+                   type == PlaylistXSPF ? parseXspf(data, context) :
+                                          parseM3u(data, context);
+}
+
+QList<ContentServer::PlaylistItemMeta>
+ContentServer::parsePlaylistFile(const QString &path)
+{
+    QList<PlaylistItemMeta> list;
+
+    QFile f(path);
+    if (!f.exists()) {
+        qWarning() << "File" << path << "doesn't exist";
+        return list;
+    }
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open file" << path <<
+                      "for reading (" + f.errorString() + ")";
+        return list;
+    }
+
+    // File is mapped to memory instead of being read, parsers
+    // use data directly
+    const auto size = f.size();
+    uchar *map = size > 0 ? f.map(0, size) : nullptr;
+    auto data = map ? QByteArray::fromRawData(reinterpret_cast<const char*>(map), int(size)) :
+                      f.readAll();
+
+    if (data.isEmpty()) {
+        qWarning() << "Playlist content is empty";
+    } else {
+        auto dir = QFileInfo(f).absoluteDir().path();
+        list = parsePlaylist(data, playlistTypeFromExtension(path), dir);
+        if (list.isEmpty())
+            qWarning() << "Playlist doesn't contain any valid items";
+    }
+
+    if (map)
+        f.unmap(map);
+
+    return list;
+}
+
 QList<ContentServer::PlaylistItemMeta>
 ContentServer::parsePls(const QByteArray &data, const QString context)
 {
     qDebug() << "Parsing PLS playlist";
     QMap<int,ContentServer::PlaylistItemMeta> map;
-    int pos;
-
-    // urls
-    QRegExp rxFile("\\nFile(\\d\\d?)=([^\\n]*)", Qt::CaseInsensitive);
-    pos = 0;
-    while ((pos = rxFile.indexIn(data, pos)) != -1) {
-        QString cap1 = rxFile.cap(1);
-        QString cap2 = rxFile.cap(2);
-        qDebug() << "cap:" << cap1 << cap2;
-
-        bool ok;
-        int n = cap1.toInt(&ok);
-        if (ok) {
-            auto url = Utils::urlFromText(cap2, context);
-            if (!url.isEmpty()) {
-                auto &item = map[n];
-                item.url = url;
-            } else {
-                qWarning() << "Playlist item url is invalid";
-            }
+
+    forEachLine(utf8Data(data), [&map, &context](const char *p, int len) {
+        trimLine(p, len);
+
+        enum { File, Title, Length } key;
+        if (startsWithNoCase(p, len, "file", 4)) {
+            key = File; p += 4; len -= 4;
+        } else if (startsWithNoCase(p, len, "title", 5)) {
+            key = Title; p += 5; len -= 5;
+        } else if (startsWithNoCase(p, len, "length", 6)) {
+            key = Length; p += 6; len -= 6;
         } else {
-            qWarning() << "Playlist item no is invalid";
+            return true;
         }
 
-        pos += rxFile.matchedLength();
-    }
-
-    if (!map.isEmpty()) {
-        // titles
-        QRegExp rxTitle("\\nTitle(\\d\\d?)=([^\\n]*)", Qt::CaseInsensitive);
-        pos = 0;
-        while ((pos = rxTitle.indexIn(data, pos)) != -1) {
-            QString cap1 = rxTitle.cap(1);
-            QString cap2 = rxTitle.cap(2);
-            qDebug() << "cap:" << cap1 << cap2;
+        const char *end = p + len;
+        if (p < end && (*p == '-' || *p == '+'))
+            return true;
+        int n = parseInt(p, end);
+        if (n < 0 || p >= end || *p != '=')
+            return true;
+        ++p;
+
+        const int vlen = int(end - p);
+        switch (key) {
+        case File: {
+            auto url = Utils::urlFromText(QString::fromUtf8(p, vlen), context);
+            if (!url.isEmpty())
+                map[n].url = url;
+            else
+                qWarning() << "Playlist item url is invalid";
+            break;
+        }
+        case Title:
+            map[n].title = QString::fromUtf8(p, vlen);
+            break;
+        case Length: {
+            int length = parseInt(p, end);
+            if (p == end)
+                map[n].length = length < 0 ? 0 : length;
+            break;
+        }
+        }
 
-            bool ok;
-            int n = cap1.toInt(&ok);
-            if (ok && map.contains(n)) {
-                auto &item = map[n];
-                item.title = cap2;
-            }
+        return true;
+    });
 
-            pos += rxTitle.matchedLength();
-        }
-
-        // length
-        QRegExp rxLength("\\nLength(\\d\\d?)=([^\\n]*)", Qt::CaseInsensitive);
-        pos = 0;
-        while ((pos = rxLength.indexIn(data, pos)) != -1) {
-            QString cap1 = rxLength.cap(1);
-            QString cap2 = rxLength.cap(2);
-            qDebug() << "cap:" << cap1 << cap2;
-
-            bool ok;
-            int n = cap1.toInt(&ok);
-            if (ok && map.contains(n)) {
-                bool ok;
-                int length = cap2.toInt(&ok);
-                if (ok) {
-                    auto &item = map[n];
-                    item.length = length < 0 ? 0 : length;
-                }
-            }
+    QList<ContentServer::PlaylistItemMeta> list;
+    list.reserve(map.size());
+    for (const auto &item : map) {
+        // title or length without file
+        if (!item.url.isEmpty())
+            list << item;
+    }
 
-            pos += rxLength.matchedLength();
-        }
-    } else {
+    if (list.isEmpty())
         qWarning() << "Playlist doesn't contain any URLs";
-    }
+    else
+        qDebug() << "PLS playlist items:" << list.size();
 
-    return map.values();
+    return list;
 }
 
 void ContentServer::resolveM3u(QByteArray &data, const QString context)
 {
-    QStringList lines;
+    QByteArray out;
+    out.reserve(data.size() + data.size() / 8);
 
-    QTextStream s(data, QIODevice::ReadOnly);
-    s.setAutoDetectUnicode(true);
-
-    while (!s.atEnd()) {
-        auto line = s.readLine();
-        if (!line.startsWith("#"))
-            lines << line;
-    }
+    forEachLine(utf8Data(data), [&out, &context](const char *p, int len) {
+        const char *lp = p; int llen = len;
+        trimLine(lp, llen);
+        if (llen > 0 && *lp != '#') {
+            auto url = Utils::urlFromText(QString::fromUtf8(lp, llen), context);
+            if (!url.isEmpty()) {
+                out.append(url.toString().toUtf8()).append('\n');
+                return true;
+            }
+        }
+        out.append(p, len).append('\n');
+        return true;
+    });
 
-    for (const auto& line : lines) {
-        auto url = Utils::urlFromText(line, context);
-        if (!url.isEmpty())
-            data.replace(line, url.toString().toUtf8());
-    }
+    data = out;
 }
 
 QList<ContentServer::PlaylistItemMeta>
@@ -2963,23 +3532,43 @@ ContentServer::parseM3u(const QByteArray &data, const QString context)
 
     QList<ContentServer::PlaylistItemMeta> list;
 
-    QTextStream s(data, QIODevice::ReadOnly);
-    s.setAutoDetectUnicode(true);
-
-    while (!s.atEnd()) {
-        auto line = s.readLine();
-        if (line.startsWith("#")) {
-            // TODO: read title from M3U playlist
-        } else {
-            auto url = Utils::urlFromText(line, context);
-            if (!url.isEmpty()) {
-                PlaylistItemMeta item;
-                item.url = url;
-                qDebug() << url;
-                list.append(item);
+    // Title and length from #EXTINF line are used for next URL
+    PlaylistItemMeta info;
+
+    forEachLine(utf8Data(data), [&list, &info, &context](const char *p, int len) {
+        trimLine(p, len);
+        if (len == 0)
+            return true;
+
+        if (*p == '#') {
+            if (startsWithNoCase(p, len, "#EXTINF:", 8)) {
+                // #EXTINF:<length> [attributes],<title>
+                const char *end = p + len;
+                const char *v = p + 8;
+                int length = parseInt(v, end);
+                info.length = length < 0 ? 0 : length;
+                auto comma = static_cast<const char*>(memchr(v, ',', size_t(end - v)));
+                if (comma) {
+                    ++comma;
+                    int tlen = int(end - comma);
+                    trimLine(comma, tlen);
+                    info.title = QString::fromUtf8(comma, tlen);
+                }
             }
+            return true;
         }
-    }
+
+        auto url = Utils::urlFromText(QString::fromUtf8(p, len), context);
+        if (!url.isEmpty()) {
+            info.url = url;
+            list.append(info);
+        }
+        info = PlaylistItemMeta();
+
+        return true;
+    });
+
+    qDebug() << "M3U playlist items:" << list.size();
 
     return list;
 }
@@ -2990,52 +3579,46 @@ ContentServer::parseXspf(const QByteArray &data, const QString context)
     qDebug() << "Parsing XSPF playlist";
     QList<ContentServer::PlaylistItemMeta> list;
 
-    QDomDocument doc; QString error;
-    if (doc.setContent(data, false, &error)) {
-        auto tracks = doc.elementsByTagName("track");
-        int l = tracks.length();
-        for (int i = 0; i < l; ++i) {
-            auto track = tracks.at(i).toElement();
-            if (!track.isNull()) {
-                auto ls = track.elementsByTagName("location");
-                if (!ls.isEmpty()) {
-                    auto l = ls.at(0).toElement();
-                    if (!l.isNull()) {
-                        qDebug() << "location:" << l.text();
-
-                        auto url = Utils::urlFromText(l.text(), context);
-                        if (!url.isEmpty()) {
-                            PlaylistItemMeta item;
-                            item.url = url;
-
-                            auto ts = track.elementsByTagName("title");
-                            if (!ts.isEmpty()) {
-                                auto t = ts.at(0).toElement();
-                                if (!t.isNull()) {
-                                    qDebug() << "title:" << t.text();
-                                    item.title = t.text();
-                                }
-                            }
-
-                            auto ds = track.elementsByTagName("duration");
-                            if (!ds.isEmpty()) {
-                                auto d = ds.at(0).toElement();
-                                if (!d.isNull()) {
-                                    qDebug() << "duration:" << d.text();
-                                    item.length = d.text().toInt();
-                                }
-                            }
-
-                            list.append(item);
-                        }
-                    }
+    // Stream reader is used instead of DOM, only first location, title
+    // and duration elements of every track are read
+    QXmlStreamReader xml(data);
+    PlaylistItemMeta item;
+    bool inTrack = false, hasTitle = false, hasLength = false;
+
+    while (!xml.atEnd()) {
+        auto token = xml.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            const auto name = xml.name();
+            if (name == QLatin1String("track")) {
+                inTrack = true; hasTitle = false; hasLength = false;
+                item = PlaylistItemMeta();
+            } else if (inTrack) {
+                if (name == QLatin1String("location")) {
+                    auto text = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                    if (item.url.isEmpty())
+                        item.url = Utils::urlFromText(text.trimmed(), context);
+                } else if (name == QLatin1String("title") && !hasTitle) {
+                    item.title = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                    hasTitle = true;
+                } else if (name == QLatin1String("duration") && !hasLength) {
+                    item.length = xml.readElementText(QXmlStreamReader::IncludeChildElements).toInt();
+                    hasLength = true;
                 }
             }
+        } else if (token == QXmlStreamReader::EndElement) {
+            if (inTrack && xml.name() == QLatin1String("track")) {
+                inTrack = false;
+                if (!item.url.isEmpty())
+                    list.append(item);
+            }
         }
-    } else {
-        qWarning() << "Playlist parse error:" << error;
     }
 
+    if (xml.hasError())
+        qWarning() << "Playlist parse error:" << xml.errorString();
+
+    qDebug() << "XSPF playlist items:" << list.size();
+
     return list;
 }
 
@@ -93,6 +93,18 @@ public:
         // 0 - stream proxy (default)
         // 1 - playlist proxy (e.g. for HLS playlists)
         bool mode = 0;
+        // stream properties, filled only when probed with libavformat
+        QString container;
+        AVCodecID audioCodec = AV_CODEC_ID_NONE;
+        AVCodecID videoCodec = AV_CODEC_ID_NONE;
+        int audioProfile = FF_PROFILE_UNKNOWN;
+        int videoProfile = FF_PROFILE_UNKNOWN;
+        int width = 0;
+        int height = 0;
+        double frameRate = 0.0;
+        int64_t preciseDuration = 0; // ms
+        QString dlnaProfile; // DLNA.ORG_PN value
+        int64_t timestamp = 0; // ms since epoch when remote meta was created
     };
 
     struct PlaylistItemMeta {
@@ -107,15 +119,21 @@ public:
     static QString bestName(const ItemMeta &meta);
     static Type getContentTypeByExtension(const QString &path);
     static Type getContentTypeByExtension(const QUrl &url);
+    static QString getContentMimeByExtension(const QString &path);
+    static QString getContentMimeByExtension(const QUrl &url);
     static PlaylistType playlistTypeFromMime(const QString &mime);
     static PlaylistType playlistTypeFromExtension(const QString &path);
     static QList<PlaylistItemMeta> parsePls(const QByteArray &data, const QString context = QString());
     static QList<PlaylistItemMeta> parseM3u(const QByteArray &data, const QString context = QString());
     static QList<PlaylistItemMeta> parseXspf(const QByteArray &data, const QString context = QString());
     static void resolveM3u(QByteArray &data, const QString context);
+    static QList<PlaylistItemMeta> parsePlaylist(const QByteArray &data, PlaylistType type,
+                                                 const QString context = QString());
+    static QList<PlaylistItemMeta> parsePlaylistFile(const QString &path);
     static QString streamTitleFromShoutcastMetadata(const QByteArray &metadata);
 
-    bool getContentUrl(const QString &id, QUrl &url, QString &meta, QString cUrl = "");
+    bool getContentUrl(const QString &id, QUrl &url, QString &meta, QString cUrl = "",
+                       const QString &peer = QString());
     Type getContentType(const QString &path);
     Type getContentType(const QUrl &url);
     QString getContentMime(const QString &path);
@@ -124,11 +142,13 @@ public:
     Q_INVOKABLE QString idFromUrl(const QUrl &url) const;
     Q_INVOKABLE QString pathFromUrl(const QUrl &url) const;
     Q_INVOKABLE QString urlFromUrl(const QUrl &url) const;
-    const QHash<QUrl, ItemMeta>::const_iterator getMetaCacheIterator(const QUrl &url, bool createNew = true);
-    const QHash<QUrl, ItemMeta>::const_iterator getMetaCacheIteratorForId(const QUrl &id, bool createNew = true);
-    const QHash<QUrl, ItemMeta>::const_iterator metaCacheIteratorEnd();
-    const ItemMeta* getMeta(const QUrl &url, bool createNew = true);
-    const ItemMeta* getMetaForId(const QUrl &id, bool createNew = true);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator getMetaCacheIterator(const QUrl &url, bool createNew = true);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator getMetaCacheIteratorForId(const QUrl &id, bool createNew = true);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator metaCacheIteratorEnd();
+    // Returned meta stays valid even if cache entry is replaced
+    std::shared_ptr<const ItemMeta> getMeta(const QUrl &url, bool createNew = true);
+    std::shared_ptr<const ItemMeta> getMetaForId(const QUrl &id, bool createNew = true);
+    std::shared_ptr<const ItemMeta> getMetaRefreshed(const QUrl &url);
     Q_INVOKABLE QString streamTitle(const QUrl &id) const;
     Q_INVOKABLE void setStreamToRecord(const QUrl &id, bool value);
     Q_INVOKABLE bool isStreamToRecord(const QUrl &id);
@@ -214,26 +234,36 @@ private:
     static const int threadWait = 1;
     static const int maxRedirections = 5;
     static const int httpTimeout = 10000;
+    static const int64_t avProbeSize = 500000; // bytes
+    static const int64_t avAnalyzeDuration = 1000000; // us
+    static const int remoteProbeSize = 65536; // bytes requested with Range header
+    static const int sniffSize = 4096;
+    static const int64_t remoteMetaTtl = 1800000; // 30 min
+    static const int64_t remoteMetaFailureTtl = 60000; // 1 min
     static const qint64 recMaxSize = 500000000;
     static const qint64 recMinSize = 100000;
 
-    QHash<QUrl, ItemMeta> metaCache; // url => ItemMeta
+    QHash<QUrl, std::shared_ptr<ItemMeta>> metaCache; // url => ItemMeta
+    QHash<QUrl, int64_t> metaFailureCache; // url => time of failed HTTP request
     QHash<QUrl, StreamData> streams; // id => StreamData
     QMutex metaCacheMutex;
     QString pulseStreamName;
 
     static QByteArray encrypt(const QByteArray& data);
     static QByteArray decrypt(const QByteArray& data);
-    static bool makeUrl(const QString& id, QUrl& url);
+    static bool makeUrl(const QString& id, QUrl& url, const QString& peer = QString());
     static QString dlnaOrgFlagsForFile();
     static QString dlnaOrgFlagsForStreaming();
     static QString dlnaOrgPnFlags(const QString& mime);
+    static QString dlnaProfileFromMeta(const ItemMeta& meta);
     static QString dlnaContentFeaturesHeader(const QString& mime, bool seek = true,
-                                             bool flags = true);
-    static QString getContentMimeByExtension(const QString &path);
-    static QString getContentMimeByExtension(const QUrl &url);
+                                             bool flags = true,
+                                             const QString& profile = QString());
     static QString getExtensionFromAudioContentType(const QString &mime);
     static QString mimeFromDisposition(const QString &disposition);
+    static QString mimeFromReply(const QNetworkReply *reply);
+    static QString mimeFromData(const QByteArray &data);
+    static bool mimeIsGeneric(const QString &mime);
     static bool hlsPlaylist(const QByteArray &data);
     static void updateMetaUsingTaglib(const QString& path, const QString& title,
                                       const QString& artist = QString(),
@@ -242,13 +272,15 @@ private:
     ContentServer(QObject *parent = nullptr);
     bool getContentMeta(const QString &id, const QUrl &url, QString &meta, const ItemMeta* item);
     void requestHandler(QHttpRequest *req, QHttpResponse *resp);
-    const QHash<QUrl, ItemMeta>::const_iterator makeItemMeta(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeMicItemMeta(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeAudioCaptureItemMeta(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeScreenCaptureItemMeta(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeItemMetaUsingTracker(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeItemMetaUsingTaglib(const QUrl &url);
-    const QHash<QUrl, ItemMeta>::const_iterator makeItemMetaUsingHTTPRequest(const QUrl &url,
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeItemMeta(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeMicItemMeta(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeAudioCaptureItemMeta(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeScreenCaptureItemMeta(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeItemMetaUsingTracker(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeItemMetaUsingTaglib(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeItemMetaUsingAvProbe(const QUrl &url);
+    const QHash<QUrl, std::shared_ptr<ItemMeta>>::const_iterator makeItemMetaUsingHTTPRequest(const QUrl &url);
+    bool makeRemoteMeta(const QUrl &url, ItemMeta &meta,
             std::shared_ptr<QNetworkAccessManager> nam = std::shared_ptr<QNetworkAccessManager>(),
             int counter = 0);
     ItemMeta *makeMetaUsingExtension(const QUrl &url);
@@ -350,7 +382,8 @@ private:
     bool displayStatus = true;
 
     ContentServerWorker(QObject *parent = nullptr);
-    void streamFile(const QString& path, const QString &mime, QHttpRequest *req, QHttpResponse *resp);
+    void streamFile(const QString& path, const QString &mime, QHttpRequest *req, QHttpResponse *resp,
+                    const QString &dlnaProfile = QString());
     void streamFileRange(QFile *file, QHttpRequest *req, QHttpResponse *resp);
     void streamFileNoRange(QFile *file, QHttpRequest *req, QHttpResponse *resp);
     void requestHandler(QHttpRequest *req, QHttpResponse *resp);
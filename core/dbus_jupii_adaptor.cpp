@@ -39,6 +39,14 @@ bool PlayerAdaptor::canControl() const
     return qvariant_cast< bool >(parent()->property("canControl"));
 }
 
+QString PlayerAdaptor::actionStats()
+{
+    // handle method call org.jupii.Player.actionStats
+    QString json;
+    QMetaObject::invokeMethod(parent(), "actionStats", Q_RETURN_ARG(QString, json));
+    return json;
+}
+
 void PlayerAdaptor::addPath(const QString &path, const QString &name)
 {
     // handle method call org.jupii.Player.addPath
@@ -87,3 +95,96 @@ void PlayerAdaptor::clearPlaylist()
     QMetaObject::invokeMethod(parent(), "clearPlaylist");
 }
 
+void PlayerAdaptor::closeSession(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.closeSession
+    QMetaObject::invokeMethod(parent(), "closeSession", Q_ARG(QString, deviceId));
+}
+
+QString PlayerAdaptor::dumpActionStats()
+{
+    // handle method call org.jupii.Player.dumpActionStats
+    QString path;
+    QMetaObject::invokeMethod(parent(), "dumpActionStats", Q_RETURN_ARG(QString, path));
+    return path;
+}
+
+bool PlayerAdaptor::openSession(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.openSession
+    bool ok;
+    QMetaObject::invokeMethod(parent(), "openSession", Q_RETURN_ARG(bool, ok), Q_ARG(QString, deviceId));
+    return ok;
+}
+
+void PlayerAdaptor::resetActionStats()
+{
+    // handle method call org.jupii.Player.resetActionStats
+    QMetaObject::invokeMethod(parent(), "resetActionStats");
+}
+
+bool PlayerAdaptor::sessionAddPath(const QString &deviceId, const QString &path, const QString &name)
+{
+    // handle method call org.jupii.Player.sessionAddPath
+    bool ok;
+    QMetaObject::invokeMethod(parent(), "sessionAddPath", Q_RETURN_ARG(bool, ok), Q_ARG(QString, deviceId), Q_ARG(QString, path), Q_ARG(QString, name));
+    return ok;
+}
+
+bool PlayerAdaptor::sessionAddUrl(const QString &deviceId, const QString &url, const QString &name)
+{
+    // handle method call org.jupii.Player.sessionAddUrl
+    bool ok;
+    QMetaObject::invokeMethod(parent(), "sessionAddUrl", Q_RETURN_ARG(bool, ok), Q_ARG(QString, deviceId), Q_ARG(QString, url), Q_ARG(QString, name));
+    return ok;
+}
+
+void PlayerAdaptor::sessionClear(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionClear
+    QMetaObject::invokeMethod(parent(), "sessionClear", Q_ARG(QString, deviceId));
+}
+
+void PlayerAdaptor::sessionNext(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionNext
+    QMetaObject::invokeMethod(parent(), "sessionNext", Q_ARG(QString, deviceId));
+}
+
+void PlayerAdaptor::sessionPause(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionPause
+    QMetaObject::invokeMethod(parent(), "sessionPause", Q_ARG(QString, deviceId));
+}
+
+void PlayerAdaptor::sessionPlay(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionPlay
+    QMetaObject::invokeMethod(parent(), "sessionPlay", Q_ARG(QString, deviceId));
+}
+
+void PlayerAdaptor::sessionPrev(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionPrev
+    QMetaObject::invokeMethod(parent(), "sessionPrev", Q_ARG(QString, deviceId));
+}
+
+void PlayerAdaptor::sessionSetVolume(const QString &deviceId, int volume)
+{
+    // handle method call org.jupii.Player.sessionSetVolume
+    QMetaObject::invokeMethod(parent(), "sessionSetVolume", Q_ARG(QString, deviceId), Q_ARG(int, volume));
+}
+
+void PlayerAdaptor::sessionStop(const QString &deviceId)
+{
+    // handle method call org.jupii.Player.sessionStop
+    QMetaObject::invokeMethod(parent(), "sessionStop", Q_ARG(QString, deviceId));
+}
+
+QStringList PlayerAdaptor::sessions()
+{
+    // handle method call org.jupii.Player.sessions
+    QStringList deviceIds;
+    QMetaObject::invokeMethod(parent(), "sessions", Q_RETURN_ARG(QStringList, deviceIds));
+    return deviceIds;
+}
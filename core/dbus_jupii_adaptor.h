@@ -64,6 +64,57 @@ class PlayerAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"in\" type=\"s\" name=\"name\"/>\n"
 "    </method>\n"
 "    <method name=\"clearPlaylist\"/>\n"
+"    <method name=\"openSession\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"      <arg direction=\"out\" type=\"b\" name=\"ok\"/>\n"
+"    </method>\n"
+"    <method name=\"closeSession\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessions\">\n"
+"      <arg direction=\"out\" type=\"as\" name=\"deviceIds\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionAddPath\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"path\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"name\"/>\n"
+"      <arg direction=\"out\" type=\"b\" name=\"ok\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionAddUrl\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"url\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"name\"/>\n"
+"      <arg direction=\"out\" type=\"b\" name=\"ok\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionClear\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionPlay\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionPause\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionStop\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionNext\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionPrev\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"    </method>\n"
+"    <method name=\"sessionSetVolume\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"deviceId\"/>\n"
+"      <arg direction=\"in\" type=\"i\" name=\"volume\"/>\n"
+"    </method>\n"
+"    <method name=\"actionStats\">\n"
+"      <arg direction=\"out\" type=\"s\" name=\"json\"/>\n"
+"    </method>\n"
+"    <method name=\"dumpActionStats\">\n"
+"      <arg direction=\"out\" type=\"s\" name=\"path\"/>\n"
+"    </method>\n"
+"    <method name=\"resetActionStats\"/>\n"
 "  </interface>\n"
         "")
 public:
@@ -75,6 +126,7 @@ public: // PROPERTIES
     bool canControl() const;
 
 public Q_SLOTS: // METHODS
+    QString actionStats();
     void addPath(const QString &path, const QString &name);
     void addPathOnce(const QString &path, const QString &name);
     void addPathOnceAndPlay(const QString &path, const QString &name);
@@ -83,6 +135,20 @@ public Q_SLOTS: // METHODS
     void addUrlOnceAndPlay(const QString &url, const QString &name);
     void appendPath(const QString &path);
     void clearPlaylist();
+    void closeSession(const QString &deviceId);
+    QString dumpActionStats();
+    bool openSession(const QString &deviceId);
+    void resetActionStats();
+    bool sessionAddPath(const QString &deviceId, const QString &path, const QString &name);
+    bool sessionAddUrl(const QString &deviceId, const QString &url, const QString &name);
+    void sessionClear(const QString &deviceId);
+    void sessionNext(const QString &deviceId);
+    void sessionPause(const QString &deviceId);
+    void sessionPlay(const QString &deviceId);
+    void sessionPrev(const QString &deviceId);
+    void sessionSetVolume(const QString &deviceId, int volume);
+    void sessionStop(const QString &deviceId);
+    QStringList sessions();
 Q_SIGNALS: // SIGNALS
     void CanControlPropertyChanged(bool canControl);
 };
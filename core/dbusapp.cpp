@@ -15,6 +15,7 @@
 #include "playlistmodel.h"
 #include "avtransport.h"
 #include "services.h"
+#include "actionstats.h"
 #include "utils.h"
 
 DbusProxy::DbusProxy(QObject *parent) :
@@ -162,3 +163,164 @@ void DbusProxy::clearPlaylist()
     auto pl = PlaylistModel::instance();
     pl->clear();
 }
+
+bool DbusProxy::isUiDevice(const QString& deviceId)
+{
+    auto av = Services::instance()->avTransport;
+    return av && av->getInited() && av->getDeviceId() == deviceId;
+}
+
+bool DbusProxy::openSession(const QString& deviceId)
+{
+    qDebug() << "Dbus openSession, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        qDebug() << "Device is controlled by UI";
+        return true;
+    }
+
+    return Services::instance()->openSession(deviceId) != nullptr;
+}
+
+void DbusProxy::closeSession(const QString& deviceId)
+{
+    qDebug() << "Dbus closeSession, deviceId:" << deviceId;
+
+    Services::instance()->closeSession(deviceId);
+}
+
+QStringList DbusProxy::sessions()
+{
+    qDebug() << "Dbus sessions";
+
+    auto services = Services::instance();
+    QStringList ids;
+    if (services->avTransport->getInited())
+        ids << services->avTransport->getDeviceId();
+    ids << services->sessionIds();
+    return ids;
+}
+
+bool DbusProxy::sessionAddPath(const QString& deviceId, const QString& path, const QString& name)
+{
+    qDebug() << "Dbus sessionAddPath, deviceId, path:" << deviceId << path << name;
+
+    if (isUiDevice(deviceId)) {
+        PlaylistModel::instance()->addItemPath(path, name);
+        return true;
+    }
+
+    auto session = Services::instance()->session(deviceId);
+    return session && session->addUrl(QUrl::fromLocalFile(path), name);
+}
+
+bool DbusProxy::sessionAddUrl(const QString& deviceId, const QString& url, const QString& name)
+{
+    qDebug() << "Dbus sessionAddUrl, deviceId, url:" << deviceId << url << name;
+
+    if (isUiDevice(deviceId)) {
+        PlaylistModel::instance()->addItemUrl(QUrl(url), name);
+        return true;
+    }
+
+    auto session = Services::instance()->session(deviceId);
+    return session && session->addUrl(QUrl(url), name);
+}
+
+void DbusProxy::sessionClear(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionClear, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        PlaylistModel::instance()->clear();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->clear();
+    }
+}
+
+void DbusProxy::sessionPlay(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionPlay, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        Services::instance()->avTransport->play();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->play();
+    }
+}
+
+void DbusProxy::sessionPause(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionPause, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        Services::instance()->avTransport->pause();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->pause();
+    }
+}
+
+void DbusProxy::sessionStop(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionStop, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        Services::instance()->avTransport->stop();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->stop();
+    }
+}
+
+void DbusProxy::sessionNext(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionNext, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        PlaylistModel::instance()->next();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->next();
+    }
+}
+
+void DbusProxy::sessionPrev(const QString& deviceId)
+{
+    qDebug() << "Dbus sessionPrev, deviceId:" << deviceId;
+
+    if (isUiDevice(deviceId)) {
+        PlaylistModel::instance()->prev();
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->prev();
+    }
+}
+
+void DbusProxy::sessionSetVolume(const QString& deviceId, int volume)
+{
+    qDebug() << "Dbus sessionSetVolume, deviceId, volume:" << deviceId << volume;
+
+    if (isUiDevice(deviceId)) {
+        Services::instance()->renderingControl->setVolume(volume);
+    } else if (auto session = Services::instance()->session(deviceId)) {
+        session->setVolume(volume);
+    }
+}
+
+QString DbusProxy::actionStats()
+{
+    qDebug() << "Dbus actionStats";
+
+    return ActionStats::instance()->toJson();
+}
+
+QString DbusProxy::dumpActionStats()
+{
+    qDebug() << "Dbus dumpActionStats";
+
+    return ActionStats::instance()->dump();
+}
+
+void DbusProxy::resetActionStats()
+{
+    qDebug() << "Dbus resetActionStats";
+
+    ActionStats::instance()->reset();
+}
@@ -11,6 +11,7 @@
 #include <QObject>
 #include <QString>
 #include <QUrl>
+#include <QStringList>
 
 class DbusProxy :
         public QObject
@@ -39,9 +40,25 @@ public slots:
     void addUrlOnce(const QString& url, const QString& name);
     void addUrlOnceAndPlay(const QString& url, const QString& name);
     void clearPlaylist();
+    bool openSession(const QString& deviceId);
+    void closeSession(const QString& deviceId);
+    QStringList sessions();
+    bool sessionAddPath(const QString& deviceId, const QString& path, const QString& name);
+    bool sessionAddUrl(const QString& deviceId, const QString& url, const QString& name);
+    void sessionClear(const QString& deviceId);
+    void sessionPlay(const QString& deviceId);
+    void sessionPause(const QString& deviceId);
+    void sessionStop(const QString& deviceId);
+    void sessionNext(const QString& deviceId);
+    void sessionPrev(const QString& deviceId);
+    void sessionSetVolume(const QString& deviceId, int volume);
+    QString actionStats();
+    QString dumpActionStats();
+    void resetActionStats();
 
 private:
     bool m_canControl = false;
+    bool isUiDevice(const QString& deviceId);
 };
 
 #endif // DBUSAPP_H
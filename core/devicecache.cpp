@@ -0,0 +1,97 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "devicecache.h"
+
+DeviceCache* DeviceCache::m_instance = nullptr;
+
+DeviceCache::DeviceCache(QObject *parent) :
+    QObject(parent)
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    if (!dir.exists())
+        dir.mkpath(".");
+    m_path = dir.filePath("devices.cache");
+}
+
+DeviceCache* DeviceCache::instance(QObject *parent)
+{
+    if (DeviceCache::m_instance == nullptr) {
+        DeviceCache::m_instance = new DeviceCache(parent);
+    }
+
+    return DeviceCache::m_instance;
+}
+
+QList<DeviceCache::Entry> DeviceCache::load()
+{
+    QList<Entry> entries;
+
+    QFile f(m_path);
+    if (!f.exists())
+        return entries;
+
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open device cache:" << f.errorString();
+        return entries;
+    }
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 m = 0, v = 0;
+    in >> m >> v;
+    if (in.status() != QDataStream::Ok || m != magic || v != version) {
+        qWarning() << "Device cache has invalid header";
+        return entries;
+    }
+
+    auto oldest = QDateTime::currentDateTimeUtc().addDays(-maxAge);
+
+    while (!in.atEnd()) {
+        Entry e;
+        in >> e.id >> e.descUrl >> e.xml >> e.etag >> e.lastSeen;
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "Device cache is damaged";
+            break;
+        }
+        if (e.lastSeen < oldest) {
+            qDebug() << "Device not seen for a long time, so skipping it:" << e.id;
+            continue;
+        }
+        entries << e;
+    }
+
+    qDebug() << "Devices loaded from cache:" << entries.size();
+
+    return entries;
+}
+
+void DeviceCache::write(const QList<Entry> &entries)
+{
+    QSaveFile f(m_path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot open device cache:" << f.errorString();
+        return;
+    }
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << magic << version;
+    for (const auto &e : entries)
+        out << e.id << e.descUrl << e.xml << e.etag << e.lastSeen;
+
+    if (!f.commit())
+        qWarning() << "Cannot write device cache:" << f.errorString();
+}
@@ -0,0 +1,53 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DEVICECACHE_H
+#define DEVICECACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QList>
+#include <QByteArray>
+#include <QDateTime>
+
+// Persistent cache of descriptions of all discovered devices. Device
+// list is restored from it on startup, before any SSDP search is made.
+// Service URLs are not stored separately because they are resolved
+// from description XML against its location.
+
+class DeviceCache :
+        public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QString id; // UDN
+        QUrl descUrl; // last seen location of description
+        QByteArray xml;
+        QByteArray etag;
+        QDateTime lastSeen;
+    };
+
+    static DeviceCache* instance(QObject *parent = nullptr);
+
+    QList<Entry> load();
+    void write(const QList<Entry> &entries);
+
+private:
+    static DeviceCache* m_instance;
+    static const quint32 magic = 0x4a444345; // "JDCE"
+    static const quint32 version = 1;
+    static const int maxAge = 30; // days
+
+    QString m_path;
+
+    explicit DeviceCache(QObject *parent = nullptr);
+};
+
+#endif // DEVICECACHE_H
@@ -30,12 +30,33 @@ const int icon_size = 64;
 DeviceModel::DeviceModel(QObject *parent) :
     ListModel(new DeviceItem, parent)
 {
-    connect(Directory::instance(), &Directory::discoveryReady,
+    auto d = Directory::instance();
+    connect(d, &Directory::discoveryReady,
             this, &DeviceModel::updateModel);
+    connect(d, &Directory::deviceAdded,
+            this, &DeviceModel::updateDevice);
+    connect(d, &Directory::deviceUpdated,
+            this, &DeviceModel::updateDevice);
+    connect(d, &Directory::deviceRemoved,
+            this, &DeviceModel::removeDevice);
     connect(Services::instance()->avTransport.get(), &Service::initedChanged,
             this, &DeviceModel::serviceInitedHandler);
     connect(Services::instance()->renderingControl.get(), &Service::initedChanged,
             this, &DeviceModel::serviceInitedHandler);
+    connect(Settings::instance(), &Settings::favDevicesChanged,
+            this, &DeviceModel::favDevicesChangedHandler);
+
+    // Devices restored from cache are shown before discovery
+    if (!d->getDeviceDescs().isEmpty())
+        updateModel();
+}
+
+// Items are not QObjects, so change of favs is reported by the model
+void DeviceModel::favDevicesChangedHandler()
+{
+    if (rowCount() > 0)
+        emit dataChanged(index(0), index(rowCount() - 1),
+                         QVector<int>() << DeviceItem::FavRole);
 }
 
 void DeviceModel::serviceInitedHandler()
@@ -51,66 +72,118 @@ void DeviceModel::serviceInitedHandler()
     }
 }
 
-void DeviceModel::updateModel()
+bool DeviceModel::accepted(const UPnPClient::UPnPDeviceDesc &ddesc,
+                           bool &supported) const
+{
+    /*supported = ddesc.deviceType == "urn:schemas-upnp-org:device:MediaRenderer:1" ||
+                  ddesc.deviceType == "urn:schemas-upnp-org:device:MediaServer:1";*/
+    supported = ddesc.deviceType == "urn:schemas-upnp-org:device:MediaRenderer:1";
+    return supported || Settings::instance()->getShowAllDevices();
+}
+
+DeviceItem* DeviceModel::makeItem(const UPnPClient::UPnPDeviceDesc &ddesc,
+                                  bool supported)
 {
     auto d = Directory::instance();
-    auto s = Settings::instance();
     auto av = Services::instance()->avTransport;
 
-    auto& ddescs = d->getDeviceDescs();
-    bool showAll = s->getShowAllDevices();
-
-    clear();
-
-    for (auto it = ddescs.begin(); it != ddescs.end(); ++it) {
-        auto& ddesc = it.value();
-        /*bool supported = ddesc.deviceType == "urn:schemas-upnp-org:device:MediaRenderer:1" ||
-                         ddesc.deviceType == "urn:schemas-upnp-org:device:MediaServer:1";*/
-        bool supported = ddesc.deviceType == "urn:schemas-upnp-org:device:MediaRenderer:1";
-
-        if (supported || showAll) {
-            QString id = QString::fromStdString(ddesc.UDN);
-            QUrl iconUrl = d->getDeviceIconUrl(ddesc);
-            bool active = av && av->getDeviceId() == id;
-            bool xc = d->xcExists(it.key());
-            appendRow(new DeviceItem(id,
-                                     QString::fromStdString(ddesc.friendlyName),
-                                     QString::fromStdString(ddesc.deviceType),
-                                     QString::fromStdString(ddesc.modelName),
+    QString id = QString::fromStdString(ddesc.UDN);
+    QUrl iconUrl = d->getDeviceIconUrl(ddesc);
+    bool active = av && av->getDeviceId() == id;
+    bool xc = d->xcExists(id);
+
+    auto item = new DeviceItem(id,
+                               QString::fromStdString(ddesc.friendlyName),
+                               QString::fromStdString(ddesc.deviceType),
+                               QString::fromStdString(ddesc.modelName),
 #ifdef DESKTOP
-                                     QIcon(),
+                               QIcon(),
 #else
-                                     iconUrl,
+                               iconUrl,
 #endif
-                                     supported,
-                                     active,
-                                     xc
-                                     ));
+                               supported,
+                               active,
+                               xc
+                               );
 
 #ifdef DESKTOP
-            if (!iconUrl.isEmpty()) {
-                auto downloader = new FileDownloader(iconUrl, this);
-                connect(downloader, &FileDownloader::downloaded,
-                        [this, id, downloader](int error){
-                    //qDebug() << "Icon downloaded for:" << id;
-                    if (error == 0) {
-                        auto item = dynamic_cast<DeviceItem*>(this->find(id));
-                        if (item) {
-                            auto img = QImage::fromData(downloader->downloadedData());
-                            img = img.scaled(QSize(icon_size,icon_size));
-                            auto pix = QPixmap::fromImage(img);
-                            item->setIcon(QIcon(pix));
-                        }
-                    } else {
-                        qWarning() << "Icon downloading error";
-                    }
-
-                    downloader->deleteLater();
-                });
+    if (!iconUrl.isEmpty()) {
+        auto downloader = new FileDownloader(iconUrl, this);
+        connect(downloader, &FileDownloader::downloaded,
+                [this, id, downloader](int error){
+            //qDebug() << "Icon downloaded for:" << id;
+            if (error == 0) {
+                auto item = dynamic_cast<DeviceItem*>(this->find(id));
+                if (item) {
+                    auto img = QImage::fromData(downloader->downloadedData());
+                    img = img.scaled(QSize(icon_size,icon_size));
+                    auto pix = QPixmap::fromImage(img);
+                    item->setIcon(QIcon(pix));
+                }
+            } else {
+                qWarning() << "Icon downloading error";
             }
+
+            downloader->deleteLater();
+        });
+    }
 #endif
-        }
+
+    return item;
+}
+
+// Synchronizes rows with directory, so rows of devices that are
+// already listed are not recreated
+void DeviceModel::updateModel()
+{
+    auto& ddescs = Directory::instance()->getDeviceDescs();
+
+    for (int i = rowCount() - 1; i >= 0; --i) {
+        auto item = dynamic_cast<DeviceItem*>(readRow(i));
+        if (item && !ddescs.contains(item->id()))
+            removeRow(i);
     }
+
+    for (auto it = ddescs.begin(); it != ddescs.end(); ++it)
+        updateDevice(it.key());
+}
+
+void DeviceModel::updateDevice(const QString &id)
+{
+    UPnPClient::UPnPDeviceDesc ddesc;
+    if (!Directory::instance()->getDeviceDesc(id, ddesc))
+        return;
+
+    bool supported;
+    bool accept = accepted(ddesc, supported);
+    int row = indexFromId(id);
+
+    if (row < 0) {
+        if (accept)
+            appendRow(makeItem(ddesc, supported));
+        return;
+    }
+
+    if (!accept) {
+        removeRow(row);
+        return;
+    }
+
+    auto item = dynamic_cast<DeviceItem*>(readRow(row));
+    if (item &&
+            item->title() == QString::fromStdString(ddesc.friendlyName) &&
+            item->type() == QString::fromStdString(ddesc.deviceType) &&
+            item->model() == QString::fromStdString(ddesc.modelName))
+        return;
+
+    replaceRow(row, makeItem(ddesc, supported));
+}
+
+void DeviceModel::removeDevice(const QString &id)
+{
+    int row = indexFromId(id);
+    if (row >= 0)
+        removeRow(row);
 }
 
 void DeviceModel::clear()
@@ -129,9 +202,7 @@ DeviceItem::DeviceItem(const QString &id,
 #endif
                    bool supported,
                    bool active,
-                   bool jxc,
-                   QObject *parent) :
-    ListItem(parent),
+                   bool jxc) :
     m_id(id),
     m_title(title),
     m_type(type),
@@ -141,9 +212,6 @@ DeviceItem::DeviceItem(const QString &id,
     m_supported(supported),
     m_xc(jxc)
 {
-
-    QObject::connect(Settings::instance(), &Settings::favDevicesChanged,
-                     [this](){ emit dataChanged(); });
 }
 
 QHash<int, QByteArray> DeviceItem::roleNames() const
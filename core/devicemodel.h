@@ -23,11 +23,12 @@
 #include <QBrush>
 #endif
 
+#include "libupnpp/control/description.hxx"
+
 #include "listmodel.h"
 
 class DeviceItem : public ListItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         TitleRole = Qt::DisplayRole,
@@ -42,7 +43,7 @@ public:
         XcRole
     };
 
-    DeviceItem(QObject *parent = nullptr): ListItem(parent) {}
+    DeviceItem() {}
     explicit DeviceItem(const QString &id,
                       const QString &title,
                       const QString &type,
@@ -54,8 +55,7 @@ public:
 #endif
                       bool supported,
                       bool active,
-                      bool jxc,
-                      QObject *parent = nullptr);
+                      bool jxc);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -102,7 +102,14 @@ public:
 
 public slots:
     void updateModel();
+    void updateDevice(const QString &id);
+    void removeDevice(const QString &id);
     void serviceInitedHandler();
+    void favDevicesChangedHandler();
+
+private:
+    bool accepted(const UPnPClient::UPnPDeviceDesc &ddesc, bool &supported) const;
+    DeviceItem* makeItem(const UPnPClient::UPnPDeviceDesc &ddesc, bool supported);
 };
 
 #endif // DEVICEMODEL_H
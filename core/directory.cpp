@@ -12,6 +12,11 @@
 #include <QStringList>
 #include <QByteArray>
 #include <QFile>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QTimer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
 #include <string>
 
 #include <libupnpp/control/description.hxx>
@@ -27,6 +32,18 @@ Directory::Directory(QObject *parent) :
     TaskExecutor(parent),
     nm(new QNetworkAccessManager())
 {
+    qRegisterMetaType<UPnPClient::UPnPDeviceDesc>("UPnPClient::UPnPDeviceDesc");
+    qRegisterMetaType<Directory::DiscoveryResult>("Directory::DiscoveryResult");
+    connect(this, &Directory::descReceived, this, &Directory::handleDescReceived,
+            Qt::QueuedConnection);
+    connect(this, &Directory::descLost, this, &Directory::handleDescLost,
+            Qt::QueuedConnection);
+    connect(this, &Directory::cachedLost, this, &Directory::removeLostDevice,
+            Qt::QueuedConnection);
+    connect(this, &Directory::discoveryDone, this, &Directory::handleDiscoveryDone,
+            Qt::QueuedConnection);
+
+    loadCache();
     init();
 }
 
@@ -65,9 +82,82 @@ void Directory::init()
         return;
     }
 
+    if (!m_callbacks) {
+        // Devices are reported as soon as they respond, without
+        // waiting for the end of search window
+        UPnPClient::UPnPDeviceDirectory::addCallback(
+                    [this](const UPnPClient::UPnPDeviceDesc &ddesc,
+                           const UPnPClient::UPnPServiceDesc &sdesc) {
+            Q_UNUSED(sdesc)
+            emit descReceived(ddesc);
+            return true;
+        });
+        UPnPClient::UPnPDeviceDirectory::addLostCallback(
+                    [this](const std::string &udn) {
+            emit descLost(QString::fromStdString(udn));
+        });
+        m_callbacks = true;
+    }
+
     setInited(true);
 }
 
+void Directory::handleDescReceived(const UPnPClient::UPnPDeviceDesc& ddesc)
+{
+    auto did = QString::fromStdString(ddesc.UDN);
+    if (did.isEmpty())
+        return;
+
+    if (m_discovering) {
+        m_discoveryReceived.insert(did);
+        m_discoveryLost.remove(did);
+    }
+
+    auto it = m_devsdesc.find(did);
+    bool exists = it != m_devsdesc.end();
+    if (exists && it.value().XMLText == ddesc.XMLText &&
+            it.value().descURL == ddesc.descURL &&
+            it.value().friendlyName == ddesc.friendlyName)
+        return;
+
+    removeDevice(did, m_devsdesc, m_servsdesc);
+    insertDevice(ddesc, m_devsdesc, m_servsdesc);
+    addXC(did, ddesc);
+
+    if (exists)
+        emit deviceUpdated(did);
+    else
+        emit deviceAdded(did);
+}
+
+void Directory::handleDescLost(const QString& deviceId)
+{
+    if (m_discovering) {
+        m_discoveryLost.insert(deviceId);
+        m_discoveryReceived.remove(deviceId);
+    }
+
+    removeLostDevice(deviceId);
+}
+
+void Directory::removeLostDevice(const QString& deviceId)
+{
+    if (!m_devsdesc.contains(deviceId))
+        return;
+
+    qDebug() << "Device left network:" << deviceId;
+
+    // Removed device stays in cache, so it shows up instantly when back.
+    // Device restored from cache and not seen since keeps its old time.
+    if (!m_stale.contains(deviceId))
+        m_stale.insert(deviceId, makeCacheEntry(deviceId,
+                                                QDateTime::currentDateTimeUtc()));
+
+    removeDevice(deviceId, m_devsdesc, m_servsdesc);
+
+    emit deviceRemoved(deviceId);
+}
+
 Directory* Directory::instance(QObject *parent)
 {
     if (Directory::m_instance == nullptr) {
@@ -77,10 +167,196 @@ Directory* Directory::instance(QObject *parent)
     return Directory::m_instance;
 }
 
-void Directory::clearLists()
+// Devices that came or left while discovery task was running are
+// known better than from the result
+void Directory::handleDiscoveryDone(const Directory::DiscoveryResult& result)
+{
+    for (auto it = result.etags.begin(); it != result.etags.end(); ++it)
+        m_etags.insert(it.key(), it.value());
+
+    for (const auto& ddesc : result.devs) {
+        if (!m_discoveryLost.contains(QString::fromStdString(ddesc.UDN)))
+            handleDescReceived(ddesc);
+    }
+
+    if (result.ok) {
+        for (const auto& did : m_devsdesc.keys()) {
+            if (!result.seen.contains(did) && !m_discoveryReceived.contains(did))
+                removeLostDevice(did);
+        }
+    }
+
+    m_discovering = false;
+    m_discoveryReceived.clear();
+    m_discoveryLost.clear();
+
+    writeCache();
+
+    emit discoveryReady();
+
+    setBusy(false);
+}
+
+void Directory::insertDevice(const UPnPClient::UPnPDeviceDesc& ddesc,
+                             QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                             QHash<QString,UPnPClient::UPnPServiceDesc>& servs)
+{
+    auto did = QString::fromStdString(ddesc.UDN);
+
+    for (auto& sdesc : ddesc.services) {
+        auto sid = QString::fromStdString(sdesc.serviceId);
+        servs.insert(did + sid, sdesc);
+    }
+
+    devs.insert(did, ddesc);
+}
+
+void Directory::removeDevice(const QString& deviceId,
+                             QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                             QHash<QString,UPnPClient::UPnPServiceDesc>& servs)
+{
+    auto it = devs.find(deviceId);
+    if (it == devs.end())
+        return;
+
+    for (auto& sdesc : it.value().services)
+        servs.remove(deviceId + QString::fromStdString(sdesc.serviceId));
+
+    devs.erase(it);
+}
+
+void Directory::addXC(const QString& deviceId, const UPnPClient::UPnPDeviceDesc& ddesc)
 {
-    this->m_devsdesc.clear();
-    this->m_servsdesc.clear();
+    if (m_xcs.contains(deviceId))
+        return;
+
+    auto data = XCParser::parse(QString::fromStdString(ddesc.XMLText));
+    if (data.valid) {
+        auto xc = new YamahaXC(); xc->data = data;
+        m_xcs.insert(deviceId, xc);
+    }
+}
+
+void Directory::loadCache()
+{
+    auto entries = DeviceCache::instance()->load();
+
+    for (const auto& e : entries) {
+        UPnPClient::UPnPDeviceDesc ddesc(e.descUrl.toString().toStdString(),
+                                         e.xml.toStdString());
+        auto did = QString::fromStdString(ddesc.UDN);
+        if (!ddesc.ok || did != e.id) {
+            qWarning() << "Invalid description of cached device:" << e.id;
+            continue;
+        }
+
+        insertDevice(ddesc, m_devsdesc, m_servsdesc);
+        addXC(did, ddesc);
+        m_etags.insert(did, e.etag);
+        m_unconfirmed.insert(did);
+        m_stale.insert(did, e);
+    }
+}
+
+void Directory::writeCache()
+{
+    QList<DeviceCache::Entry> entries;
+    auto now = QDateTime::currentDateTimeUtc();
+
+    for (auto it = m_devsdesc.begin(); it != m_devsdesc.end(); ++it) {
+        entries << makeCacheEntry(it.key(), now);
+        m_stale.remove(it.key());
+    }
+
+    // Devices that are currently off are kept for a while,
+    // so they show up instantly when back
+    for (const auto& e : m_stale)
+        entries << e;
+
+    DeviceCache::instance()->write(entries);
+}
+
+DeviceCache::Entry Directory::makeCacheEntry(const QString& deviceId,
+                                             const QDateTime& lastSeen) const
+{
+    const auto& ddesc = m_devsdesc[deviceId];
+    DeviceCache::Entry e;
+    e.id = deviceId;
+    e.descUrl = QUrl(QString::fromStdString(ddesc.descURL));
+    e.xml = QByteArray::fromStdString(ddesc.XMLText);
+    e.etag = m_etags.value(deviceId);
+    e.lastSeen = lastSeen;
+    return e;
+}
+
+// Confirms devices restored from cache by fetching their descriptions.
+// All requests are sent at once and cheap 304 response is enough
+// if device returned ETag before. Returns ids of alive devices.
+QSet<QString> Directory::confirmCached(QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                                       QHash<QString,QByteArray>& etags)
+{
+    QSet<QString> alive;
+    QNetworkAccessManager nam;
+    QHash<QNetworkReply*,QString> replies;
+    int pending = 0;
+    QEventLoop loop;
+
+    for (auto it = devs.begin(); it != devs.end(); ++it) {
+        const auto& did = it.key();
+
+        QNetworkRequest request;
+        request.setUrl(QUrl(QString::fromStdString(it.value().descURL)));
+        auto etag = etags.value(did);
+        if (!etag.isEmpty())
+            request.setRawHeader("If-None-Match", etag);
+
+        auto reply = nam.get(request);
+        connect(reply, &QNetworkReply::finished, &loop, [&loop, &pending]{
+            if (--pending == 0)
+                loop.quit();
+        });
+        replies.insert(reply, did);
+        ++pending;
+    }
+
+    if (pending > 0) {
+        QTimer::singleShot(confirmTimeout, &loop, &QEventLoop::quit); // timeout
+        loop.exec(); // waiting for HTTP replies...
+    }
+
+    for (auto it = replies.begin(); it != replies.end(); ++it) {
+        auto reply = it.key();
+        auto& did = it.value();
+
+        if (!reply->isFinished()) {
+            qDebug() << "Cached device did not respond:" << did;
+            reply->abort();
+            continue;
+        }
+
+        auto code = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (code == 304) {
+            alive.insert(did);
+        } else if (reply->error() == QNetworkReply::NoError && code == 200) {
+            auto& odesc = devs[did];
+            auto xml = reply->readAll().toStdString();
+            if (xml != odesc.XMLText) {
+                UPnPClient::UPnPDeviceDesc ddesc(odesc.descURL, xml);
+                if (!ddesc.ok || QString::fromStdString(ddesc.UDN) != did) {
+                    qDebug() << "Cached device was replaced:" << did;
+                    continue;
+                }
+                qDebug() << "Description of cached device changed:" << did;
+                odesc = ddesc;
+            }
+            etags.insert(did, reply->rawHeader("ETag"));
+            alive.insert(did);
+        } else {
+            qDebug() << "Cached device is not available:" << did << code;
+        }
+    }
+
+    return alive;
 }
 
 void Directory::discover()
@@ -103,21 +379,49 @@ void Directory::discover()
 
     setBusy(true);
 
-    startTask([this](){
+    // Task gets copies of cached devices to confirm
+    QHash<QString,UPnPClient::UPnPDeviceDesc> cached;
+    for (const auto& did : m_unconfirmed) {
+        auto it = m_devsdesc.find(did);
+        if (it != m_devsdesc.end())
+            cached.insert(did, it.value());
+    }
+    auto etags = m_etags;
+    m_unconfirmed.clear();
 
-        clearLists();
+    m_discovering = true;
+    m_discoveryReceived.clear();
+    m_discoveryLost.clear();
+
+    startTask([this, cached, etags]() mutable {
+        DiscoveryResult result;
 
         if (m_directory == 0) {
             qWarning() << "Directory not initialized";
             setInited(false);
             emit error(3);
+            result.ok = false;
+            emit discoveryDone(result);
             return;
         }
 
+        if (!cached.isEmpty()) {
+            // Devices restored from cache are already listed, so stale ones
+            // are dropped before slower SSDP search
+            result.seen = confirmCached(cached, etags);
+            for (auto it = cached.begin(); it != cached.end(); ++it) {
+                if (result.seen.contains(it.key()))
+                    emit descReceived(it.value());
+                else
+                    emit cachedLost(it.key());
+            }
+            result.etags = etags;
+        }
+
         bool found = false;
-        QHash<QString,bool> xcs;
+        QSet<QString> visited;
 
-        auto traverseFun = [this, &found, &xcs](const UPnPClient::UPnPDeviceDesc &ddesc,
+        auto traverseFun = [&found, &visited, &result](const UPnPClient::UPnPDeviceDesc &ddesc,
                 const UPnPClient::UPnPServiceDesc &sdesc) {
             /*qDebug() << "==> Visitor";
             qDebug() << " Device";
@@ -133,20 +437,14 @@ void Directory::discover()
             qDebug() << "  serviceId:" << QString::fromStdString(sdesc.serviceId);
             qDebug() << "  serviceType:" << QString::fromStdString(sdesc.serviceType);*/
             //qDebug() << "  ddesc.XMLText:" << QString::fromStdString(ddesc.XMLText);
+            Q_UNUSED(sdesc)
 
+            // Device description contains all its services
             auto did = QString::fromStdString(ddesc.UDN);
-            auto sid = QString::fromStdString(sdesc.serviceId);
-
-            this->m_devsdesc.insert(did, ddesc);
-            this->m_servsdesc.insert(did + sid, sdesc);
-
-            if (!xcs.contains(did)) {
-                xcs[did] = true;
-                auto data = XCParser::parse(QString::fromStdString(ddesc.XMLText));
-                if (data.valid) {
-                    auto xc = new YamahaXC(); xc->data = data;
-                    this->m_xcs.insert(did, xc);
-                }
+            if (!visited.contains(did)) {
+                visited.insert(did);
+                result.seen.insert(did);
+                result.devs << ddesc;
             }
 
             found = true;
@@ -159,7 +457,8 @@ void Directory::discover()
                 qWarning() << "Directory not initialized";
                 setInited(false);
                 emit error(3);
-                return;
+                result.ok = false;
+                break;
             }
             m_directory->traverse(traverseFun);
             //qDebug() << "traverse found:" << found;
@@ -169,9 +468,9 @@ void Directory::discover()
 
         //qDebug() << "traverse end";
 
-        emit discoveryReady();
-
-        setBusy(false);
+        // Devices that neither responded to search nor confirmed
+        // cached description are removed in main thread
+        emit discoveryDone(result);
     });
 }
 
@@ -184,10 +483,16 @@ void Directory::discoverFavs()
 
     setBusy(true);
 
+    m_unconfirmed.clear();
+    m_discovering = true;
+    m_discoveryReceived.clear();
+    m_discoveryLost.clear();
+
     startTask([this](){
         auto s = Settings::instance();
 
-        clearLists();
+        // Only favorite devices are listed
+        DiscoveryResult result;
 
         auto favs = s->getFavDevices();
         for (auto it = favs.begin(); it != favs.end(); ++it) {
@@ -199,23 +504,15 @@ void Directory::discoverFavs()
             QByteArray xml;
 
             if (!s->readDeviceXML(id, xml))
-                return;
+                continue;
 
             UPnPClient::UPnPDeviceDesc ddesc(url.toStdString(), xml.toStdString());
 
-            auto did = QString::fromStdString(ddesc.UDN);
-
-            for (auto& sdesc : ddesc.services) {
-                auto sid = QString::fromStdString(sdesc.serviceId);
-                this->m_servsdesc.insert(did + sid, sdesc);
-            }
-
-            this->m_devsdesc.insert(did, ddesc);
+            result.seen.insert(QString::fromStdString(ddesc.UDN));
+            result.devs << ddesc;
         }
 
-        emit discoveryReady();
-
-        setBusy(false);
+        emit discoveryDone(result);
 
         // Empty traverse to init directory
         m_directory->traverse([this](const UPnPClient::UPnPDeviceDesc &ddesc,
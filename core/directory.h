@@ -10,6 +10,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QSet>
 #include <QMap>
 #include <QList>
 #include <QString>
@@ -23,8 +24,15 @@
 #include "libupnpp/control/description.hxx"
 
 #include "taskexecutor.h"
+#include "devicecache.h"
 #include "yamahaextendedcontrol.h"
 
+Q_DECLARE_METATYPE(UPnPClient::UPnPDeviceDesc)
+
+// Device and service descriptions are changed only in main thread.
+// Discovery task works on copies and passes its result back with
+// queued signal.
+
 class Directory :
         public QObject,
         public TaskExecutor
@@ -34,6 +42,13 @@ class Directory :
     Q_PROPERTY (bool inited READ getInited NOTIFY initedChanged)
 
 public:
+    struct DiscoveryResult {
+        QList<UPnPClient::UPnPDeviceDesc> devs; // found devices
+        QSet<QString> seen; // ids of alive devices
+        QHash<QString,QByteArray> etags; // new ETags of descriptions
+        bool ok = true; // false when search failed, nothing is removed
+    };
+
     std::unique_ptr<QNetworkAccessManager> nm;
 
     static Directory* instance(QObject *parent = nullptr);
@@ -55,24 +70,62 @@ public:
 
 signals:
     void discoveryReady();
+    void deviceAdded(const QString& deviceId);
+    void deviceUpdated(const QString& deviceId);
+    void deviceRemoved(const QString& deviceId);
     void busyChanged();
     void initedChanged();
     void error(int code);
+    // Emitted from UPnPP discovery thread
+    void descReceived(const UPnPClient::UPnPDeviceDesc& ddesc);
+    void descLost(const QString& deviceId);
+    // Emitted from discovery task
+    void cachedLost(const QString& deviceId);
+    void discoveryDone(const Directory::DiscoveryResult& result);
+
+private slots:
+    void handleDescReceived(const UPnPClient::UPnPDeviceDesc& ddesc);
+    void handleDescLost(const QString& deviceId);
+    void handleDiscoveryDone(const Directory::DiscoveryResult& result);
+    void removeLostDevice(const QString& deviceId);
 
 private:
     static Directory* m_instance;
+    static const int confirmTimeout = 2000;
     bool m_busy = false;
     bool m_inited = false;
+    bool m_callbacks = false;
     UPnPP::LibUPnP* m_lib = 0;
     UPnPClient::UPnPDeviceDirectory* m_directory;
     QHash<QString,UPnPClient::UPnPServiceDesc> m_servsdesc;
     QHash<QString,UPnPClient::UPnPDeviceDesc> m_devsdesc;
     QHash<QString,YamahaXC*> m_xcs;
+    QHash<QString,QByteArray> m_etags;
+    QSet<QString> m_unconfirmed; // restored from cache, not seen yet
+    QHash<QString,DeviceCache::Entry> m_stale; // cached, but not alive
+    // Devices reported by callbacks while discovery task is running
+    bool m_discovering = false;
+    QSet<QString> m_discoveryReceived;
+    QSet<QString> m_discoveryLost;
     explicit Directory(QObject *parent = nullptr);
     void setBusy(bool busy);
     void setInited(bool inited);
     bool handleError(int ret);
-    void clearLists();
+    void loadCache();
+    void writeCache();
+    DeviceCache::Entry makeCacheEntry(const QString& deviceId,
+                                      const QDateTime& lastSeen) const;
+    void addXC(const QString& deviceId, const UPnPClient::UPnPDeviceDesc& ddesc);
+    QSet<QString> confirmCached(QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                                QHash<QString,QByteArray>& etags);
+    static void insertDevice(const UPnPClient::UPnPDeviceDesc& ddesc,
+                             QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                             QHash<QString,UPnPClient::UPnPServiceDesc>& servs);
+    static void removeDevice(const QString& deviceId,
+                             QHash<QString,UPnPClient::UPnPDeviceDesc>& devs,
+                             QHash<QString,UPnPClient::UPnPServiceDesc>& servs);
 };
 
+Q_DECLARE_METATYPE(Directory::DiscoveryResult)
+
 #endif // DIRECTORY_H
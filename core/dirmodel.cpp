@@ -70,9 +70,7 @@ QString DirModel::getCurrentName()
 
 DirItem::DirItem(const QString &id,
                  const QString &name,
-                 const QString &path,
-                 QObject *parent) :
-    ListItem(parent),
+                 const QString &path) :
     m_id(id),
     m_name(name),
     m_path(path)
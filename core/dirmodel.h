@@ -6,7 +6,6 @@
 
 class DirItem: public ListItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         NameRole = Qt::DisplayRole,
@@ -14,11 +13,10 @@ public:
         PathRole
     };
 
-    DirItem(QObject* parent = nullptr) : ListItem(parent) {}
+    DirItem() {}
     explicit DirItem(const QString &id,
                      const QString &name,
-                     const QString &path,
-                     QObject *parent = nullptr);
+                     const QString &path);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -0,0 +1,150 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QMimeDatabase>
+#include <QCollator>
+#include <QElapsedTimer>
+#include <functional>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "dirscanner.h"
+#include "taskexecutor.h"
+
+DirScanner* DirScanner::m_instance = nullptr;
+
+uint qHash(const DirScanner::FileKey &key, uint seed)
+{
+    return qHash(key.ino, seed) ^ qHash(key.dev);
+}
+
+DirScanner::DirScanner(QObject *parent) :
+    QObject(parent)
+{
+}
+
+DirScanner* DirScanner::instance(QObject *parent)
+{
+    if (DirScanner::m_instance == nullptr) {
+        DirScanner::m_instance = new DirScanner(parent);
+    }
+
+    return DirScanner::m_instance;
+}
+
+QStringList DirScanner::scan(const QStringList &dirs,
+                             const QList<ContentServer::Type> &types)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList files;
+    QMutex filesMutex;
+
+    // Every directory is listed by a separate task, so idle threads
+    // take subdirectories found by other threads
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+
+    std::function<void(const QString&)> walk;
+    walk = [this, &walk, &pool, &types, &files, &filesMutex](const QString &path) {
+        QStringList found;
+
+        const auto entries = QDir(path).entryInfoList(
+                    QDir::Dirs|QDir::Files|QDir::NoDotAndDotDot|QDir::Readable);
+        for (const auto &entry : entries) {
+            if (entry.isDir()) {
+                // links to dirs are not followed to avoid loops
+                if (!entry.isSymLink()) {
+                    auto subdir = entry.absoluteFilePath();
+                    auto task = new TaskExecutor::Task([&walk, subdir]{
+                        walk(subdir);
+                    });
+                    task->setAutoDelete(true);
+                    pool.start(task);
+                }
+            } else if (types.contains(fileType(entry.absoluteFilePath()))) {
+                found << entry.absoluteFilePath();
+            }
+        }
+
+        if (!found.isEmpty()) {
+            QMutexLocker locker(&filesMutex);
+            files << found;
+        }
+    };
+
+    for (const auto &dir : dirs) {
+        auto task = new TaskExecutor::Task([&walk, dir]{
+            walk(QDir(dir).absolutePath());
+        });
+        task->setAutoDelete(true);
+        pool.start(task);
+    }
+
+    pool.waitForDone();
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(files.begin(), files.end(), collator);
+
+    qDebug() << "Dir scan done:" << files.size() << "files in"
+             << timer.elapsed() << "ms";
+
+    return files;
+}
+
+ContentServer::Type DirScanner::fileType(const QString &path)
+{
+    auto type = ContentServer::getContentTypeByExtension(path);
+    if (type != ContentServer::TypeUnknown)
+        return type;
+
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0)
+        return ContentServer::TypeUnknown;
+
+    FileKey key;
+    key.dev = static_cast<quint64>(st.st_dev);
+    key.ino = static_cast<quint64>(st.st_ino);
+    const qint64 mtime = static_cast<qint64>(st.st_mtime);
+
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        auto it = m_typeCache.constFind(key);
+        if (it != m_typeCache.constEnd() && it->mtime == mtime)
+            return it->type;
+    }
+
+    type = sniffType(path);
+
+    QMutexLocker locker(&m_cacheMutex);
+    if (m_typeCache.size() >= maxCacheSize)
+        m_typeCache.clear();
+    FileType ft;
+    ft.mtime = mtime;
+    ft.type = type;
+    m_typeCache.insert(key, ft);
+
+    return type;
+}
+
+ContentServer::Type DirScanner::sniffType(const QString &path)
+{
+    QMimeDatabase db;
+    auto mime = db.mimeTypeForFile(path, QMimeDatabase::MatchContent);
+    return mime.isValid() ? ContentServer::typeFromMime(mime.name()) :
+                            ContentServer::TypeUnknown;
+}
@@ -0,0 +1,64 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DIRSCANNER_H
+#define DIRSCANNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+#include "contentserver.h"
+
+// Finds media files in directory trees. Subdirectories are listed
+// in parallel by thread pool. File type is taken from extension and
+// when extension is unknown, from file content. Content based type
+// is cached by inode and mtime, so files are not read again.
+
+class DirScanner :
+        public QObject
+{
+    Q_OBJECT
+
+public:
+    static DirScanner* instance(QObject *parent = nullptr);
+
+    // Returns sorted paths of files with one of 'types'
+    QStringList scan(const QStringList &dirs,
+                     const QList<ContentServer::Type> &types);
+
+private:
+    struct FileKey {
+        quint64 dev = 0;
+        quint64 ino = 0;
+        bool operator==(const FileKey &other) const {
+            return dev == other.dev && ino == other.ino;
+        }
+    };
+
+    struct FileType {
+        qint64 mtime = 0;
+        ContentServer::Type type = ContentServer::TypeUnknown;
+    };
+
+    friend uint qHash(const FileKey &key, uint seed);
+
+    static DirScanner* m_instance;
+    static const int maxCacheSize = 100000;
+
+    QHash<FileKey, FileType> m_typeCache;
+    QMutex m_cacheMutex;
+
+    explicit DirScanner(QObject *parent = nullptr);
+    ContentServer::Type fileType(const QString &path);
+    ContentServer::Type sniffType(const QString &path);
+};
+
+#endif // DIRSCANNER_H
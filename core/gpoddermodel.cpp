@@ -83,6 +83,8 @@ QList<ListItem*> GpodderEpisodeModel::makeItems()
         return items;
     }
 
+    auto after = pageKey();
+
     QSqlQuery query(db);
     query.prepare("SELECT PodcastEpisode.id, PodcastEpisode.title, "
                   "PodcastEpisode.subtitle, PodcastEpisode.published, "
@@ -95,14 +97,28 @@ QList<ListItem*> GpodderEpisodeModel::makeItems()
                   "PodcastEpisode.download_filename != '' AND "
                   "PodcastEpisode.state = 1 AND "
                   "(PodcastEpisode.title LIKE ? OR "
-                  "PodcastChannel.title LIKE ?) "
-                  "ORDER BY PodcastEpisode.published DESC "
-                  "LIMIT 50");
+                  "PodcastChannel.title LIKE ?) " +
+                  QString(after.size() == 2 ?
+                  "AND (PodcastEpisode.published < ? OR "
+                  "(PodcastEpisode.published = ? AND PodcastEpisode.id < ?)) " : "") +
+                  "ORDER BY PodcastEpisode.published DESC, PodcastEpisode.id DESC "
+                  "LIMIT " + QString::number(queryLimit));
     query.addBindValue("%" + getFilter() + "%");
     query.addBindValue("%" + getFilter() + "%");
+    if (after.size() == 2) {
+        query.addBindValue(after.at(0));
+        query.addBindValue(after.at(0));
+        query.addBindValue(after.at(1));
+    }
+
+    // Key of the last row read from DB, also when item was skipped
+    QVariantList last;
+    int rows = 0;
 
     if (query.exec()) {
         while(query.next()) {
+            last = QVariantList() << query.value(3) << query.value(0);
+            ++rows;
             auto dir(m_dir);
             auto folder = query.value(9).toString();
 #ifdef SAILFISH
@@ -153,6 +169,9 @@ QList<ListItem*> GpodderEpisodeModel::makeItems()
                 qWarning() << "Episode file doesn't exist:" << dir.absoluteFilePath(filename);
             }
         }
+
+        if (rows == queryLimit)
+            setNextPageKey(last);
     } else {
         auto err = query.lastError();
         qWarning() << "Gpodder DB query error:"
@@ -194,12 +213,11 @@ GpodderEpisodeItem::GpodderEpisodeItem(const QString &id,
                    ContentServer::Type type,
                    uint published,
 #ifdef SAILFISH
-                   const QUrl &icon,
+                   const QUrl &icon
 #else
-                   const QIcon &icon,
+                   const QIcon &icon
 #endif
-                   QObject *parent) :
-    SelectableItem(parent),
+                   ) :
     m_id(id),
     m_title(title),
     m_description(description),
@@ -39,7 +39,6 @@ private:
 
 class GpodderEpisodeItem : public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         TitleRole = Qt::DisplayRole,
@@ -56,7 +55,7 @@ public:
     };
 
 public:
-    GpodderEpisodeItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    GpodderEpisodeItem() {}
     explicit GpodderEpisodeItem(const QString &id,
                       const QString &title,
                       const QString &description,
@@ -67,11 +66,11 @@ public:
                       ContentServer::Type type,
                       uint published,
 #ifdef SAILFISH
-                      const QUrl &icon,
+                      const QUrl &icon
 #else
-                      const QIcon &icon,
+                      const QIcon &icon
 #endif
-                      QObject *parent = nullptr);
+                      );
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -114,6 +113,7 @@ public:
     Q_INVOKABLE QVariantList selectedItems();
 
 private:
+    static const int queryLimit = 50;
     QDir m_dir;
 #ifdef SAILFISH
     QUrl m_icon;
@@ -19,6 +19,7 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <memory>
+#include <algorithm>
 
 #include "icecastmodel.h"
 #include "utils.h"
@@ -42,7 +43,7 @@ bool IcecastModel::parseData()
         qDebug() << "Parsing Icecast directory";
         QDomDocument doc; QString error;
         if (doc.setContent(data, false, &error)) {
-            m_entries = doc.elementsByTagName("entry");
+            m_entries = sortedEntries(doc.elementsByTagName("entry"));
             return true;
         } else {
             qWarning() << "Parse error:" << error;
@@ -54,6 +55,30 @@ bool IcecastModel::parseData()
     return false;
 }
 
+// Entries are sorted once, so pages are parts of one sorted list
+QList<QDomElement> IcecastModel::sortedEntries(const QDomNodeList &nodes)
+{
+    QList<QPair<QString, QDomElement>> list;
+    int l = nodes.length();
+    for (int i = 0; i < l; ++i) {
+        auto entry = nodes.at(i).toElement();
+        if (!entry.isNull())
+            list << qMakePair(entry.elementsByTagName("server_name").at(0).toElement().text(), entry);
+    }
+
+    std::stable_sort(list.begin(), list.end(), [](const QPair<QString, QDomElement> &a,
+                                                  const QPair<QString, QDomElement> &b) {
+        return a.first.compare(b.first, Qt::CaseInsensitive) < 0;
+    });
+
+    QList<QDomElement> entries;
+    entries.reserve(list.size());
+    for (const auto &p : list)
+        entries << p.second;
+
+    return entries;
+}
+
 bool IcecastModel::isRefreshing()
 {
     return m_refreshing;
@@ -138,9 +163,11 @@ QList<ListItem*> IcecastModel::makeItems()
 
     auto filter = getFilter();
 
-    int l = filter.isEmpty() ? 50 : m_entries.length();
+    // Page key is the position of the next entry in the directory
+    auto after = pageKey();
+    int l = m_entries.length();
 
-    for (int i = 0; i < l; ++i) {
+    for (int i = after.isEmpty() ? 0 : after.first().toInt(); i < l; ++i) {
         auto entry = m_entries.at(i).toElement();
         if (!entry.isNull()) {
             auto name = entry.elementsByTagName("server_name").at(0).toElement().text();
@@ -177,17 +204,13 @@ QList<ListItem*> IcecastModel::makeItems()
             }
         }
 
-        if (items.length() > 49)
+        if (items.length() >= pageSize) {
+            if (i + 1 < l)
+                setNextPageKey(QVariantList() << i + 1);
             break;
+        }
     }
 
-    // Sorting
-    std::sort(items.begin(), items.end(), [](ListItem *a, ListItem *b) {
-        auto aa = dynamic_cast<IcecastItem*>(a);
-        auto bb = dynamic_cast<IcecastItem*>(b);
-        return aa->name().compare(bb->name(), Qt::CaseInsensitive) < 0;
-    });
-
     return items;
 }
 
@@ -195,9 +218,7 @@ IcecastItem::IcecastItem(const QString &id,
                    const QString &name,
                    const QString &description,
                    const QUrl &url,
-                   ContentServer::Type type,
-                   QObject *parent) :
-    SelectableItem(parent),
+                   ContentServer::Type type) :
     m_id(id),
     m_name(name),
     m_description(description),
@@ -17,6 +17,9 @@
 #include <QDir>
 #include <QNetworkAccessManager>
 #include <QDomNodeList>
+#include <QDomElement>
+#include <QList>
+#include <QPair>
 #include <memory>
 
 #include "contentserver.h"
@@ -25,7 +28,6 @@
 
 class IcecastItem : public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         NameRole = Qt::DisplayRole,
@@ -37,13 +39,12 @@ public:
     };
 
 public:
-    IcecastItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    IcecastItem() {}
     explicit IcecastItem(const QString &id,
                       const QString &name,
                       const QString &description,
                       const QUrl &url,
-                      ContentServer::Type type,
-                      QObject *parent = nullptr);
+                      ContentServer::Type type);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -80,13 +81,15 @@ private:
     static const QString m_dirUrl;
     static const QString m_dirFilename;
     static const int httpTimeout = 100000;
+    static const int pageSize = 50;
 
     std::unique_ptr<QNetworkAccessManager> nam;
-    QDomNodeList m_entries;
+    QList<QDomElement> m_entries; // sorted by name
     bool m_refreshing = false;
 
     QList<ListItem*> makeItems();
     bool parseData();
+    static QList<QDomElement> sortedEntries(const QDomNodeList &nodes);
 };
 
 #endif // ICECASTMODEL_H
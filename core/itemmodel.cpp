@@ -6,16 +6,42 @@
  */
 
 #include <QDebug>
+#include <QSet>
 
 #include "itemmodel.h"
 
-ItemWorker::ItemWorker(ItemModel *model, const QString &data) :
+ItemWorker::ItemWorker(ItemModel *model, const QString &data, int generation) :
     QThread(model),
+    data(data),
     model(model),
-    data(data)
+    generation(generation)
 {
 }
 
+ItemWorker::~ItemWorker()
+{
+    cancel();
+    wait();
+    // items that were not taken by model
+    qDeleteAll(items);
+    qDeleteAll(pending);
+}
+
+ItemWorker* ItemWorker::current()
+{
+    return qobject_cast<ItemWorker*>(QThread::currentThread());
+}
+
+void ItemWorker::cancel()
+{
+    cancelled.store(1);
+}
+
+bool ItemWorker::isCancelled() const
+{
+    return cancelled.load() != 0;
+}
+
 void ItemWorker::run()
 {
     items = model->makeItems();
@@ -24,21 +50,130 @@ void ItemWorker::run()
 ItemModel::ItemModel(ListItem *prototype, QObject *parent) :
     ListModel(prototype, parent)
 {
+    m_updateTimer.setSingleShot(true);
+    connect(&m_updateTimer, &QTimer::timeout, this, &ItemModel::startWorker);
 }
 
 void ItemModel::updateModel(const QString &data)
 {
-    if (m_worker && m_worker->isRunning()) {
-        //qWarning() << "Previous worker is running";
+    scheduleUpdate(data);
+}
+
+void ItemModel::scheduleUpdate(const QString &data, int delay)
+{
+    // Result of any earlier update is stale from now
+    m_generation++;
+    m_updateData = data;
+
+    if (m_worker)
+        m_worker->cancel();
+
+    setBusy(true);
+    m_updateTimer.start(delay);
+}
+
+void ItemModel::startWorker()
+{
+    startPageWorker(QVariantList());
+}
+
+bool ItemModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !m_nextPageKey.isEmpty();
+}
+
+void ItemModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || m_nextPageKey.isEmpty())
+        return;
+
+    if (m_worker || m_updateTimer.isActive()) {
+        // Page will be requested again when view reaches the end
         return;
     }
 
-    setBusy(true);
-    m_worker = std::unique_ptr<ItemWorker>(new ItemWorker(this, data));
+    m_generation++;
+    startPageWorker(m_nextPageKey);
+}
+
+QVariantList ItemModel::pageKey() const
+{
+    auto worker = ItemWorker::current();
+    return worker ? worker->pageKey : QVariantList();
+}
+
+void ItemModel::setNextPageKey(const QVariantList &key)
+{
+    auto worker = ItemWorker::current();
+    if (worker)
+        worker->nextPageKey = key;
+}
+
+void ItemModel::startPageWorker(const QVariantList &pageKey)
+{
+    if (m_worker) {
+        // Cancelled worker can still be running, so it is
+        // deleted when it finishes
+        auto worker = m_worker.release();
+        worker->cancel();
+        connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+        if (worker->isFinished())
+            worker->deleteLater();
+    }
+
+    m_worker = std::unique_ptr<ItemWorker>(
+                new ItemWorker(this, m_updateData, m_generation));
+    m_worker->pageKey = pageKey;
+    // Next page is appended to existing items
+    m_worker->delivered = !pageKey.isEmpty();
     connect(m_worker.get(), &QThread::finished, this, &ItemModel::workerDone);
+    connect(m_worker.get(), &ItemWorker::itemsReady, this, &ItemModel::workerItemsReady);
     m_worker->start(QThread::IdlePriority);
 }
 
+void ItemModel::deliverItems(const QList<ListItem*> &items)
+{
+    auto worker = ItemWorker::current();
+    if (!worker) {
+        qWarning() << "Items can be delivered only from worker thread";
+        return;
+    }
+
+    if (!items.isEmpty())
+        emit worker->itemsReady(items);
+}
+
+bool ItemModel::isCancelled() const
+{
+    auto worker = ItemWorker::current();
+    return worker && worker->isCancelled();
+}
+
+void ItemModel::workerItemsReady(const QList<ListItem*> &items)
+{
+    auto worker = dynamic_cast<ItemWorker*>(sender());
+    if (!worker || worker != m_worker.get() ||
+            worker->generation != m_generation || worker->isCancelled()) {
+        // Result is not needed anymore
+        qDeleteAll(items);
+        return;
+    }
+
+    if (!worker->delivered && !m_list.isEmpty()) {
+        // Old items will be updated when whole result is ready
+        worker->pending << items;
+        return;
+    }
+
+    int old_l = m_list.length();
+
+    worker->delivered = true;
+    appendNewRows(items);
+
+    if (old_l != m_list.length())
+        emit countChanged();
+}
+
 void ItemModel::clear()
 {
     if (m_list.length() == 0)
@@ -51,26 +186,138 @@ void ItemModel::clear()
 void ItemModel::workerDone()
 {
     auto worker = dynamic_cast<ItemWorker*>(sender());
-    if (worker) {
-        int old_l = m_list.length();
+    if (!worker || worker != m_worker.get()) {
+        // Worker was replaced by newer one
+        return;
+    }
 
-        if (m_list.length() != 0)
-            removeRows(0,rowCount());
+    if (worker->generation != m_generation || worker->isCancelled()) {
+        // Stale result, newer update is scheduled
+        m_worker.reset(nullptr);
+        return;
+    }
 
-        if (!worker->items.isEmpty())
-            appendRows(worker->items);
-        else
-            qWarning() << "No items";
+    int old_l = m_list.length();
 
-        if (old_l != m_list.length())
-            emit countChanged();
+    m_nextPageKey = worker->nextPageKey;
 
-        m_worker.reset(nullptr);
+    if (worker->delivered) {
+        appendNewRows(worker->items);
+    } else {
+        auto items = worker->pending + worker->items;
+        if (items.isEmpty())
+            qWarning() << "No items";
+        updateItems(items);
     }
 
+    worker->pending.clear();
+    worker->items.clear();
+
+    if (old_l != m_list.length())
+        emit countChanged();
+
+    m_worker.reset(nullptr);
+
     setBusy(false);
 }
 
+void ItemModel::appendNewRows(const QList<ListItem*> &items)
+{
+    // Pages can overlap when data has changed, so items
+    // that are already in the model are skipped
+    QList<ListItem*> newItems;
+    for (auto item : items) {
+        if (find(item->id()))
+            delete item;
+        else
+            newItems << item;
+    }
+
+    if (!newItems.isEmpty())
+        appendRows(newItems);
+}
+
+static bool sameData(const ListItem *a, const ListItem *b)
+{
+    const auto roles = a->roleNames().keys();
+    for (int role : roles) {
+        if (a->data(role) != b->data(role))
+            return false;
+    }
+    return true;
+}
+
+void ItemModel::updateItems(const QList<ListItem*> &items)
+{
+    QSet<QString> newIds;
+    for (auto item : items)
+        newIds.insert(item->id());
+
+    QSet<QString> oldIds;
+    for (auto item : m_list)
+        oldIds.insert(item->id());
+
+    if (newIds.size() != items.size() || oldIds.size() != m_list.size()) {
+        // Ids are not unique, so all items are replaced
+        if (!m_list.isEmpty())
+            removeRows(0, rowCount());
+        appendRows(items);
+        return;
+    }
+
+    // Removing items that are not in the new list,
+    // adjacent rows are removed together
+    int row = m_list.size() - 1;
+    while (row >= 0) {
+        if (newIds.contains(m_list.at(row)->id())) {
+            --row;
+            continue;
+        }
+
+        int last = row;
+        while (row > 0 && !newIds.contains(m_list.at(row - 1)->id()))
+            --row;
+        removeRows(row, last - row + 1);
+        --row;
+    }
+
+    int i = 0;
+    while (i < items.size()) {
+        auto item = items.at(i);
+
+        if (i >= m_list.size() || m_list.at(i)->id() != item->id()) {
+            int oldRow = indexFromId(item->id());
+
+            if (oldRow < 0) {
+                // Inserting adjacent new items together
+                QList<ListItem*> inserted;
+                int j = i;
+                while (j < items.size() && !find(items.at(j)->id()))
+                    inserted << items.at(j++);
+                insertItems(i, inserted);
+                i = j;
+                continue;
+            }
+
+            moveRow(oldRow, i);
+        }
+
+        auto oldItem = m_list.at(i);
+
+        auto oldSel = dynamic_cast<SelectableItem*>(oldItem);
+        auto newSel = dynamic_cast<SelectableItem*>(item);
+        if (oldSel && newSel)
+            newSel->setSelected(oldSel->selected());
+
+        if (sameData(oldItem, item))
+            delete item;
+        else
+            replaceRow(i, item);
+
+        ++i;
+    }
+}
+
 int  ItemModel::getCount()
 {
     return m_list.length();
@@ -121,7 +368,8 @@ void SelectableItemModel::setFilter(const QString &filter)
         m_filter = filter;
         emit filterChanged();
 
-        updateModel();
+        // Waiting for next keystroke before querying
+        scheduleUpdate(m_filter, filterDelay);
     }
 }
 
@@ -188,17 +436,26 @@ QVariantList SelectableItemModel::selectedItems()
 
 void SelectableItemModel::workerDone()
 {
-    if (m_worker && m_worker->data != m_filter) {
-        //qDebug() << "Filter has changed, so updating model";
-        updateModel(m_filter);
-    } else {
-        ItemModel::workerDone();
+    ItemModel::workerDone();
+    updateSelectedCount();
+}
+
+void SelectableItemModel::updateSelectedCount()
+{
+    int c = 0;
+    for (auto li : m_list) {
+        if (dynamic_cast<SelectableItem*>(li)->selected())
+            c++;
+    }
+
+    if (c != m_selectedCount) {
+        m_selectedCount = c;
+        emit selectedCountChanged();
     }
 }
 
 void SelectableItemModel::updateModel(const QString &data)
 {
     Q_UNUSED(data)
-    setAllSelected(false);
     ItemModel::updateModel(m_filter);
 }
@@ -11,6 +11,9 @@
 #include <QObject>
 #include <QList>
 #include <QThread>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QVariantList>
 #include <memory>
 
 #include "listmodel.h"
@@ -24,12 +27,26 @@ friend class ItemModel;
 friend class SelectableItemModel;
 
 public:
-    explicit ItemWorker(ItemModel *model, const QString &data = QString());
+    explicit ItemWorker(ItemModel *model, const QString &data = QString(),
+                        int generation = 0);
+    ~ItemWorker();
+    static ItemWorker* current();
+    void cancel();
+    bool isCancelled() const;
+
+signals:
+    void itemsReady(const QList<ListItem*> &items);
 
 private:
     QString data;
     ItemModel *model;
+    int generation;
+    QVariantList pageKey; // empty when first page is made
+    QVariantList nextPageKey;
     QList<ListItem*> items;
+    QList<ListItem*> pending; // delivered items waiting for diff
+    QAtomicInt cancelled;
+    bool delivered = false; // some items were appended to model
     void run();
 };
 
@@ -44,6 +61,8 @@ friend class ItemWorker;
 public:
     explicit ItemModel(ListItem *prototype, QObject *parent = nullptr);
     int getCount();
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
 
 public slots:
     virtual void updateModel(const QString &data = QString());
@@ -54,26 +73,49 @@ signals:
 
 protected slots:
     virtual void workerDone();
+    void workerItemsReady(const QList<ListItem*> &items);
 
 protected:
     std::unique_ptr<ItemWorker> m_worker;
     virtual QList<ListItem*> makeItems() = 0;
     virtual void clear();
     void setBusy(bool busy);
+    // updates model with minimal changes, existing items
+    // with the same id are reused
+    void updateItems(const QList<ListItem*> &items);
+    // starts update after delay, running worker is cancelled and
+    // result of any earlier update is dropped
+    void scheduleUpdate(const QString &data, int delay = 0);
+    // can be called from makeItems to show part of items before
+    // worker is finished
+    void deliverItems(const QList<ListItem*> &items);
+    // can be called from makeItems to check if result is still needed
+    bool isCancelled() const;
+    // can be called from makeItems, key of the last item after which
+    // next page should start, empty key means first page
+    QVariantList pageKey() const;
+    // can be called from makeItems when more items are available
+    void setNextPageKey(const QVariantList &key);
 
 private slots:
     bool isBusy();
+    void startWorker();
 
 private:
     bool m_busy = true;
+    int m_generation = 0;
+    QString m_updateData;
+    QTimer m_updateTimer;
+    QVariantList m_nextPageKey;
+
+    void startPageWorker(const QVariantList &pageKey);
+    void appendNewRows(const QList<ListItem*> &items);
 };
 
 class SelectableItem: public ListItem
 {
-    Q_OBJECT
-
 public:
-    SelectableItem(QObject* parent = 0) : ListItem(parent) {}
+    SelectableItem() {}
     inline bool selected() const { return m_selected; }
     void setSelected(bool value);
 private:
@@ -107,9 +149,12 @@ protected slots:
     virtual void workerDone();
 
 private:
+    static const int filterDelay = 250; // ms
+
     QString m_filter;
     int m_selectedCount = 0;
     void clear();
+    void updateSelectedCount();
 };
 
 #endif // ITEMMODEL_H
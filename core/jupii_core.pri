@@ -14,6 +14,12 @@ desktop {
     INCLUDEPATH += /usr/include/taglib
     include($$PROJECTDIR/libs/ffmpeg/ffmpeg.pri)
     include($$PROJECTDIR/libs/x264/x264.pri)
+
+    HEADERS += \
+        $$CORE_DIR/library.h
+
+    SOURCES += \
+        $$CORE_DIR/library.cpp
 }
 
 sailfish {
@@ -37,25 +43,32 @@ HEADERS += \
     $$CORE_DIR/dbus_tracker_inf.h \
     $$CORE_DIR/utils.h \
     $$CORE_DIR/listmodel.h \
+    $$CORE_DIR/rowstore.h \
     $$CORE_DIR/devicemodel.h \
     $$CORE_DIR/renderingcontrol.h \
     $$CORE_DIR/avtransport.h \
     $$CORE_DIR/service.h \
+    $$CORE_DIR/actionstats.h \
     $$CORE_DIR/contentserver.h \
     $$CORE_DIR/filemetadata.h \
     $$CORE_DIR/settings.h \
     $$CORE_DIR/directory.h \
+    $$CORE_DIR/devicecache.h \
     $$CORE_DIR/taskexecutor.h \
     $$CORE_DIR/deviceinfo.h \
     $$CORE_DIR/playlistmodel.h \
+    $$CORE_DIR/playliststore.h \
+    $$CORE_DIR/dirscanner.h \
     $$CORE_DIR/dbusapp.h \
     $$CORE_DIR/tracker.h \
     $$CORE_DIR/trackercursor.h \
+    $$CORE_DIR/querycache.h \
     $$CORE_DIR/albummodel.h \
     $$CORE_DIR/artistmodel.h \
     $$CORE_DIR/playlistfilemodel.h \
     $$CORE_DIR/trackmodel.h \
     $$CORE_DIR/services.h \
+    $$CORE_DIR/renderersession.h \
     $$CORE_DIR/info.h \
     $$CORE_DIR/somafmmodel.h \
     $$CORE_DIR/gpoddermodel.h \
@@ -76,25 +89,32 @@ SOURCES += \
     $$CORE_DIR/main.cpp \
     $$CORE_DIR/utils.cpp \
     $$CORE_DIR/listmodel.cpp \
+    $$CORE_DIR/rowstore.cpp \
     $$CORE_DIR/devicemodel.cpp \
     $$CORE_DIR/renderingcontrol.cpp \
     $$CORE_DIR/avtransport.cpp \
     $$CORE_DIR/service.cpp \
+    $$CORE_DIR/actionstats.cpp \
     $$CORE_DIR/contentserver.cpp \
     $$CORE_DIR/filemetadata.cpp \
     $$CORE_DIR/settings.cpp \
     $$CORE_DIR/directory.cpp \
+    $$CORE_DIR/devicecache.cpp \
     $$CORE_DIR/taskexecutor.cpp \
     $$CORE_DIR/deviceinfo.cpp \
     $$CORE_DIR/playlistmodel.cpp \
+    $$CORE_DIR/playliststore.cpp \
+    $$CORE_DIR/dirscanner.cpp \
     $$CORE_DIR/dbusapp.cpp \
     $$CORE_DIR/tracker.cpp \
     $$CORE_DIR/trackercursor.cpp \
+    $$CORE_DIR/querycache.cpp \
     $$CORE_DIR/albummodel.cpp \
     $$CORE_DIR/artistmodel.cpp \
     $$CORE_DIR/playlistfilemodel.cpp \
     $$CORE_DIR/trackmodel.cpp \
     $$CORE_DIR/services.cpp \
+    $$CORE_DIR/renderersession.cpp \
     $$CORE_DIR/somafmmodel.cpp \
     $$CORE_DIR/gpoddermodel.cpp \
     $$CORE_DIR/itemmodel.cpp \
@@ -0,0 +1,891 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QRegExp>
+#include <QMutexLocker>
+#include <algorithm>
+
+#include "library.h"
+#include "settings.h"
+#include "contentserver.h"
+
+// TagLib
+#include "fileref.h"
+#include "tag.h"
+
+Library* Library::m_instance = nullptr;
+
+namespace {
+// QSqlDatabase connection cannot be shared between threads, so every
+// thread gets own connection which is removed when thread finishes
+struct Connection {
+    QString name;
+    ~Connection() { QSqlDatabase::removeDatabase(name); }
+};
+
+QThreadStorage<Connection*> connections;
+
+void logQueryError(const QSqlQuery &query)
+{
+    auto err = query.lastError();
+    qWarning() << "Library DB query error:"
+               << err.number()
+               << err.type()
+               << err.text();
+}
+}
+
+Library::Library(QObject *parent) :
+    QObject(parent),
+    TaskExecutor(parent, 1)
+{
+    auto db = Library::db();
+    if (!db.isOpen() || !createSchema(db))
+        qWarning() << "Library DB is not available";
+
+    m_changeTimer.setSingleShot(true);
+    m_changeTimer.setInterval(changeDelay);
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
+            this, &Library::dirChangedHandler);
+    connect(&m_changeTimer, &QTimer::timeout,
+            this, &Library::dirsChangedHandler);
+    connect(Settings::instance(), &Settings::libraryDirsChanged,
+            this, &Library::libraryDirsChangedHandler);
+
+    m_roots = Settings::instance()->getLibraryDirs();
+    rescan();
+}
+
+Library* Library::instance(QObject *parent)
+{
+    if (Library::m_instance == nullptr) {
+        Library::m_instance = new Library(parent);
+    }
+
+    return Library::m_instance;
+}
+
+QSqlDatabase Library::db()
+{
+    if (!connections.hasLocalData()) {
+        auto con = new Connection;
+        con->name = QString("qt_sql_jupii_library_%1").arg(
+                    reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        connections.setLocalData(con);
+
+        QDir dir(Settings::instance()->getCacheDir());
+        if (!dir.exists())
+            dir.mkpath(dir.absolutePath());
+
+        auto db = QSqlDatabase::addDatabase("QSQLITE", con->name);
+        db.setConnectOptions(QLatin1String("QSQLITE_BUSY_TIMEOUT=5000"));
+        db.setDatabaseName(dir.filePath("library.db"));
+        if (db.open()) {
+            QSqlQuery query(db);
+            // WAL lets models read while scanner is writing
+            query.exec("PRAGMA journal_mode = WAL");
+            query.exec("PRAGMA synchronous = NORMAL");
+        } else {
+            qWarning() << "Cannot open library db:" << db.lastError().text();
+        }
+        return db;
+    }
+
+    return QSqlDatabase::database(connections.localData()->name);
+}
+
+bool Library::createSchema(QSqlDatabase &db)
+{
+    const QStringList schema {
+        "CREATE TABLE IF NOT EXISTS artists ("
+        "id INTEGER PRIMARY KEY, "
+        "name TEXT NOT NULL UNIQUE)",
+        "CREATE TABLE IF NOT EXISTS albums ("
+        "id INTEGER PRIMARY KEY, "
+        "title TEXT NOT NULL, "
+        "artist_id INTEGER NOT NULL, "
+        "art TEXT, "
+        "UNIQUE (title, artist_id))",
+        "CREATE TABLE IF NOT EXISTS tracks ("
+        "id INTEGER PRIMARY KEY, "
+        "path TEXT NOT NULL UNIQUE, "
+        "dir TEXT NOT NULL, "
+        "mtime INTEGER NOT NULL, "
+        "size INTEGER NOT NULL, "
+        "title TEXT NOT NULL, "
+        "artist_id INTEGER NOT NULL, "
+        "album_id INTEGER NOT NULL, "
+        "number INTEGER NOT NULL DEFAULT 0, "
+        "length INTEGER NOT NULL DEFAULT 0, "
+        "mime TEXT)",
+        "CREATE INDEX IF NOT EXISTS tracks_dir ON tracks (dir)",
+        "CREATE INDEX IF NOT EXISTS tracks_album ON tracks (album_id, number, id)",
+        "CREATE INDEX IF NOT EXISTS tracks_artist ON tracks (artist_id)",
+        "CREATE INDEX IF NOT EXISTS albums_title ON albums (title COLLATE NOCASE, id)",
+        "CREATE INDEX IF NOT EXISTS artists_name ON artists (name COLLATE NOCASE, id)",
+        // Full-text index, docid is the same as tracks.id
+        "CREATE VIRTUAL TABLE IF NOT EXISTS tracks_fts USING fts4 (title, artist, album)"
+    };
+
+    QSqlQuery query(db);
+    for (const auto &sql : schema) {
+        if (!query.exec(sql)) {
+            logQueryError(query);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Library::isScanning()
+{
+    QMutexLocker locker(&m_dirtyMutex);
+    return m_scanning;
+}
+
+QString Library::ftsQuery(const QString &filter, const QString &column)
+{
+    // Every word is matched as a prefix, e.g. "abc def" => "abc* def*"
+    auto words = filter.split(QRegExp("\\W+"), QString::SkipEmptyParts);
+    for (auto &word : words) {
+        word.append('*');
+        if (!column.isEmpty())
+            word.prepend(column + ":");
+    }
+    return words.join(' ');
+}
+
+QString Library::artForDir(const QString &dir)
+{
+    static const QStringList names {
+        "cover.jpg", "folder.jpg", "front.jpg", "cover.png", "folder.png"
+    };
+
+    QDir d(dir);
+    for (const auto &name : names) {
+        if (d.exists(name))
+            return d.absoluteFilePath(name);
+    }
+
+    return QString();
+}
+
+// Row values comparison, e.g. (a, b) > (?, ?), requires SQLite >= 3.15
+
+QList<Library::AlbumData> Library::albums(const QString &filter, bool byArtist,
+                                          const QVariantList &after, int limit,
+                                          const CancelCheck &cancelled)
+{
+    QList<AlbumData> list;
+
+    auto db = Library::db();
+    if (!db.isOpen())
+        return list;
+
+    QStringList where;
+    const auto match = ftsQuery(filter);
+    if (!match.isEmpty())
+        where << "al.id IN (SELECT album_id FROM tracks WHERE id IN ("
+                 "SELECT docid FROM tracks_fts WHERE tracks_fts MATCH ? UNION "
+                 "SELECT docid FROM tracks_fts WHERE tracks_fts MATCH ?))";
+    if (!after.isEmpty())
+        where << (byArtist ?
+                  "(ar.name COLLATE NOCASE, al.title COLLATE NOCASE, al.id) > (?, ?, ?)" :
+                  "(al.title COLLATE NOCASE, al.id) > (?, ?)");
+
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT al.id, al.title, ar.name, al.art, "
+                          "COUNT(t.id), SUM(t.length) "
+                          "FROM albums al "
+                          "JOIN artists ar ON ar.id = al.artist_id "
+                          "JOIN tracks t ON t.album_id = al.id "
+                          "%1 GROUP BY al.id ORDER BY %2 LIMIT ?").arg(
+                      where.isEmpty() ? QString() : "WHERE " + where.join(" AND "),
+                      byArtist ? "ar.name COLLATE NOCASE, al.title COLLATE NOCASE, al.id" :
+                                 "al.title COLLATE NOCASE, al.id"));
+
+    if (!match.isEmpty()) {
+        query.addBindValue(ftsQuery(filter, "album"));
+        query.addBindValue(ftsQuery(filter, "artist"));
+    }
+    for (const auto &value : after)
+        query.addBindValue(value);
+    query.addBindValue(limit);
+
+    if (cancelled && cancelled())
+        return list;
+
+    if (!query.exec()) {
+        logQueryError(query);
+        return list;
+    }
+
+    while (query.next()) {
+        if (cancelled && cancelled()) {
+            list.clear();
+            break;
+        }
+        AlbumData album;
+        album.id = query.value(0).toLongLong();
+        album.title = query.value(1).toString();
+        album.artist = query.value(2).toString();
+        album.art = query.value(3).toString();
+        album.count = query.value(4).toInt();
+        album.length = query.value(5).toInt();
+        if (byArtist)
+            album.key << album.artist << album.title << album.id;
+        else
+            album.key << album.title << album.id;
+        list << album;
+    }
+
+    return list;
+}
+
+QList<Library::ArtistData> Library::artists(const QString &filter,
+                                            const QVariantList &after, int limit,
+                                            const CancelCheck &cancelled)
+{
+    QList<ArtistData> list;
+
+    auto db = Library::db();
+    if (!db.isOpen())
+        return list;
+
+    QStringList where;
+    const auto match = ftsQuery(filter, "artist");
+    if (!match.isEmpty())
+        where << "t.id IN (SELECT docid FROM tracks_fts WHERE tracks_fts MATCH ?)";
+    if (!after.isEmpty())
+        where << "(ar.name COLLATE NOCASE, ar.id) > (?, ?)";
+
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT ar.id, ar.name, COUNT(t.id), SUM(t.length) "
+                          "FROM artists ar "
+                          "JOIN tracks t ON t.artist_id = ar.id "
+                          "%1 GROUP BY ar.id "
+                          "ORDER BY ar.name COLLATE NOCASE, ar.id LIMIT ?").arg(
+                      where.isEmpty() ? QString() : "WHERE " + where.join(" AND ")));
+
+    if (!match.isEmpty())
+        query.addBindValue(match);
+    for (const auto &value : after)
+        query.addBindValue(value);
+    query.addBindValue(limit);
+
+    if (cancelled && cancelled())
+        return list;
+
+    if (!query.exec()) {
+        logQueryError(query);
+        return list;
+    }
+
+    while (query.next()) {
+        if (cancelled && cancelled()) {
+            list.clear();
+            break;
+        }
+        ArtistData artist;
+        artist.id = query.value(0).toLongLong();
+        artist.name = query.value(1).toString();
+        artist.count = query.value(2).toInt();
+        artist.length = query.value(3).toInt();
+        artist.key << artist.name << artist.id;
+        list << artist;
+    }
+
+    return list;
+}
+
+QList<Library::TrackData> Library::tracksByAlbum(qint64 albumId, const QString &filter,
+                                                 const QVariantList &after, int limit,
+                                                 const CancelCheck &cancelled)
+{
+    QList<TrackData> list;
+
+    auto db = Library::db();
+    if (!db.isOpen())
+        return list;
+
+    const auto match = ftsQuery(filter, "title");
+
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT t.id, t.path, t.title, ar.name, al.title, "
+                          "t.mime, t.number, t.length "
+                          "FROM tracks t "
+                          "JOIN artists ar ON ar.id = t.artist_id "
+                          "JOIN albums al ON al.id = t.album_id "
+                          "WHERE t.album_id = ? %1 %2 "
+                          "ORDER BY t.number, t.id LIMIT ?").arg(
+                      match.isEmpty() ? QString() :
+                      "AND t.id IN (SELECT docid FROM tracks_fts WHERE tracks_fts MATCH ?)",
+                      after.isEmpty() ? QString() : "AND (t.number, t.id) > (?, ?)"));
+
+    query.addBindValue(albumId);
+    if (!match.isEmpty())
+        query.addBindValue(match);
+    for (const auto &value : after)
+        query.addBindValue(value);
+    query.addBindValue(limit);
+
+    if (cancelled && cancelled())
+        return list;
+
+    if (!query.exec()) {
+        logQueryError(query);
+        return list;
+    }
+
+    while (query.next()) {
+        if (cancelled && cancelled()) {
+            list.clear();
+            break;
+        }
+        TrackData track;
+        track.id = query.value(0).toLongLong();
+        track.path = query.value(1).toString();
+        track.title = query.value(2).toString();
+        track.artist = query.value(3).toString();
+        track.album = query.value(4).toString();
+        track.mime = query.value(5).toString();
+        track.number = query.value(6).toInt();
+        track.length = query.value(7).toInt();
+        track.key << track.number << track.id;
+        list << track;
+    }
+
+    return list;
+}
+
+QList<Library::TrackData> Library::tracksByArtist(qint64 artistId, const QString &filter,
+                                                  const QVariantList &after, int limit,
+                                                  const CancelCheck &cancelled)
+{
+    QList<TrackData> list;
+
+    auto db = Library::db();
+    if (!db.isOpen())
+        return list;
+
+    const auto match = ftsQuery(filter, "title");
+
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT t.id, t.path, t.title, ar.name, al.title, "
+                          "t.mime, t.number, t.length "
+                          "FROM tracks t "
+                          "JOIN artists ar ON ar.id = t.artist_id "
+                          "JOIN albums al ON al.id = t.album_id "
+                          "WHERE t.artist_id = ? %1 %2 "
+                          "ORDER BY al.title COLLATE NOCASE, t.number, t.id LIMIT ?").arg(
+                      match.isEmpty() ? QString() :
+                      "AND t.id IN (SELECT docid FROM tracks_fts WHERE tracks_fts MATCH ?)",
+                      after.isEmpty() ? QString() :
+                      "AND (al.title COLLATE NOCASE, t.number, t.id) > (?, ?, ?)"));
+
+    query.addBindValue(artistId);
+    if (!match.isEmpty())
+        query.addBindValue(match);
+    for (const auto &value : after)
+        query.addBindValue(value);
+    query.addBindValue(limit);
+
+    if (cancelled && cancelled())
+        return list;
+
+    if (!query.exec()) {
+        logQueryError(query);
+        return list;
+    }
+
+    while (query.next()) {
+        if (cancelled && cancelled()) {
+            list.clear();
+            break;
+        }
+        TrackData track;
+        track.id = query.value(0).toLongLong();
+        track.path = query.value(1).toString();
+        track.title = query.value(2).toString();
+        track.artist = query.value(3).toString();
+        track.album = query.value(4).toString();
+        track.mime = query.value(5).toString();
+        track.number = query.value(6).toInt();
+        track.length = query.value(7).toInt();
+        track.key << track.album << track.number << track.id;
+        list << track;
+    }
+
+    return list;
+}
+
+void Library::rescan()
+{
+    m_dirtyMutex.lock();
+    m_fullScan = true;
+    m_dirtyMutex.unlock();
+
+    startScan();
+}
+
+void Library::libraryDirsChangedHandler()
+{
+    m_dirtyMutex.lock();
+    m_roots = Settings::instance()->getLibraryDirs();
+    m_dirtyMutex.unlock();
+
+    rescan();
+}
+
+void Library::dirChangedHandler(const QString &path)
+{
+    m_dirtyMutex.lock();
+    m_dirtyDirs.insert(path);
+    m_dirtyMutex.unlock();
+
+    // Changes are collected for a while, because copying
+    // an album triggers many notifications
+    m_changeTimer.start();
+}
+
+void Library::dirsChangedHandler()
+{
+    startScan();
+}
+
+void Library::watchDirs(const QStringList &dirs, bool replace)
+{
+    if (replace && !m_watcher.directories().isEmpty())
+        m_watcher.removePaths(m_watcher.directories());
+
+    auto newDirs = dirs.toSet().subtract(m_watcher.directories().toSet());
+    if (!newDirs.isEmpty())
+        m_watcher.addPaths(newDirs.toList());
+}
+
+void Library::startScan()
+{
+    m_dirtyMutex.lock();
+    if (m_scanning) {
+        // Pending changes will be picked up by the running scan
+        m_dirtyMutex.unlock();
+        return;
+    }
+    m_scanning = true;
+    m_dirtyMutex.unlock();
+
+    emit scanningChanged();
+
+    if (!startTask([this]{ scan(); })) {
+        qWarning() << "Cannot start library scan, retrying later";
+        m_dirtyMutex.lock();
+        m_scanning = false;
+        m_dirtyMutex.unlock();
+        emit scanningChanged();
+        m_changeTimer.start();
+    }
+}
+
+void Library::scan()
+{
+    auto db = Library::db();
+    if (!db.isOpen()) {
+        m_dirtyMutex.lock();
+        m_scanning = false;
+        m_dirtyMutex.unlock();
+        emit scanningChanged();
+        return;
+    }
+
+    while (true) {
+        m_dirtyMutex.lock();
+        const bool full = m_fullScan;
+        const auto roots = m_roots;
+        const auto dirs = m_dirtyDirs.toList();
+        m_fullScan = false;
+        m_dirtyDirs.clear();
+        if (!full && dirs.isEmpty()) {
+            m_scanning = false;
+            m_dirtyMutex.unlock();
+            break;
+        }
+        m_dirtyMutex.unlock();
+
+        QStringList watch;
+        bool updated;
+
+        if (full) {
+            qDebug() << "Full library scan:" << roots;
+            auto t = QDateTime::currentMSecsSinceEpoch();
+            updated = removeOutside(db, roots);
+            updated = updateDirs(db, roots, true, watch) || updated;
+            qDebug() << "Full library scan done in"
+                     << QDateTime::currentMSecsSinceEpoch() - t << "ms";
+        } else {
+            qDebug() << "Library update for dirs:" << dirs;
+            updated = updateDirs(db, dirs, false, watch);
+        }
+
+        if (!watch.isEmpty() || full)
+            QMetaObject::invokeMethod(this, "watchDirs", Qt::QueuedConnection,
+                                      Q_ARG(QStringList, watch), Q_ARG(bool, full));
+
+        if (updated)
+            emit changed();
+    }
+
+    emit scanningChanged();
+}
+
+void Library::readTags(FileData &file)
+{
+    TagLib::FileRef f(file.path.toUtf8().constData());
+    if (f.isNull()) {
+        qWarning() << "Cannot extract meta data with TagLib:" << file.path;
+    } else {
+        if (f.tag()) {
+            auto tag = f.tag();
+            file.title = QString::fromWCharArray(tag->title().toCWString());
+            file.artist = QString::fromWCharArray(tag->artist().toCWString());
+            file.album = QString::fromWCharArray(tag->album().toCWString());
+            file.number = static_cast<int>(tag->track());
+        }
+
+        if (f.audioProperties())
+            file.length = f.audioProperties()->length();
+    }
+
+    if (file.title.isEmpty())
+        file.title = QFileInfo(file.path).completeBaseName();
+    file.mime = ContentServer::getContentMimeByExtension(file.path);
+}
+
+bool Library::updateDirs(QSqlDatabase &db, const QStringList &dirs, bool recursive,
+                         QStringList &watchDirs)
+{
+    const auto filters = ContentServer::instance()->getExtensions(ContentServer::TypeMusic);
+
+    QHash<QString, QPair<qint64, qint64>> known; // path => (mtime, size)
+    QVector<FileData> changed;
+    QStringList removed;
+    QStringList newDirs;
+
+    QSqlQuery query(db);
+    query.prepare(recursive ?
+                  "SELECT path, mtime, size FROM tracks "
+                  "WHERE dir = ? OR (dir >= ? AND dir < ?)" :
+                  "SELECT path, mtime, size FROM tracks WHERE dir = ?");
+
+    for (const auto &dir : dirs) {
+        const auto cleanDir = QDir::cleanPath(dir);
+        query.addBindValue(cleanDir);
+        if (recursive) {
+            // Everything below 'dir/', '0' is the next character after '/'
+            query.addBindValue(cleanDir + "/");
+            query.addBindValue(cleanDir + "0");
+        }
+        if (query.exec()) {
+            while (query.next())
+                known.insert(query.value(0).toString(),
+                             qMakePair(query.value(1).toLongLong(),
+                                       query.value(2).toLongLong()));
+        } else {
+            logQueryError(query);
+            return false;
+        }
+
+        QDir d(cleanDir);
+        if (!d.exists()) {
+            // Removed dir, all tracks below it are removed too
+            if (!recursive)
+                newDirs << cleanDir;
+            continue;
+        }
+
+        watchDirs << cleanDir;
+
+        auto addFile = [&](const QFileInfo &info) {
+            const auto path = info.absoluteFilePath();
+            const auto mtime = info.lastModified().toMSecsSinceEpoch();
+            const auto it = known.find(path);
+            if (it == known.end() || it.value().first != mtime ||
+                    it.value().second != info.size()) {
+                FileData file;
+                file.path = path;
+                file.dir = info.absolutePath();
+                file.mtime = mtime;
+                file.size = info.size();
+                changed << file;
+            }
+            if (it != known.end())
+                known.erase(it);
+        };
+
+        if (recursive) {
+            QDirIterator dit(cleanDir, QDir::Dirs | QDir::NoDotAndDotDot,
+                             QDirIterator::Subdirectories);
+            while (dit.hasNext())
+                watchDirs << dit.next();
+
+            QDirIterator fit(cleanDir, filters, QDir::Files,
+                             QDirIterator::Subdirectories);
+            while (fit.hasNext()) {
+                fit.next();
+                addFile(fit.fileInfo());
+            }
+        } else {
+            for (const auto &info : d.entryInfoList(filters, QDir::Files))
+                addFile(info);
+
+            // Subdirs that are not indexed yet (e.g. just copied album)
+            // need recursive scan
+            QSqlQuery sub(db);
+            sub.prepare("SELECT 1 FROM tracks "
+                        "WHERE dir = ? OR (dir >= ? AND dir < ?) LIMIT 1");
+            for (const auto &subDir : d.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+                const auto path = d.absoluteFilePath(subDir);
+                sub.addBindValue(path);
+                sub.addBindValue(path + "/");
+                sub.addBindValue(path + "0");
+                if (sub.exec() && !sub.next())
+                    newDirs << path;
+            }
+        }
+    }
+
+    removed = known.keys();
+
+    if (!changed.isEmpty()) {
+        qDebug() << "Reading tags of" << changed.size() << "files";
+
+        // Tags are read in parallel, writing to DB is done
+        // in this thread only
+        QThreadPool pool;
+        pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+        const int chunk = 64;
+        const int size = changed.size();
+        auto data = changed.data();
+        for (int i = 0; i < size; i += chunk) {
+            auto task = new TaskExecutor::Task([data, i, chunk, size]{
+                const int end = std::min(i + chunk, size);
+                for (int j = i; j < end; ++j)
+                    readTags(data[j]);
+            });
+            task->setAutoDelete(true);
+            pool.start(task);
+        }
+        pool.waitForDone();
+    }
+
+    bool ok = true;
+    for (int i = 0; i < std::max(changed.size(), removed.size()); i += batchSize) {
+        ok = write(db, changed.mid(i, batchSize), removed.mid(i, batchSize)) && ok;
+    }
+
+    const bool updated = !changed.isEmpty() || !removed.isEmpty();
+
+    if (!newDirs.isEmpty())
+        return updateDirs(db, newDirs, true, watchDirs) || updated;
+
+    return updated;
+}
+
+bool Library::removeOutside(QSqlDatabase &db, const QStringList &roots)
+{
+    QStringList cleanRoots;
+    for (const auto &root : roots)
+        cleanRoots << QDir::cleanPath(root);
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT DISTINCT dir FROM tracks")) {
+        logQueryError(query);
+        return false;
+    }
+
+    QStringList dirs;
+    while (query.next()) {
+        const auto dir = query.value(0).toString();
+        bool inside = false;
+        for (const auto &root : cleanRoots) {
+            if (dir == root || dir.startsWith(root + "/")) {
+                inside = true;
+                break;
+            }
+        }
+        if (!inside)
+            dirs << dir;
+    }
+
+    if (dirs.isEmpty())
+        return false;
+
+    QStringList removed;
+    query.prepare("SELECT path FROM tracks WHERE dir = ?");
+    for (const auto &dir : dirs) {
+        query.addBindValue(dir);
+        if (query.exec()) {
+            while (query.next())
+                removed << query.value(0).toString();
+        } else {
+            logQueryError(query);
+        }
+    }
+
+    qDebug() << "Removing" << removed.size() << "tracks outside library dirs";
+
+    for (int i = 0; i < removed.size(); i += batchSize)
+        write(db, QVector<FileData>(), removed.mid(i, batchSize));
+
+    return true;
+}
+
+bool Library::write(QSqlDatabase &db, const QVector<FileData> &files,
+                    const QStringList &removed)
+{
+    if (files.isEmpty() && removed.isEmpty())
+        return true;
+
+    if (!db.transaction()) {
+        qWarning() << "Cannot start library DB transaction:" << db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery findTrack(db);
+    findTrack.prepare("SELECT id FROM tracks WHERE path = ?");
+
+    if (!removed.isEmpty()) {
+        QSqlQuery delTrack(db), delFts(db);
+        delTrack.prepare("DELETE FROM tracks WHERE id = ?");
+        delFts.prepare("DELETE FROM tracks_fts WHERE docid = ?");
+
+        for (const auto &path : removed) {
+            findTrack.addBindValue(path);
+            if (findTrack.exec() && findTrack.next()) {
+                const auto id = findTrack.value(0);
+                delTrack.addBindValue(id);
+                delTrack.exec();
+                delFts.addBindValue(id);
+                delFts.exec();
+            }
+        }
+    }
+
+    if (!files.isEmpty()) {
+        QSqlQuery addArtist(db), findArtist(db), addAlbum(db), findAlbum(db),
+                addTrack(db), updateTrack(db), addFts(db), updateFts(db);
+        addArtist.prepare("INSERT OR IGNORE INTO artists (name) VALUES (?)");
+        findArtist.prepare("SELECT id FROM artists WHERE name = ?");
+        addAlbum.prepare("INSERT OR IGNORE INTO albums (title, artist_id, art) "
+                         "VALUES (?, ?, ?)");
+        findAlbum.prepare("SELECT id FROM albums WHERE title = ? AND artist_id = ?");
+        addTrack.prepare("INSERT INTO tracks (path, dir, mtime, size, title, "
+                         "artist_id, album_id, number, length, mime) "
+                         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        updateTrack.prepare("UPDATE tracks SET dir = ?, mtime = ?, size = ?, "
+                            "title = ?, artist_id = ?, album_id = ?, number = ?, "
+                            "length = ?, mime = ? WHERE id = ?");
+        addFts.prepare("INSERT INTO tracks_fts (docid, title, artist, album) "
+                       "VALUES (?, ?, ?, ?)");
+        updateFts.prepare("UPDATE tracks_fts SET title = ?, artist = ?, album = ? "
+                          "WHERE docid = ?");
+
+        QHash<QString, QVariant> artists; // name => id
+        QHash<QString, QVariant> albums; // title + artist id => id
+
+        for (const auto &file : files) {
+            auto artistId = artists.value(file.artist);
+            if (!artistId.isValid()) {
+                addArtist.addBindValue(file.artist);
+                addArtist.exec();
+                findArtist.addBindValue(file.artist);
+                if (findArtist.exec() && findArtist.next())
+                    artistId = findArtist.value(0);
+                artists.insert(file.artist, artistId);
+            }
+
+            const auto albumKey = file.album + "\n" + artistId.toString();
+            auto albumId = albums.value(albumKey);
+            if (!albumId.isValid()) {
+                addAlbum.addBindValue(file.album);
+                addAlbum.addBindValue(artistId);
+                addAlbum.addBindValue(artForDir(file.dir));
+                addAlbum.exec();
+                findAlbum.addBindValue(file.album);
+                findAlbum.addBindValue(artistId);
+                if (findAlbum.exec() && findAlbum.next())
+                    albumId = findAlbum.value(0);
+                albums.insert(albumKey, albumId);
+            }
+
+            findTrack.addBindValue(file.path);
+            if (findTrack.exec() && findTrack.next()) {
+                const auto id = findTrack.value(0);
+                updateTrack.addBindValue(file.dir);
+                updateTrack.addBindValue(file.mtime);
+                updateTrack.addBindValue(file.size);
+                updateTrack.addBindValue(file.title);
+                updateTrack.addBindValue(artistId);
+                updateTrack.addBindValue(albumId);
+                updateTrack.addBindValue(file.number);
+                updateTrack.addBindValue(file.length);
+                updateTrack.addBindValue(file.mime);
+                updateTrack.addBindValue(id);
+                if (!updateTrack.exec())
+                    logQueryError(updateTrack);
+                updateFts.addBindValue(file.title);
+                updateFts.addBindValue(file.artist);
+                updateFts.addBindValue(file.album);
+                updateFts.addBindValue(id);
+                updateFts.exec();
+            } else {
+                addTrack.addBindValue(file.path);
+                addTrack.addBindValue(file.dir);
+                addTrack.addBindValue(file.mtime);
+                addTrack.addBindValue(file.size);
+                addTrack.addBindValue(file.title);
+                addTrack.addBindValue(artistId);
+                addTrack.addBindValue(albumId);
+                addTrack.addBindValue(file.number);
+                addTrack.addBindValue(file.length);
+                addTrack.addBindValue(file.mime);
+                if (addTrack.exec()) {
+                    addFts.addBindValue(addTrack.lastInsertId());
+                    addFts.addBindValue(file.title);
+                    addFts.addBindValue(file.artist);
+                    addFts.addBindValue(file.album);
+                    addFts.exec();
+                } else {
+                    logQueryError(addTrack);
+                }
+            }
+        }
+    }
+
+    QSqlQuery query(db);
+    query.exec("DELETE FROM albums WHERE id NOT IN (SELECT album_id FROM tracks)");
+    query.exec("DELETE FROM artists WHERE id NOT IN (SELECT artist_id FROM tracks)");
+
+    if (!db.commit()) {
+        qWarning() << "Cannot commit library DB transaction:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    return true;
+}
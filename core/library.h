@@ -0,0 +1,149 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QSqlDatabase>
+#include <functional>
+
+#include "taskexecutor.h"
+
+// Local media index used instead of Tracker on desktop.
+// Tracks are kept in SQLite database and updated incrementally
+// when watched directories change.
+
+class Library :
+        public QObject,
+        public TaskExecutor
+{
+    Q_OBJECT
+    Q_PROPERTY (bool scanning READ isScanning NOTIFY scanningChanged)
+
+public:
+    struct AlbumData {
+        qint64 id = 0;
+        QString title;
+        QString artist;
+        QString art;
+        int count = 0;
+        int length = 0;
+        QVariantList key; // sort key for keyset pagination
+    };
+
+    struct ArtistData {
+        qint64 id = 0;
+        QString name;
+        int count = 0;
+        int length = 0;
+        QVariantList key;
+    };
+
+    struct TrackData {
+        qint64 id = 0;
+        QString path;
+        QString title;
+        QString artist;
+        QString album;
+        QString mime;
+        int number = 0;
+        int length = 0;
+        QVariantList key;
+    };
+
+    // Returns true when query result is not needed anymore
+    typedef std::function<bool()> CancelCheck;
+
+    static Library* instance(QObject *parent = nullptr);
+
+    bool isScanning();
+
+    // Queries return at most 'limit' rows following row with 'after' key
+    // (empty key means first page)
+    QList<AlbumData> albums(const QString &filter, bool byArtist,
+                            const QVariantList &after = QVariantList(),
+                            int limit = 100,
+                            const CancelCheck &cancelled = CancelCheck());
+    QList<ArtistData> artists(const QString &filter,
+                              const QVariantList &after = QVariantList(),
+                              int limit = 100,
+                              const CancelCheck &cancelled = CancelCheck());
+    QList<TrackData> tracksByAlbum(qint64 albumId, const QString &filter,
+                                   const QVariantList &after = QVariantList(),
+                                   int limit = 50,
+                                   const CancelCheck &cancelled = CancelCheck());
+    QList<TrackData> tracksByArtist(qint64 artistId, const QString &filter,
+                                    const QVariantList &after = QVariantList(),
+                                    int limit = 50,
+                                    const CancelCheck &cancelled = CancelCheck());
+
+public slots:
+    void rescan();
+
+signals:
+    void scanningChanged();
+    void changed();
+
+private slots:
+    void dirChangedHandler(const QString &path);
+    void dirsChangedHandler();
+    void libraryDirsChangedHandler();
+    void watchDirs(const QStringList &dirs, bool replace);
+
+private:
+    struct FileData {
+        QString path;
+        QString dir;
+        qint64 mtime = 0;
+        qint64 size = 0;
+        QString title;
+        QString artist;
+        QString album;
+        QString mime;
+        int number = 0;
+        int length = 0;
+    };
+
+    static Library* m_instance;
+    static const int batchSize = 500;
+    static const int changeDelay = 2000; // ms
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_changeTimer;
+    QSet<QString> m_dirtyDirs;
+    QStringList m_roots;
+    QMutex m_dirtyMutex;
+    bool m_fullScan = false;
+    bool m_scanning = false;
+
+    explicit Library(QObject *parent = nullptr);
+    static QSqlDatabase db();
+    static bool createSchema(QSqlDatabase &db);
+    static QString ftsQuery(const QString &filter, const QString &column = QString());
+    static QString artForDir(const QString &dir);
+    static void readTags(FileData &file);
+    void startScan();
+    void scan();
+    bool updateDirs(QSqlDatabase &db, const QStringList &dirs, bool recursive,
+                    QStringList &watchDirs);
+    bool removeOutside(QSqlDatabase &db, const QStringList &roots);
+    bool write(QSqlDatabase &db, const QVector<FileData> &files,
+               const QStringList &removed);
+};
+
+#endif // LIBRARY_H
@@ -1,150 +1,311 @@
-/*
- * Author: Christophe Dumez <dchris@gmail.com>
- * License: Public domain (No attribution required)
- * Website: http://cdumez.blogspot.com/
- * Version: 1.1
- */
-
-#include "listmodel.h"
-
-ListModel::ListModel(ListItem* prototype, QObject *parent) :
-    QAbstractListModel(parent), m_prototype(prototype)
-{
-#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
-#else
-    setRoleNames(m_prototype->roleNames());
-#endif
-}
-
-QHash<int, QByteArray>ListModel::roleNames() const
-{
-    return m_prototype->roleNames();
-}
-
-int ListModel::rowCount(const QModelIndex &parent) const
-{
-  Q_UNUSED(parent);
-  return m_list.size();
-}
-
-QVariant ListModel::data(const QModelIndex &index, int role) const
-{
-  if(index.row() < 0 || index.row() >= m_list.size())
-    return QVariant();
-  return m_list.at(index.row())->data(role);
-}
-
-ListModel::~ListModel() {
-  delete m_prototype;
-  clear();
-}
-
-int ListModel::indexFromId(const QString& id) const
-{
-    auto item = find(id);
-
-    if (item == 0) {
-        return -1;
-    }
-
-    auto indx = indexFromItem(item);
-    return indx.row();
-}
-
-void ListModel::appendRow(ListItem *item)
-{
-  appendRows(QList<ListItem*>() << item);
-}
-
-void ListModel::appendRows(const QList<ListItem *> &items)
-{
-  beginInsertRows(QModelIndex(), rowCount(), rowCount()+items.size()-1);
-  foreach(ListItem *item, items) {
-    connect(item, SIGNAL(dataChanged()), SLOT(handleItemChange()));
-    m_list.append(item);
-  }
-  endInsertRows();
-}
-
-void ListModel::insertRow(int row, ListItem *item)
-{
-  beginInsertRows(QModelIndex(), row, row);
-  connect(item, SIGNAL(dataChanged()), SLOT(handleItemChange()));
-  m_list.insert(row, item);
-  endInsertRows();
-}
-
-void ListModel::moveRow(int orig, int dest, const QModelIndex &parent)
-{
-    beginMoveRows(parent, orig, orig, parent, dest);
-    m_list.move(orig, dest);
-    endMoveRows();
-}
-
-void ListModel::handleItemChange()
-{
-  ListItem* item = static_cast<ListItem*>(sender());
-  QModelIndex index = indexFromItem(item);
-  if(index.isValid())
-    emit dataChanged(index, index);
-}
-
-ListItem * ListModel::find(const QString &id) const
-{
-  foreach(ListItem* item, m_list) {
-    if(item->id() == id) return item;
-  }
-  return nullptr;
-}
-
-QModelIndex ListModel::indexFromItem(const ListItem *item) const
-{
-  Q_ASSERT(item);
-  for(int row=0; row<m_list.size(); ++row) {
-    if(m_list.at(row) == item) return index(row);
-  }
-  return QModelIndex();
-}
-
-void ListModel::clear()
-{
-  qDeleteAll(m_list);
-  m_list.clear();
-}
-
-bool ListModel::removeRow(int row, const QModelIndex &parent)
-{
-  Q_UNUSED(parent);
-  if(row < 0 || row >= m_list.size()) return false;
-  beginRemoveRows(QModelIndex(), row, row);
-  delete m_list.takeAt(row);
-  endRemoveRows();
-  return true;
-}
-
-bool ListModel::removeRows(int row, int count, const QModelIndex &parent)
-{
-  Q_UNUSED(parent);
-  if(row < 0 || (row+count) > m_list.size()) return false;
-  beginRemoveRows(QModelIndex(), row, row+count-1);
-
-  for(int i=0; i<count; ++i) {
-    delete m_list.takeAt(row);
-    //m_list.takeAt(row);
-  }
-  endRemoveRows();
-  return true;
-}
-
-ListItem * ListModel::takeRow(int row)
-{
-  beginRemoveRows(QModelIndex(), row, row);
-  ListItem* item = m_list.takeAt(row);
-  endRemoveRows();
-  return item;
-}
-
-ListItem * ListModel::readRow(int row)
-{
-  return m_list.at(row);
-}
+/*
+ * Author: Christophe Dumez <dchris@gmail.com>
+ * License: Public domain (No attribution required)
+ * Website: http://cdumez.blogspot.com/
+ * Version: 1.1
+ */
+
+#include "listmodel.h"
+
+ListModel::ListModel(ListItem* prototype, QObject *parent) :
+    QAbstractListModel(parent), m_prototype(prototype)
+{
+  auto columns = m_prototype->columns();
+  if(!columns.isEmpty())
+    m_store = new RowStore(columns);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#else
+    setRoleNames(m_prototype->roleNames());
+#endif
+}
+
+QHash<int, QByteArray>ListModel::roleNames() const
+{
+    return m_prototype->roleNames();
+}
+
+int ListModel::rowCount(const QModelIndex &parent) const
+{
+  Q_UNUSED(parent);
+  return m_list.size();
+}
+
+QVariant ListModel::data(const QModelIndex &index, int role) const
+{
+  if(index.row() < 0 || index.row() >= m_list.size())
+    return QVariant();
+  return m_list.at(index.row())->data(role);
+}
+
+ListModel::~ListModel() {
+  delete m_prototype;
+  clear();
+  delete m_store;
+}
+
+int ListModel::indexFromId(const QString& id) const
+{
+    auto item = find(id);
+
+    if (item == 0) {
+        return -1;
+    }
+
+    auto indx = indexFromItem(item);
+    return indx.row();
+}
+
+void ListModel::appendRow(ListItem *item)
+{
+  appendRows(QList<ListItem*>() << item);
+}
+
+void ListModel::addToIndex(ListItem *item)
+{
+  m_idIndex.insert(item->id(), item);
+  foreach(const QString &key, item->keys())
+    m_keyIndex.insert(key, item);
+}
+
+void ListModel::removeFromIndex(ListItem *item)
+{
+  m_idIndex.remove(item->id(), item);
+  foreach(const QString &key, item->keys())
+    m_keyIndex.remove(key, item);
+  m_rows.remove(item);
+  if(m_store && item->m_slot >= 0) {
+    m_store->remove(item->m_slot);
+    item->m_slot = -1;
+  }
+}
+
+// Values of the item are moved to the store
+void ListModel::storeItem(ListItem *item)
+{
+  item->m_model = this;
+  if(m_store) {
+    item->m_slot = m_store->add(item->m_values);
+    item->m_values = RowStore::Values();
+  }
+}
+
+// Values of the item are moved back from the store
+void ListModel::unstoreItem(ListItem *item)
+{
+  if(m_store && item->m_slot >= 0) {
+    item->m_values = m_store->take(item->m_slot);
+    item->m_slot = -1;
+  }
+  item->m_model = nullptr;
+}
+
+// Stores positions of rows in [from, to), cost is proportional to number
+// of shifted rows, i.e. the same as of the list edit itself
+void ListModel::updateRows(int from, int to)
+{
+  to = qMin(to, m_list.size());
+  for(int row = qMax(from, 0); row < to; ++row)
+    m_rows.insert(m_list.at(row), row);
+}
+
+int ListModel::rowOf(const ListItem *item) const
+{
+  return m_rows.value(item, -1);
+}
+
+ListItem * ListModel::firstOf(const QList<ListItem*> &items) const
+{
+  if(items.isEmpty())
+    return nullptr;
+  if(items.size() == 1)
+    return items.first();
+
+  ListItem* first = items.first();
+  int firstRow = rowOf(first);
+  for(int i = 1; i < items.size(); ++i) {
+    int row = rowOf(items.at(i));
+    if(row < firstRow) {
+      first = items.at(i);
+      firstRow = row;
+    }
+  }
+
+  return first;
+}
+
+void ListModel::appendRows(const QList<ListItem *> &items)
+{
+  beginInsertRows(QModelIndex(), rowCount(), rowCount()+items.size()-1);
+  int first = m_list.size();
+  foreach(ListItem *item, items) {
+    storeItem(item);
+    m_list.append(item);
+    addToIndex(item);
+  }
+  updateRows(first, m_list.size());
+  endInsertRows();
+}
+
+void ListModel::insertRow(int row, ListItem *item)
+{
+  beginInsertRows(QModelIndex(), row, row);
+  storeItem(item);
+  m_list.insert(row, item);
+  addToIndex(item);
+  updateRows(row, m_list.size());
+  endInsertRows();
+}
+
+void ListModel::insertItems(int row, const QList<ListItem*> &items)
+{
+  if(items.isEmpty()) return;
+  beginInsertRows(QModelIndex(), row, row+items.size()-1);
+  for(int i=0; i<items.size(); ++i) {
+    ListItem* item = items.at(i);
+    storeItem(item);
+    m_list.insert(row+i, item);
+    addToIndex(item);
+  }
+  updateRows(row, m_list.size());
+  endInsertRows();
+}
+
+void ListModel::replaceRow(int row, ListItem *item)
+{
+  ListItem* old = m_list.at(row);
+  removeFromIndex(old);
+  m_list[row] = item;
+  storeItem(item);
+  addToIndex(item);
+  updateRows(row, row + 1);
+  delete old;
+  QModelIndex idx = index(row);
+  emit dataChanged(idx, idx);
+}
+
+void ListModel::moveRow(int orig, int dest, const QModelIndex &parent)
+{
+    beginMoveRows(parent, orig, orig, parent, dest);
+    m_list.move(orig, dest);
+    updateRows(qMin(orig, dest), qMax(orig, dest) + 1);
+    endMoveRows();
+}
+
+QVariant ListItem::value(int role) const
+{
+  if(m_slot >= 0)
+    return m_model->m_store->value(m_slot, role);
+
+  for(const auto &v : m_values) {
+    if(v.first == role)
+      return v.second;
+  }
+
+  return QVariant();
+}
+
+bool ListItem::setValue(int role, const QVariant &value)
+{
+  if(m_slot >= 0)
+    return m_model->m_store->setValue(m_slot, role, value);
+
+  for(auto &v : m_values) {
+    if(v.first == role) {
+      if(v.second == value)
+        return false;
+      v.second = value;
+      return true;
+    }
+  }
+
+  m_values.append(qMakePair(role, value));
+  return true;
+}
+
+void ListItem::dataChanged()
+{
+  if(m_model) m_model->itemChanged(this);
+}
+
+void ListModel::itemChanged(ListItem *item)
+{
+  QModelIndex index = indexFromItem(item);
+  if(index.isValid())
+    emit dataChanged(index, index);
+}
+
+ListItem * ListModel::find(const QString &id) const
+{
+  return firstOf(m_idIndex.values(id));
+}
+
+ListItem * ListModel::findByKey(const QString &key) const
+{
+  return firstOf(m_keyIndex.values(key));
+}
+
+QModelIndex ListModel::indexFromItem(const ListItem *item) const
+{
+  Q_ASSERT(item);
+  int row = rowOf(item);
+  if(row >= 0) return index(row);
+  return QModelIndex();
+}
+
+void ListModel::clear()
+{
+  qDeleteAll(m_list);
+  m_list.clear();
+  m_idIndex.clear();
+  m_keyIndex.clear();
+  m_rows.clear();
+  if(m_store)
+    m_store->clear();
+}
+
+bool ListModel::removeRow(int row, const QModelIndex &parent)
+{
+  Q_UNUSED(parent);
+  if(row < 0 || row >= m_list.size()) return false;
+  beginRemoveRows(QModelIndex(), row, row);
+  ListItem* item = m_list.takeAt(row);
+  removeFromIndex(item);
+  delete item;
+  updateRows(row, m_list.size());
+  endRemoveRows();
+  return true;
+}
+
+bool ListModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+  Q_UNUSED(parent);
+  if(row < 0 || (row+count) > m_list.size()) return false;
+  beginRemoveRows(QModelIndex(), row, row+count-1);
+
+  for(int i=0; i<count; ++i) {
+    ListItem* item = m_list.takeAt(row);
+    removeFromIndex(item);
+    delete item;
+    //m_list.takeAt(row);
+  }
+  updateRows(row, m_list.size());
+  endRemoveRows();
+  return true;
+}
+
+ListItem * ListModel::takeRow(int row)
+{
+  beginRemoveRows(QModelIndex(), row, row);
+  ListItem* item = m_list.takeAt(row);
+  unstoreItem(item);
+  removeFromIndex(item);
+  updateRows(row, m_list.size());
+  endRemoveRows();
+  return item;
+}
+
+ListItem * ListModel::readRow(int row)
+{
+  return m_list.at(row);
+}
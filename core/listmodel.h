@@ -1,64 +1,107 @@
-/*
- * Author: Christophe Dumez <dchris@gmail.com>
- * License: Public domain (No attribution required)
- * Website: http://cdumez.blogspot.com/
- * Version: 1.0
- */
-
-#ifndef LISTMODEL_H
-#define LISTMODEL_H
-
-#include <QAbstractListModel>
-#include <QList>
-#include <QVariant>
-#include <QDebug>
-#include <QString>
-
-class ListItem: public QObject {
-    Q_OBJECT
-
-public:
-    ListItem(QObject* parent = 0) : QObject(parent) {}
-    virtual ~ListItem() {}
-    virtual QString id() const = 0;
-    virtual QVariant data(int role) const = 0;
-    virtual QHash<int, QByteArray> roleNames() const = 0;
-
-signals:
-    void dataChanged();
-};
-
-class ListModel : public QAbstractListModel
-{
-    Q_OBJECT
-
-public:
-    explicit ListModel(ListItem* prototype, QObject* parent = 0);
-    ~ListModel();
-    int rowCount(const QModelIndex &parent = QModelIndex()) const;
-    QHash<int, QByteArray> roleNames() const;
-    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
-    void appendRow(ListItem* item);
-    void appendRows(const QList<ListItem*> &items);
-    void insertRow(int row, ListItem* item);
-    bool removeRow(int row, const QModelIndex &parent = QModelIndex());
-    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
-    void moveRow(int orig, int dest, const QModelIndex &parent = QModelIndex());
-    ListItem* takeRow(int row);
-    ListItem* readRow(int row);
-    ListItem* find(const QString &id) const;
-    QModelIndex indexFromItem( const ListItem* item) const;
-    int indexFromId(const QString& id) const;
-    void clear();
-
-private slots:
-    void handleItemChange();
-
-protected:
-    QList<ListItem*> m_list;
-
-private:
-    ListItem* m_prototype;
-};
-
-#endif // LISTMODEL_H
+/*
+ * Author: Christophe Dumez <dchris@gmail.com>
+ * License: Public domain (No attribution required)
+ * Website: http://cdumez.blogspot.com/
+ * Version: 1.0
+ */
+
+#ifndef LISTMODEL_H
+#define LISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QVariant>
+#include <QDebug>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMetaType>
+
+#include "rowstore.h"
+
+class ListModel;
+
+// Items are plain objects (not QObjects), so they are cheap to create
+// in worker threads. Change of item data is reported directly to
+// the model which owns the item.
+// Item which returns columns keeps values of these roles in the row
+// store of its model, so item itself is only a small handle. Item
+// which is not in a model keeps its values by itself.
+class ListItem {
+    friend class ListModel;
+
+public:
+    ListItem() {}
+    virtual ~ListItem() {}
+    virtual QString id() const = 0;
+    virtual QVariant data(int role) const = 0;
+    virtual QHash<int, QByteArray> roleNames() const = 0;
+    // Additional lookup keys, must not change when item is in a model
+    virtual QStringList keys() const { return QStringList(); }
+
+protected:
+    void dataChanged();
+    virtual QList<RowStore::Column> columns() const { return QList<RowStore::Column>(); }
+    QVariant value(int role) const;
+    // Returns true when value has changed
+    bool setValue(int role, const QVariant &value);
+
+private:
+    Q_DISABLE_COPY(ListItem)
+    ListModel* m_model = nullptr;
+    int m_slot = -1; // row in store of the model
+    RowStore::Values m_values; // when item is not stored
+};
+
+Q_DECLARE_METATYPE(ListItem*)
+
+class ListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ListModel(ListItem* prototype, QObject* parent = 0);
+    ~ListModel();
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QHash<int, QByteArray> roleNames() const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    void appendRow(ListItem* item);
+    void appendRows(const QList<ListItem*> &items);
+    void insertRow(int row, ListItem* item);
+    void insertItems(int row, const QList<ListItem*> &items);
+    void replaceRow(int row, ListItem* item);
+    bool removeRow(int row, const QModelIndex &parent = QModelIndex());
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+    void moveRow(int orig, int dest, const QModelIndex &parent = QModelIndex());
+    ListItem* takeRow(int row);
+    ListItem* readRow(int row);
+    ListItem* find(const QString &id) const;
+    ListItem* findByKey(const QString &key) const;
+    QModelIndex indexFromItem( const ListItem* item) const;
+    int indexFromId(const QString& id) const;
+    void clear();
+
+protected:
+    QList<ListItem*> m_list;
+
+private:
+    ListItem* m_prototype;
+    RowStore* m_store = nullptr; // when prototype has columns
+    QMultiHash<QString, ListItem*> m_idIndex;
+    QMultiHash<QString, ListItem*> m_keyIndex;
+    // Row positions, rows shifted by insert, remove or move are updated
+    // at once, so lookup is always constant time
+    QHash<const ListItem*, int> m_rows;
+
+    friend class ListItem;
+    void itemChanged(ListItem* item);
+    void addToIndex(ListItem* item);
+    void removeFromIndex(ListItem* item);
+    void storeItem(ListItem* item);
+    void unstoreItem(ListItem* item);
+    void updateRows(int from, int to);
+    int rowOf(const ListItem* item) const;
+    ListItem* firstOf(const QList<ListItem*> &items) const;
+};
+
+#endif // LISTMODEL_H
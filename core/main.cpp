@@ -54,6 +54,9 @@
 #include "icecastmodel.h"
 #include "dirmodel.h"
 #include "recmodel.h"
+#include "querycache.h"
+#include "dirscanner.h"
+#include "actionstats.h"
 #ifdef LOGTOFILE
 #include "log.h"
 #endif
@@ -131,6 +134,9 @@ int main(int argc, char *argv[])
     auto cserver = ContentServer::instance();
     auto services = Services::instance();
     auto playlist = PlaylistModel::instance();
+    QueryCache::instance(); // must be created in main thread
+    DirScanner::instance();
+    ActionStats::instance(); // must be created in main thread
     DbusProxy dbusProxy;
 
 #ifdef SAILFISH
@@ -118,9 +118,7 @@ PlaylistFileItem::PlaylistFileItem(const QString &id,
                    const QString &path,
                    const QUrl &url,
                    int count,
-                   int length,
-                   QObject *parent) :
-    SelectableItem(parent),
+                   int length) :
     m_id(id),
     m_title(title),
     m_list(list),
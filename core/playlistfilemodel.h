@@ -23,7 +23,6 @@
 
 class PlaylistFileItem : public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         TitleRole = Qt::DisplayRole,
@@ -36,15 +35,14 @@ public:
     };
 
 public:
-    PlaylistFileItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    PlaylistFileItem() {}
     explicit PlaylistFileItem(const QString &id,
                       const QString &title,
                       const QString &list,
                       const QString &path,
                       const QUrl &url,
                       int count,
-                      int length,
-                      QObject *parent = 0);
+                      int length);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -13,6 +13,11 @@
 #include <QDataStream>
 #include <QUrlQuery>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QVector>
+#include <algorithm>
 #include <utility>
 
 #include "playlistmodel.h"
@@ -20,6 +25,8 @@
 #include "filemetadata.h"
 #include "settings.h"
 #include "services.h"
+#include "taskexecutor.h"
+#include "dirscanner.h"
 
 #ifdef DESKTOP
 //#include <QPixmap>
@@ -38,7 +45,8 @@ PlaylistWorker::PlaylistWorker(const QList<UrlItem> &&urls,
     QThread(parent),
     urls(urls),
     asAudio(asAudio),
-    urlIsId(urlIsId)
+    urlIsId(urlIsId),
+    imageSupported(Settings::instance()->getImageSupported())
 {
 }
 
@@ -50,57 +58,73 @@ void PlaylistWorker::run()
         for (const auto &purl : urls)
             ids << purl.url;
     } else {
-        QList<UrlItem> nurls;
+        // Directories are replaced by media files found in them
+        QList<ContentServer::Type> types;
+        types << ContentServer::TypeMusic << ContentServer::TypeVideo;
+        if (imageSupported && !asAudio)
+            types << ContentServer::TypeImage;
+
+        QList<UrlItem> furls;
+        for (const auto &url : urls) {
+            if (url.url.isLocalFile() && QFileInfo(url.url.toLocalFile()).isDir()) {
+                auto path = url.url.toLocalFile();
+                qDebug() << "Importing dir" << path;
+                auto files = DirScanner::instance()->scan(QStringList() << path, types);
+                if (files.isEmpty())
+                    qWarning() << "Dir doesn't contain any media files";
+                for (const auto &file : files) {
+                    UrlItem ui; ui.url = QUrl::fromLocalFile(file);
+                    furls << ui;
+                }
+            } else {
+                furls << url;
+            }
+        }
+        urls = furls;
 
         // check for playlists
-        for (const auto& url : urls) {
-            bool isPlaylist = false;
-
-            if (url.url.isLocalFile()) {
-                auto type = ContentServer::getContentTypeByExtension(url.url.path());
-                if (type == ContentServer::TypePlaylist) {
-                    isPlaylist = true;
-                    auto path = url.url.toLocalFile();
-                    qDebug() << "File" << path << "is a playlist";
-
-                    QFile f(path);
-                    if (f.exists()) {
-                        if (f.open(QIODevice::ReadOnly)) {
-                            auto data = f.readAll();
-                            f.close();
-                            if (!data.isEmpty()) {
-                                QFileInfo fi(f); auto dir = fi.absoluteDir().path();
-                                auto ptype = ContentServer::playlistTypeFromExtension(path);
-                                auto items = ptype == ContentServer::PlaylistPLS ?
-                                             ContentServer::parsePls(data, dir) :
-                                                ptype == ContentServer::PlaylistXSPF ?
-                                                ContentServer::parseXspf(data, dir) :
-                                                    ContentServer::parseM3u(data, dir);
-
-                                if (items.isEmpty()) {
-                                    qWarning() << "Playlist doesn't contain any valid items";
-                                } else {
-                                    for (const auto& item : items) {
-                                        // TODO: Consider playlist item title as well
-                                        UrlItem ui; ui.url = item.url;
-                                        nurls << ui;
-                                    }
-                                }
-                            } else {
-                                qWarning() << "Playlist content is empty";
-                            }
-                        } else {
-                            qWarning() << "Cannot open file" << f.fileName() <<
-                                          "for reading (" + f.errorString() + ")";
-                        }
-                    } else {
-                        qWarning() << "File" << f.fileName() << "doesn't exist";
-                    }
-                }
+        QVector<int> playlists; // indexes of urls that are playlists
+        for (int i = 0; i < urls.size(); ++i) {
+            const auto &url = urls.at(i).url;
+            if (url.isLocalFile() &&
+                ContentServer::getContentTypeByExtension(url.path()) ==
+                    ContentServer::TypePlaylist) {
+                qDebug() << "File" << url.toLocalFile() << "is a playlist";
+                playlists << i;
             }
+        }
 
-            if (!isPlaylist)
-                nurls << url;
+        // Playlists are parsed in parallel, result order is kept
+        QVector<QList<ContentServer::PlaylistItemMeta>> items(playlists.size());
+        if (playlists.size() == 1) {
+            items[0] = ContentServer::parsePlaylistFile(
+                        urls.at(playlists.first()).url.toLocalFile());
+        } else if (playlists.size() > 1) {
+            QThreadPool pool;
+            pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+            auto data = items.data();
+            for (int i = 0; i < playlists.size(); ++i) {
+                auto path = urls.at(playlists.at(i)).url.toLocalFile();
+                auto task = new TaskExecutor::Task([data, i, path]{
+                    data[i] = ContentServer::parsePlaylistFile(path);
+                });
+                task->setAutoDelete(true);
+                pool.start(task);
+            }
+            pool.waitForDone();
+        }
+
+        QList<UrlItem> nurls;
+        for (int i = 0, p = 0; i < urls.size(); ++i) {
+            if (p < playlists.size() && playlists.at(p) == i) {
+                for (const auto& item : items.at(p)) {
+                    UrlItem ui; ui.url = item.url; ui.name = item.title;
+                    nurls << ui;
+                }
+                ++p;
+            } else {
+                nurls << urls.at(i);
+            }
         }
 
         urls = nurls;
@@ -171,11 +195,77 @@ void PlaylistWorker::run()
         }
     }
 
+    // Items are delivered in batches as they are made, so first items
+    // can be shown (and played) before whole playlist is ready.
+    // First item is sent alone, next batches are cut every batchTime.
     auto pl = PlaylistModel::instance();
+    QElapsedTimer timer;
+    timer.start();
     for (auto &id : ids) {
         auto item = pl->makeItem(id);
-        if (item)
+        if (!item) {
+            failed << id;
+        } else {
             items << item;
+            ++count;
+            if (count == 1 || timer.elapsed() >= batchTime) {
+                emit itemsReady(items);
+                items.clear();
+                timer.restart();
+            }
+        }
+    }
+}
+
+PlaylistValidator::PlaylistValidator(const QStringList &ids, QObject *parent) :
+    QThread(parent),
+    ids(ids)
+{
+}
+
+PlaylistValidator::~PlaylistValidator()
+{
+    cancel();
+    wait();
+}
+
+void PlaylistValidator::cancel()
+{
+    cancelled = 1;
+}
+
+void PlaylistValidator::prioritize(const QString &id)
+{
+    QMutexLocker locker(&mutex);
+    if (ids.removeOne(id))
+        ids.prepend(id);
+}
+
+void PlaylistValidator::run()
+{
+    auto pl = PlaylistModel::instance();
+
+    while (!cancelled) {
+        QString id;
+        {
+            QMutexLocker locker(&mutex);
+            if (ids.isEmpty())
+                break;
+            id = ids.takeFirst();
+        }
+
+        QUrl idUrl(id);
+        auto url = Utils::urlFromId(idUrl);
+
+        PlaylistItem *item = nullptr;
+        if (url.isLocalFile() && !QFileInfo::exists(url.toLocalFile())) {
+            qWarning() << "File" << url.toLocalFile() << "doesn't exist";
+        } else {
+            // meta is fetched again, so URL is checked as well
+            item = pl->makeItem(idUrl);
+        }
+
+        emit itemValidated(id, item);
     }
 }
 
@@ -228,6 +318,10 @@ PlaylistModel::PlaylistModel(QObject *parent) :
             this, &PlaylistModel::onItemsLoaded);
     connect(this, &PlaylistModel::itemsRemoved,
             this, &PlaylistModel::onItemsRemoved);
+    connect(s, &Settings::rememberPlaylistChanged,
+            this, &PlaylistModel::onRememberPlaylistChanged);
+    connect(Utils::instance(), &Utils::networkIfChanged,
+            this, &PlaylistModel::onNetworkIfChanged);
 
     if (s->getRememberPlaylist())
         load();
@@ -420,13 +514,98 @@ void PlaylistModel::onItemsRemoved()
 
 void PlaylistModel::save()
 {
+    PlaylistStore::instance()->write(makeEntries(m_list));
+}
+
+void PlaylistModel::startValidation()
+{
+    if (m_validator)
+        m_validator->cancel();
+    else
+        m_validationChanged = false; // changes of cancelled pass are saved later
+
     QStringList ids;
+    for (int i = 0; i < m_list.size(); ++i) {
+        auto fi = static_cast<PlaylistItem*>(m_list.at(i));
+        if (fi->verified())
+            continue;
+        // active item is checked first
+        if (i == m_activeItemIndex)
+            ids.prepend(fi->id());
+        else
+            ids << fi->id();
+    }
+
+    if (ids.isEmpty())
+        return;
+
+    m_validator = std::unique_ptr<PlaylistValidator>(new PlaylistValidator(ids, this));
+    connect(m_validator.get(), &PlaylistValidator::finished, this, &PlaylistModel::validatorDone);
+    connect(m_validator.get(), &PlaylistValidator::itemValidated, this, &PlaylistModel::onItemValidated);
+    m_validator->start(QThread::LowestPriority);
+}
+
+void PlaylistModel::validateFirst(const QString &id)
+{
+    if (m_validator) {
+        auto fi = static_cast<PlaylistItem*>(find(id));
+        if (fi && !fi->verified())
+            m_validator->prioritize(id);
+    }
+}
+
+void PlaylistModel::onItemValidated(const QString &id, ListItem *item)
+{
+    if (sender() != m_validator.get()) {
+        delete item;
+        return;
+    }
+
+    auto fi = static_cast<PlaylistItem*>(find(id));
+    if (fi) {
+        if (item) {
+            if (fi->update(makeEntry(static_cast<PlaylistItem*>(item))))
+                m_validationChanged = true;
+            fi->setVerified(true);
+            fi->setAvailable(true);
+        } else {
+            // not verified, so it is checked again on next validation
+            qWarning() << "Playlist item is not available:" << id;
+            fi->setAvailable(false);
+        }
+    }
 
+    delete item;
+}
+
+void PlaylistModel::validatorDone()
+{
+    if (sender() != m_validator.get())
+        return;
+
+    qDebug() << "Playlist validation done";
+
+    if (m_validationChanged && Settings::instance()->getRememberPlaylist())
+        save();
+
+    m_validator.release()->deleteLater();
+}
+
+void PlaylistModel::onNetworkIfChanged()
+{
+    // unavailable items might be reachable in a new network
     for (auto item : m_list) {
-        ids << item->id();
+        if (!static_cast<PlaylistItem*>(item)->available()) {
+            startValidation();
+            break;
+        }
     }
+}
 
-    Settings::instance()->setLastPlaylist(ids);
+void PlaylistModel::onRememberPlaylistChanged()
+{
+    if (Settings::instance()->getRememberPlaylist())
+        save();
 }
 
 void PlaylistModel::update(bool play)
@@ -525,9 +704,35 @@ QByteArray PlaylistModel::makePlsData(const QString& name)
 
 void PlaylistModel::load()
 {
-    setBusy(true);
+    auto store = PlaylistStore::instance();
+
+    if (store->exists()) {
+        QList<ListItem*> items;
+        // Items are shown at once with stored metadata,
+        // and checked later in background
+        for (const auto &entry : store->load()) {
+            auto item = makeItem(entry);
+            item->setVerified(false);
+            items << item;
+        }
+
+        if (!items.isEmpty()) {
+            appendRows(items);
+            emit itemsAdded();
+            startValidation();
+        }
+    }
+
+    // Playlist saved by older version as list of ids, items are made
+    // by worker and written to the journal when worker is done. Ids are
+    // removed from settings only after that, ids of items that couldn't
+    // be made (e.g. offline) are kept and tried again on next start.
+    auto s = Settings::instance();
+    auto ids = s->getLastPlaylist();
+    if (ids.isEmpty())
+        return;
 
-    auto ids = Settings::instance()->getLastPlaylist();
+    setBusy(true);
 
     QList<UrlItem> urls;
     for (const auto &id : ids) {
@@ -537,6 +742,7 @@ void PlaylistModel::load()
 
     m_worker = std::unique_ptr<PlaylistWorker>(new PlaylistWorker(std::move(urls), false, true, this));
     connect(m_worker.get(), &PlaylistWorker::finished, this, &PlaylistModel::workerDone);
+    connect(m_worker.get(), &PlaylistWorker::itemsReady, this, &PlaylistModel::workerItemsReady);
     m_worker->start();
 }
 
@@ -650,25 +856,17 @@ void PlaylistModel::addItemPath(const QString& path,
 
 bool PlaylistModel::pathExists(const QString& path)
 {
-    for (auto li : m_list) {
-        auto fi = dynamic_cast<PlaylistItem*>(li);
-        if (fi->path() == path)
-            return true;
-    }
-
-    return false;
+    return findByKey(PlaylistItem::pathKey(path)) != nullptr;
 }
 
 bool PlaylistModel::playPath(const QString& path)
 {
-    for (auto li : m_list) {
-        auto fi = dynamic_cast<PlaylistItem*>(li);
-        if (fi->path() == path) {
-            // path exists, so playing it
-            fi->setPlay(true);
-            autoPlay();
-            return true;
-        }
+    auto fi = static_cast<PlaylistItem*>(findByKey(PlaylistItem::pathKey(path)));
+    if (fi) {
+        // path exists, so playing it
+        fi->setPlay(true);
+        autoPlay();
+        return true;
     }
 
     return false;
@@ -676,25 +874,17 @@ bool PlaylistModel::playPath(const QString& path)
 
 bool PlaylistModel::urlExists(const QUrl& url)
 {
-    for (auto li : m_list) {
-        auto fi = dynamic_cast<PlaylistItem*>(li);
-        if (fi->url() == url || fi->origUrl() == url)
-            return true;
-    }
-
-    return false;
+    return findByKey(PlaylistItem::urlKey(url)) != nullptr;
 }
 
 bool PlaylistModel::playUrl(const QUrl& url)
 {
-    for (auto li : m_list) {
-        auto fi = dynamic_cast<PlaylistItem*>(li);
-        if (fi->url() == url || fi->origUrl() == url) {
-            // url exists, so playing it
-            fi->setPlay(true);
-            autoPlay();
-            return true;
-        }
+    auto fi = static_cast<PlaylistItem*>(findByKey(PlaylistItem::urlKey(url)));
+    if (fi) {
+        // url exists, so playing it
+        fi->setPlay(true);
+        autoPlay();
+        return true;
     }
 
     return false;
@@ -719,6 +909,7 @@ void PlaylistModel::addItems(const QList<UrlItem>& urls, bool asAudio)
 
     m_worker = std::unique_ptr<PlaylistWorker>(new PlaylistWorker(std::move(urls), asAudio, false, this));
     connect(m_worker.get(), &PlaylistWorker::finished, this, &PlaylistModel::workerDone);
+    connect(m_worker.get(), &PlaylistWorker::itemsReady, this, &PlaylistModel::workerItemsReady);
     m_worker->start();
 }
 
@@ -736,35 +927,76 @@ void PlaylistModel::addItems(const QList<QUrl>& urls, bool asAudio)
     addItems(purls, asAudio);
 }
 
+void PlaylistModel::workerItemsReady(const QList<ListItem*> &items)
+{
+    if (!m_worker || sender() != m_worker.get()) {
+        qWarning() << "Items from unknown worker";
+        qDeleteAll(items);
+        return;
+    }
+
+    appendItems(items, !m_worker->urlIsId);
+}
+
+void PlaylistModel::appendItems(const QList<ListItem*> &items, bool loaded)
+{
+    if (items.isEmpty())
+        return;
+
+    appendRows(items);
+
+    // Migrated items are written at once when worker is done
+    bool migrating = m_worker && m_worker->urlIsId;
+
+    if (!migrating && Settings::instance()->getRememberPlaylist()) {
+        auto store = PlaylistStore::instance();
+        store->add(makeEntries(items));
+        if (store->needsCompaction())
+            save();
+    }
+
+    if (loaded)
+        emit itemsLoaded();
+    else
+        emit itemsAdded();
+
+    // auto playing
+    autoPlay();
+}
+
 void PlaylistModel::workerDone()
 {
     qDebug() << "workerDone";
 
     if (m_worker) {
-        if (m_worker->items.length() != m_worker->urls.length()) {
+        if (m_worker->count != m_worker->urls.length()) {
             qWarning() << "Some urls are invalid and cannot be added to the playlist";
             if (m_worker->urls.length() == 1)
                 emit error(E_ItemNotAdded);
-            else if (m_worker->items.length() == 0)
+            else if (m_worker->count == 0)
                 emit error(E_AllItemsNotAdded);
             else
                 emit error(E_SomeItemsNotAdded);
         }
 
-        if (!m_worker->items.isEmpty()) {
-            appendRows(m_worker->items);
-            if (m_worker->urlIsId)
-                emit itemsAdded();
-            else
-                emit itemsLoaded();
-            if (Settings::instance()->getRememberPlaylist())
-                save();
-
-            // auto playing
-            autoPlay();
+        if (m_worker->count > 0) {
+            // remaining items, rest was added in batches
+            appendItems(m_worker->items, !m_worker->urlIsId);
+            m_worker->items.clear();
         } else {
             qWarning() << "No items to add to playlist";
         }
+
+        if (m_worker->urlIsId && Settings::instance()->getRememberPlaylist()) {
+            if (PlaylistStore::instance()->write(makeEntries(m_list))) {
+                QStringList failed;
+                for (const auto &id : m_worker->failed)
+                    failed << id.toString();
+                Settings::instance()->setLastPlaylist(failed);
+            } else {
+                qWarning() << "Old playlist is kept, because journal cannot be written";
+            }
+        }
     } else {
         qWarning() << "Worker done signal but worker is null";
     }
@@ -772,6 +1004,37 @@ void PlaylistModel::workerDone()
     setBusy(false);
 }
 
+#ifndef SAILFISH
+static QIcon makeIcon(const QString &iconUrl, const QUrl &url,
+                      ContentServer::Type type)
+{
+    QIcon icon;
+    if (iconUrl.isEmpty()) {
+        if (Utils::isUrlMic(url)) {
+            icon = QIcon::fromTheme("audio-input-microphone");
+        } else {
+            switch (type) {
+            case ContentServer::TypeMusic:
+                icon = QIcon::fromTheme("audio-x-generic");
+                break;
+            case ContentServer::TypeVideo:
+                icon = QIcon::fromTheme("video-x-generic");
+                break;
+            case ContentServer::TypeImage:
+                icon = QIcon::fromTheme("image-x-generic");
+                break;
+            default:
+                icon = QIcon::fromTheme("unknown");
+                break;
+            }
+        }
+    } else {
+        icon = QIcon(iconUrl);
+    }
+    return icon;
+}
+#endif
+
 PlaylistItem* PlaylistModel::makeItem(const QUrl &id)
 {
     qDebug() << "makeItem:" << id;
@@ -795,8 +1058,7 @@ PlaylistItem* PlaylistModel::makeItem(const QUrl &id)
 
     QUrl url = Utils::urlFromId(id);
 
-    const ContentServer::ItemMeta *meta;
-    meta = ContentServer::instance()->getMeta(url);
+    auto meta = ContentServer::instance()->getMetaRefreshed(url);
     if (!meta) {
         qWarning() << "No meta item found";
         return nullptr;
@@ -813,29 +1075,7 @@ PlaylistItem* PlaylistModel::makeItem(const QUrl &id)
                 type == ContentServer::TypeImage ? meta->url.toString() : meta->albumArt
                                                  : ficon.toString();
 #ifndef SAILFISH
-    QIcon icon;
-    if (iconUrl.isEmpty()) {
-        if (Utils::isUrlMic(url)) {
-            icon = QIcon::fromTheme("audio-input-microphone");
-        } else {
-            switch (type) {
-            case ContentServer::TypeMusic:
-                icon = QIcon::fromTheme("audio-x-generic");
-                break;
-            case ContentServer::TypeVideo:
-                icon = QIcon::fromTheme("video-x-generic");
-                break;
-            case ContentServer::TypeImage:
-                icon = QIcon::fromTheme("image-x-generic");
-                break;
-            default:
-                icon = QIcon::fromTheme("unknown");
-                break;
-            }
-        }
-    } else {
-        icon = QIcon(iconUrl);
-    }
+    QIcon icon = makeIcon(iconUrl, url, type);
 #endif
 
     auto item = new PlaylistItem(meta->url == url ?
@@ -860,10 +1100,69 @@ PlaylistItem* PlaylistModel::makeItem(const QUrl &id)
                                false, // to be active
                                play // play
                                );
+#ifndef SAILFISH
+    item->setIconUrl(QUrl(iconUrl));
+#endif
 
     return item;
 }
 
+PlaylistItem* PlaylistModel::makeItem(const PlaylistStore::Entry &entry)
+{
+    auto type = static_cast<ContentServer::Type>(entry.type);
+
+    auto item = new PlaylistItem(entry.id, // id
+                               entry.name, // name
+                               entry.url, // url
+                               entry.origUrl, // orig url
+                               type, // type
+                               entry.title, // title
+                               entry.artist, // artist
+                               entry.album, // album
+                               "", // date
+                               entry.duration, // duration
+                               entry.size, // size
+#ifdef SAILFISH
+                               entry.icon, // icon
+#else
+                               makeIcon(entry.icon.toString(), entry.origUrl, type), // icon
+#endif
+                               false, // active
+                               false, // to be active
+                               false // play
+                               );
+#ifndef SAILFISH
+    item->setIconUrl(entry.icon);
+#endif
+
+    return item;
+}
+
+PlaylistStore::Entry PlaylistModel::makeEntry(const PlaylistItem *item)
+{
+    PlaylistStore::Entry entry;
+    entry.id = QUrl(item->id());
+    entry.name = item->name();
+    entry.url = item->url();
+    entry.origUrl = item->origUrl();
+    entry.type = static_cast<int>(item->type());
+    entry.title = item->title();
+    entry.artist = item->artist();
+    entry.album = item->album();
+    entry.duration = item->duration();
+    entry.size = item->size();
+    entry.icon = item->iconUrl();
+    return entry;
+}
+
+QList<PlaylistStore::Entry> PlaylistModel::makeEntries(const QList<ListItem*> &items)
+{
+    QList<PlaylistStore::Entry> entries;
+    for (auto item : items)
+        entries << makeEntry(static_cast<PlaylistItem*>(item));
+    return entries;
+}
+
 bool PlaylistModel::addId(const QUrl &id)
 {
     auto item = makeItem(id);
@@ -926,6 +1225,9 @@ void PlaylistModel::setToBeActiveIndex(int index)
         auto fi = dynamic_cast<PlaylistItem*>(m_list.at(i));
         fi->setToBeActive(i == index);
     }
+
+    if (index > -1 && index < len)
+        validateFirst(m_list.at(index)->id());
 }
 
 void PlaylistModel::setToBeActiveId(const QString &id)
@@ -934,6 +1236,8 @@ void PlaylistModel::setToBeActiveId(const QString &id)
         auto fi = dynamic_cast<PlaylistItem*>(li);
         fi->setToBeActive(fi->id() == id);
     }
+
+    validateFirst(id);
 }
 
 void PlaylistModel::setActiveUrl(const QUrl &url)
@@ -956,6 +1260,9 @@ void PlaylistModel::clear()
             active_removed = true;
     }
 
+    if (m_validator)
+        m_validator->cancel();
+
     if(rowCount() > 0) {
         removeRows(0, rowCount());
         emit itemsRemoved();
@@ -964,7 +1271,7 @@ void PlaylistModel::clear()
     setActiveItemIndex(-1);
 
     if (Settings::instance()->getRememberPlaylist())
-        save();
+        PlaylistStore::instance()->clear();
 
     if(active_removed)
         emit activeItemChanged();
@@ -1002,6 +1309,8 @@ void PlaylistModel::setActiveItemIndex(int index)
 {
     if (m_activeItemIndex != index) {
         m_activeItemIndex = index;
+        if (index > -1 && index < m_list.size())
+            validateFirst(m_list.at(index)->id());
         emit activeItemIndexChanged();
     }
 }
@@ -1046,6 +1355,8 @@ bool PlaylistModel::removeIndex(int index)
     if (fi->active())
         active_removed = true;
 
+    const QString id = fi->id();
+
     bool ok = removeRow(index);
 
     if (ok) {
@@ -1056,8 +1367,12 @@ bool PlaylistModel::removeIndex(int index)
                 setActiveItemIndex(m_activeItemIndex - 1);
         }
 
-        if (Settings::instance()->getRememberPlaylist())
-            save();
+        if (Settings::instance()->getRememberPlaylist()) {
+            auto store = PlaylistStore::instance();
+            store->remove(id);
+            if (store->needsCompaction())
+                save();
+        }
 
         emit itemsRemoved();
 
@@ -1164,24 +1479,57 @@ PlaylistItem::PlaylistItem(const QUrl &id,
 #endif
                            bool active,
                            bool toBeActive,
-                           bool play,
-                           QObject *parent) :
-    ListItem(parent),
-    m_id(id),
-    m_name(name),
-    m_url(url),
-    m_origUrl(origUrl),
-    m_type(type),
-    m_title(title),
-    m_artist(artist),
-    m_album(album),
-    m_date(date),
-    m_duration(duration),
-    m_size(size),
-    m_icon(icon),
-    m_active(active),
-    m_play(play)
-{}
+                           bool play)
+{
+    Q_UNUSED(toBeActive)
+    setValue(IdRole, id.toString());
+    setValue(NameRole, name);
+    setValue(UrlRole, url);
+    setValue(OrigUrlRole, origUrl);
+    setValue(TypeRole, type);
+    setValue(TitleRole, title);
+    setValue(ArtistRole, artist);
+    setValue(AlbumRole, album);
+    setValue(DateRole, date);
+    setValue(DurationRole, duration);
+    setValue(SizeRole, size);
+#ifdef SAILFISH
+    setValue(IconRole, icon);
+#else
+    setValue(IconRole, QVariant::fromValue(icon));
+#endif
+    setValue(ActiveRole, active);
+    setValue(PlayRole, play);
+    setValue(VerifiedRole, true);
+    setValue(AvailableRole, true);
+}
+
+QList<RowStore::Column> PlaylistItem::columns() const
+{
+    return QList<RowStore::Column>()
+            << RowStore::Column{IdRole, RowStore::String}
+            << RowStore::Column{NameRole, RowStore::String}
+            << RowStore::Column{UrlRole, RowStore::Url}
+            << RowStore::Column{OrigUrlRole, RowStore::Url}
+            << RowStore::Column{TypeRole, RowStore::Int}
+            << RowStore::Column{TitleRole, RowStore::String}
+            << RowStore::Column{ArtistRole, RowStore::String}
+            << RowStore::Column{AlbumRole, RowStore::String}
+            << RowStore::Column{DateRole, RowStore::String}
+            << RowStore::Column{DurationRole, RowStore::Int}
+            << RowStore::Column{SizeRole, RowStore::Int64}
+#ifdef SAILFISH
+            << RowStore::Column{IconRole, RowStore::Url}
+#else
+            << RowStore::Column{IconRole, RowStore::Variant}
+            << RowStore::Column{IconUrlRole, RowStore::Url}
+#endif
+            << RowStore::Column{ActiveRole, RowStore::Bool}
+            << RowStore::Column{ToBeActiveRole, RowStore::Bool}
+            << RowStore::Column{PlayRole, RowStore::Bool}
+            << RowStore::Column{VerifiedRole, RowStore::Bool}
+            << RowStore::Column{AvailableRole, RowStore::Bool};
+}
 
 QHash<int, QByteArray> PlaylistItem::roleNames() const
 {
@@ -1199,16 +1547,46 @@ QHash<int, QByteArray> PlaylistItem::roleNames() const
     names[IconRole] = "icon";
     names[ActiveRole] = "active";
     names[ToBeActiveRole] = "toBeActive";
+    names[VerifiedRole] = "verified";
+    names[AvailableRole] = "available";
     return names;
 }
 
 QString PlaylistItem::path() const
 {
-    if (m_url.isLocalFile())
-        return m_url.toLocalFile();
+    auto u = url();
+    if (u.isLocalFile())
+        return u.toLocalFile();
     return QString();
 }
 
+QString PlaylistItem::pathKey(const QString &path)
+{
+    return "path:" + path;
+}
+
+QString PlaylistItem::urlKey(const QUrl &url)
+{
+    return "url:" + url.toString(QUrl::FullyEncoded);
+}
+
+QStringList PlaylistItem::keys() const
+{
+    QStringList list;
+
+    auto p = path();
+    if (!p.isEmpty())
+        list << pathKey(p);
+
+    auto u = url();
+    auto ou = origUrl();
+    list << urlKey(u);
+    if (ou != u)
+        list << urlKey(ou);
+
+    return list;
+}
+
 QVariant PlaylistItem::data(int role) const
 {
     switch(role) {
@@ -1238,6 +1616,10 @@ QVariant PlaylistItem::data(int role) const
         return active();
     case ToBeActiveRole:
         return toBeActive();
+    case VerifiedRole:
+        return verified();
+    case AvailableRole:
+        return available();
 #ifdef DESKTOP
     case ForegroundRole:
         return foreground();
@@ -1251,31 +1633,75 @@ void PlaylistItem::setActive(bool value)
 {
     setToBeActive(false);
 
-    if (m_active != value) {
-        m_active = value;
+    if (setValue(ActiveRole, value))
         emit dataChanged();
-    }
 }
 
 void PlaylistItem::setToBeActive(bool value)
 {
-    if (m_tobeactive != value) {
-        m_tobeactive = value;
+    if (setValue(ToBeActiveRole, value))
         emit dataChanged();
-    }
 }
 
 void PlaylistItem::setPlay(bool value)
 {
-    m_play = value;
+    setValue(PlayRole, value);
+}
+
+void PlaylistItem::setVerified(bool value)
+{
+    if (setValue(VerifiedRole, value))
+        emit dataChanged();
+}
+
+void PlaylistItem::setAvailable(bool value)
+{
+    if (setValue(AvailableRole, value))
+        emit dataChanged();
+}
+
+bool PlaylistItem::update(const PlaylistStore::Entry &entry)
+{
+    auto type = static_cast<ContentServer::Type>(entry.type);
+
+    if (name() == entry.name && this->type() == type && title() == entry.title &&
+        artist() == entry.artist && album() == entry.album &&
+        duration() == entry.duration && size() == entry.size &&
+        iconUrl() == entry.icon)
+        return false;
+
+    setValue(NameRole, entry.name);
+    setValue(TypeRole, type);
+    setValue(TitleRole, entry.title);
+    setValue(ArtistRole, entry.artist);
+    setValue(AlbumRole, entry.album);
+    setValue(DurationRole, entry.duration);
+    setValue(SizeRole, entry.size);
+#ifdef SAILFISH
+    setValue(IconRole, entry.icon);
+#else
+    setValue(IconUrlRole, entry.icon);
+    setValue(IconRole, QVariant::fromValue(makeIcon(entry.icon.toString(), origUrl(), type)));
+#endif
+    emit dataChanged();
+
+    return true;
+}
+
+#ifndef SAILFISH
+void PlaylistItem::setIconUrl(const QUrl &url)
+{
+    setValue(IconUrlRole, url);
 }
+#endif
 
 #ifdef DESKTOP
 QBrush PlaylistItem::foreground() const
 {
     auto p = QApplication::palette();
-    return m_tobeactive ? p.brush(QPalette::Inactive, QPalette::Highlight) :
-                          m_active ? p.brush(QPalette::Active, QPalette::Highlight) :
+    return toBeActive() ? p.brush(QPalette::Inactive, QPalette::Highlight) :
+                          active() ? p.brush(QPalette::Active, QPalette::Highlight) :
+                          !verified() ? p.brush(QPalette::Disabled, QPalette::WindowText) :
                           p.brush(QPalette::WindowText);
 }
 #endif
@@ -22,6 +22,8 @@
 #include <QThread>
 #include <QPair>
 #include <QVariantList>
+#include <QMutex>
+#include <QAtomicInt>
 #include <memory>
 
 #ifdef DESKTOP
@@ -31,6 +33,7 @@
 
 #include "contentserver.h"
 #include "listmodel.h"
+#include "playliststore.h"
 
 class PlaylistModel;
 
@@ -46,7 +49,6 @@ struct UrlItem {
 class PlaylistItem :
         public ListItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         NameRole = Qt::DisplayRole,
@@ -62,11 +64,17 @@ public:
         TitleRole,
         ArtistRole,
         AlbumRole,
-        ToBeActiveRole
+        ToBeActiveRole,
+        VerifiedRole,
+        AvailableRole,
+        // stored only, not exposed to views
+        OrigUrlRole,
+        PlayRole,
+        IconUrlRole
     };
 
 public:
-    PlaylistItem(QObject *parent = nullptr): ListItem(parent) {}
+    PlaylistItem() {}
     explicit PlaylistItem(const QUrl &id,
                       const QString &name,
                       const QUrl &url,
@@ -85,58 +93,53 @@ public:
 #endif
                       bool active,
                       bool toBeActive,
-                      bool play, // auto play after adding
-                      QObject *parent = nullptr);
+                      bool play); // auto play after adding
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     QString path() const;
-    inline QString id() const { return m_id.toString(); }
-    //inline QUrl idUrl() const { return m_id; }
-    inline QString name() const { return m_name; }
-    inline QUrl url() const { return m_url; }
-    inline QUrl origUrl() const { return m_origUrl; }
-    inline ContentServer::Type type() const { return m_type; }
-    inline QString title() const { return m_title; }
-    inline QString artist() const { return m_artist; }
-    inline QString album() const { return m_album; }
-    inline QString date() const { return m_date; }
-    inline int duration() const { return m_duration; }
-    inline qint64 size() const { return m_size; }
+    QStringList keys() const;
+    static QString pathKey(const QString &path);
+    static QString urlKey(const QUrl &url);
+    inline QString id() const { return value(IdRole).toString(); }
+    //inline QUrl idUrl() const { return QUrl(id()); }
+    inline QString name() const { return value(NameRole).toString(); }
+    inline QUrl url() const { return value(UrlRole).toUrl(); }
+    inline QUrl origUrl() const { return value(OrigUrlRole).toUrl(); }
+    inline ContentServer::Type type() const {
+        return static_cast<ContentServer::Type>(value(TypeRole).toInt()); }
+    inline QString title() const { return value(TitleRole).toString(); }
+    inline QString artist() const { return value(ArtistRole).toString(); }
+    inline QString album() const { return value(AlbumRole).toString(); }
+    inline QString date() const { return value(DateRole).toString(); }
+    inline int duration() const { return value(DurationRole).toInt(); }
+    inline qint64 size() const { return value(SizeRole).toLongLong(); }
 #ifdef SAILFISH
-    inline QUrl icon() const { return m_icon; }
+    inline QUrl icon() const { return value(IconRole).toUrl(); }
+    inline QUrl iconUrl() const { return value(IconRole).toUrl(); }
 #else
-    inline QIcon icon() const { return m_icon; }
+    inline QIcon icon() const { return value(IconRole).value<QIcon>(); }
+    inline QUrl iconUrl() const { return value(IconUrlRole).toUrl(); }
+    void setIconUrl(const QUrl &url);
 #endif
-    inline bool active() const { return m_active; }
-    inline bool toBeActive() const { return m_tobeactive; }
-    inline bool play() const { return m_play; }
+    inline bool active() const { return value(ActiveRole).toBool(); }
+    inline bool toBeActive() const { return value(ToBeActiveRole).toBool(); }
+    inline bool play() const { return value(PlayRole).toBool(); }
+    inline bool verified() const { return value(VerifiedRole).toBool(); }
+    inline bool available() const { return value(AvailableRole).toBool(); }
     void setActive(bool value);
     void setToBeActive(bool value);
     void setPlay(bool value);
+    void setVerified(bool value);
+    void setAvailable(bool value);
+    // Updates metadata (id and urls are not changed),
+    // returns true when something has changed
+    bool update(const PlaylistStore::Entry &entry);
 #ifdef DESKTOP
     QBrush foreground() const;
 #endif
 
-private:
-    QUrl m_id;
-    QString m_name;
-    QUrl m_url;
-    QUrl m_origUrl;
-    ContentServer::Type m_type;
-    QString m_title;
-    QString m_artist;
-    QString m_album;
-    QString m_date;
-    int m_duration = 0;
-    qint64 m_size = 0;
-#ifdef SAILFISH
-    QUrl m_icon;
-#else
-    QIcon m_icon;
-#endif
-    bool m_active = false;
-    bool m_tobeactive = false;
-    bool m_play = false;
+protected:
+    QList<RowStore::Column> columns() const;
 };
 
 class PlaylistWorker :
@@ -147,15 +150,49 @@ class PlaylistWorker :
 friend class PlaylistModel;
 
 public:
-    QList<ListItem*> items;
+    QList<ListItem*> items; // last batch, not delivered by itemsReady
+    int count = 0; // number of all valid items
+    QList<QUrl> failed; // ids of items that couldn't be made
     PlaylistWorker(const QList<UrlItem> &&urls,
                    bool asAudio = false,
                    bool urlIsId = false,
                    QObject *parent = nullptr);
+
+signals:
+    void itemsReady(const QList<ListItem*> &items);
+
 private:
+    static const int batchTime = 100; // ms
     QList<UrlItem> urls;
     bool asAudio;
     bool urlIsId;
+    bool imageSupported;
+    void run();
+};
+
+// Checks restored items in background: file existence or URL
+// reachability and current metadata. Items are checked in order,
+// but an item can be moved to the front of the queue.
+class PlaylistValidator :
+        public QThread
+{
+    Q_OBJECT
+
+public:
+    PlaylistValidator(const QStringList &ids, QObject *parent = nullptr);
+    ~PlaylistValidator();
+    void prioritize(const QString &id);
+    void cancel();
+
+signals:
+    // 'item' is made from current metadata and must be deleted by
+    // receiver, it is null when item is not available
+    void itemValidated(const QString &id, ListItem *item);
+
+private:
+    QMutex mutex;
+    QStringList ids;
+    QAtomicInt cancelled;
     void run();
 };
 
@@ -170,6 +207,7 @@ class PlaylistModel :
     Q_PROPERTY (bool prevSupported READ isPrevSupported NOTIFY prevSupportedChanged)
 
 friend class PlaylistWorker;
+friend class PlaylistValidator;
 
 public:
     enum ErrorType {
@@ -250,6 +288,7 @@ public slots:
 
 private slots:
     void workerDone();
+    void workerItemsReady(const QList<ListItem*> &items);
     void onItemsAdded();
     void onItemsLoaded();
     void onItemsRemoved();
@@ -259,11 +298,17 @@ private slots:
     void onAvStateChanged();
     void onAvInitedChanged();
     void onSupportedChanged();
+    void onRememberPlaylistChanged();
+    void onItemValidated(const QString &id, ListItem *item);
+    void validatorDone();
+    void onNetworkIfChanged();
 
 private:
     static PlaylistModel* m_instance;
 
     std::unique_ptr<PlaylistWorker> m_worker;
+    std::unique_ptr<PlaylistValidator> m_validator;
+    bool m_validationChanged = false;
     bool m_busy = false;
     int m_activeItemIndex = -1;
     int m_playMode;
@@ -277,12 +322,18 @@ private:
     //bool addId(const QString& id, ContentServer::Type type = ContentServer::TypeUnknown);
     bool addId(const QUrl& id);
     PlaylistItem* makeItem(const QUrl &id);
+    PlaylistItem* makeItem(const PlaylistStore::Entry &entry);
+    static PlaylistStore::Entry makeEntry(const PlaylistItem *item);
+    static QList<PlaylistStore::Entry> makeEntries(const QList<ListItem*> &items);
+    void appendItems(const QList<ListItem*> &items, bool loaded);
     void save();
     QByteArray makePlsData(const QString& name);
     void setBusy(bool busy);
     void updateNextSupported();
     void updatePrevSupported();
     void autoPlay();
+    void startValidation();
+    void validateFirst(const QString &id);
 };
 
 #endif // PLAYLISTMODEL_H
@@ -0,0 +1,254 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QDir>
+#include <QDataStream>
+#include <QHash>
+#include <QVector>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "playliststore.h"
+
+PlaylistStore* PlaylistStore::m_instance = nullptr;
+
+PlaylistStore::PlaylistStore(QObject *parent) :
+    QObject(parent)
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    if (!dir.exists())
+        dir.mkpath(".");
+    m_path = dir.filePath("playlist.journal");
+}
+
+PlaylistStore* PlaylistStore::instance(QObject *parent)
+{
+    if (PlaylistStore::m_instance == nullptr) {
+        PlaylistStore::m_instance = new PlaylistStore(parent);
+    }
+
+    return PlaylistStore::m_instance;
+}
+
+bool PlaylistStore::exists() const
+{
+    return QFile::exists(m_path);
+}
+
+QByteArray PlaylistStore::header()
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << magic << version;
+    return data;
+}
+
+QByteArray PlaylistStore::addRecord(const Entry &entry)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << static_cast<quint8>(OpAdd)
+        << entry.id << entry.name << entry.url << entry.origUrl
+        << static_cast<qint32>(entry.type)
+        << entry.title << entry.artist << entry.album
+        << static_cast<qint32>(entry.duration)
+        << entry.size << entry.icon;
+    return data;
+}
+
+QList<PlaylistStore::Entry> PlaylistStore::load()
+{
+    QList<Entry> entries;
+
+    m_file.close();
+
+    QFile f(m_path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open playlist journal:" << f.errorString();
+        return entries;
+    }
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    bool ok = true;
+    quint32 m = 0, v = 0;
+    in >> m >> v;
+    if (in.status() != QDataStream::Ok || m != magic || v != version) {
+        qWarning() << "Playlist journal has invalid header";
+        ok = false;
+    }
+
+    // Removed entries are only marked, so replay is linear
+    QList<Entry> added;
+    QVector<bool> removed;
+    QHash<QString, QList<int>> positions; // id => indexes of not removed entries
+
+    int records = 0;
+    while (ok && !in.atEnd()) {
+        quint8 op = 0;
+        in >> op;
+        if (op == OpAdd) {
+            Entry e; qint32 type = 0, duration = 0;
+            in >> e.id >> e.name >> e.url >> e.origUrl >> type
+               >> e.title >> e.artist >> e.album >> duration
+               >> e.size >> e.icon;
+            e.type = type;
+            e.duration = duration;
+            if (in.status() == QDataStream::Ok) {
+                positions[e.id.toString()] << added.size();
+                added << e;
+                removed << false;
+            }
+        } else if (op == OpRemove) {
+            QString id;
+            in >> id;
+            if (in.status() == QDataStream::Ok) {
+                auto it = positions.find(id);
+                if (it != positions.end()) {
+                    removed[it.value().takeFirst()] = true;
+                    if (it.value().isEmpty())
+                        positions.erase(it);
+                }
+            }
+        } else if (op == OpClear) {
+            added.clear();
+            removed.clear();
+            positions.clear();
+        } else {
+            ok = false;
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            // most likely last record was not fully written
+            ok = false;
+        }
+
+        if (ok)
+            ++records;
+    }
+
+    f.close();
+
+    for (int i = 0; i < added.size(); ++i) {
+        if (!removed.at(i))
+            entries << added.at(i);
+    }
+
+    m_records = records;
+    m_count = entries.size();
+
+    if (!ok) {
+        qWarning() << "Playlist journal is damaged, so rewriting it";
+        write(entries);
+    } else if (needsCompaction()) {
+        write(entries);
+    }
+
+    qDebug() << "Playlist loaded from journal:" << entries.size()
+             << "items," << m_records << "records";
+
+    return entries;
+}
+
+bool PlaylistStore::openForAppend()
+{
+    if (m_file.isOpen())
+        return true;
+
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot open playlist journal:" << m_file.errorString();
+        return false;
+    }
+
+    if (m_file.size() == 0) {
+        m_file.write(header());
+        m_records = 0;
+        m_count = 0;
+    }
+
+    return true;
+}
+
+void PlaylistStore::append(const QByteArray &record)
+{
+    if (!openForAppend())
+        return;
+
+    if (m_file.write(record) != record.size())
+        qWarning() << "Cannot write to playlist journal:" << m_file.errorString();
+    m_file.flush();
+}
+
+void PlaylistStore::add(const QList<Entry> &entries)
+{
+    if (entries.isEmpty())
+        return;
+
+    QByteArray data;
+    for (const auto &entry : entries)
+        data.append(addRecord(entry));
+
+    append(data);
+
+    m_records += entries.size();
+    m_count += entries.size();
+}
+
+void PlaylistStore::remove(const QString &id)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << static_cast<quint8>(OpRemove) << id;
+
+    append(data);
+
+    m_records++;
+    if (m_count > 0)
+        m_count--;
+}
+
+void PlaylistStore::clear()
+{
+    // empty journal is smaller than clear record
+    write(QList<Entry>());
+}
+
+bool PlaylistStore::write(const QList<Entry> &entries)
+{
+    m_file.close();
+
+    QSaveFile f(m_path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot open playlist journal:" << f.errorString();
+        return false;
+    }
+
+    f.write(header());
+    for (const auto &entry : entries)
+        f.write(addRecord(entry));
+
+    if (!f.commit()) {
+        qWarning() << "Cannot write playlist journal:" << f.errorString();
+        return false;
+    }
+
+    m_records = entries.size();
+    m_count = entries.size();
+
+    return true;
+}
+
+bool PlaylistStore::needsCompaction() const
+{
+    return m_records > minCompactRecords && m_records > 2 * m_count;
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef PLAYLISTSTORE_H
+#define PLAYLISTSTORE_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QList>
+#include <QFile>
+#include <QByteArray>
+
+// Persistent storage of the current playlist. Every change is appended
+// to a binary journal file, so saving costs as much as the change
+// itself. Journal is rewritten from the playlist (compacted) when
+// it contains too many outdated records. Entries keep resolved
+// metadata, so playlist can be restored without probing the items.
+
+class PlaylistStore :
+        public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QUrl id;
+        QString name;
+        QUrl url;
+        QUrl origUrl;
+        int type = 0;
+        QString title;
+        QString artist;
+        QString album;
+        int duration = 0;
+        qint64 size = 0;
+        QUrl icon;
+    };
+
+    static PlaylistStore* instance(QObject *parent = nullptr);
+
+    bool exists() const;
+    QList<Entry> load();
+    void add(const QList<Entry> &entries);
+    void remove(const QString &id);
+    void clear();
+    // Replaces journal with one snapshot of the whole playlist
+    bool write(const QList<Entry> &entries);
+    bool needsCompaction() const;
+
+private:
+    enum Op {
+        OpAdd = 1,
+        OpRemove,
+        OpClear
+    };
+
+    static PlaylistStore* m_instance;
+    static const quint32 magic = 0x4a504c4a; // "JPLJ"
+    static const quint32 version = 1;
+    static const int minCompactRecords = 200;
+
+    QString m_path;
+    QFile m_file;
+    int m_records = 0; // records in journal
+    int m_count = 0; // entries in playlist
+
+    explicit PlaylistStore(QObject *parent = nullptr);
+    bool openForAppend();
+    void append(const QByteArray &record);
+    static QByteArray header();
+    static QByteArray addRecord(const Entry &entry);
+};
+
+#endif // PLAYLISTSTORE_H
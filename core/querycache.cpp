@@ -0,0 +1,197 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QDBusConnection>
+
+#include "querycache.h"
+#ifdef DESKTOP
+#include "library.h"
+#endif
+
+QueryCache* QueryCache::m_instance = nullptr;
+
+QueryCache::QueryCache(QObject *parent) :
+    QObject(parent)
+{
+#ifdef DESKTOP
+    // Direct connection, so cache is cleared before models
+    // receive change signal and query again
+    connect(Library::instance(), &Library::changed,
+            this, &QueryCache::clear, Qt::DirectConnection);
+#else
+    bool ok = QDBusConnection::sessionBus().connect(
+                "org.freedesktop.Tracker1",
+                "/org/freedesktop/Tracker1/Resources",
+                "org.freedesktop.Tracker1.Resources",
+                "GraphUpdated",
+                this, SLOT(graphUpdatedHandler(QString)));
+    if (!ok)
+        qWarning() << "Cannot connect to Tracker GraphUpdated signal";
+#endif
+}
+
+QueryCache* QueryCache::instance(QObject *parent)
+{
+    if (QueryCache::m_instance == nullptr) {
+        QueryCache::m_instance = new QueryCache(parent);
+    }
+
+    return QueryCache::m_instance;
+}
+
+void QueryCache::graphUpdatedHandler(const QString &className)
+{
+    qDebug() << "Tracker graph updated:" << className;
+    clear();
+}
+
+void QueryCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_entries.isEmpty())
+        qDebug() << "Clearing query cache";
+
+    m_entries.clear();
+    m_lru.clear();
+    m_generation++;
+}
+
+int QueryCache::generation()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+QString QueryCache::makeKey(const QString &type, const QString &query)
+{
+    return type + "\n" + query;
+}
+
+bool QueryCache::isPlainText(const QString &filter)
+{
+    // Filter is used as regex in Tracker queries, so only
+    // plain text can be matched locally
+    static const QString special("\\.^$|?*+()[]{}");
+    for (const auto &c : filter) {
+        if (special.contains(c))
+            return false;
+    }
+
+    return true;
+}
+
+bool QueryCache::matches(const QVariantList &row, const QList<int> &columns,
+                         const QString &filter)
+{
+    for (int column : columns) {
+        if (column < row.size() &&
+                row.at(column).toString().contains(filter, Qt::CaseInsensitive))
+            return true;
+    }
+
+    return false;
+}
+
+void QueryCache::touch(const QString &key, const QString &filter)
+{
+    auto item = qMakePair(key, filter);
+    m_lru.removeOne(item);
+    m_lru.append(item);
+}
+
+void QueryCache::insertEntry(const QString &key, const QString &filter,
+                             const Entry &entry)
+{
+    m_entries[key].insert(filter, entry);
+    touch(key, filter);
+
+    while (m_lru.size() > maxEntries) {
+        auto item = m_lru.takeFirst();
+        auto it = m_entries.find(item.first);
+        if (it != m_entries.end()) {
+            it->remove(item.second);
+            if (it->isEmpty())
+                m_entries.erase(it);
+        }
+    }
+}
+
+bool QueryCache::find(const QString &type, const QString &query,
+                      const QString &filter, Rows &rows)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const auto key = makeKey(type, query);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return false;
+
+    auto eit = it->find(filter);
+    if (eit != it->end()) {
+        rows = eit->rows;
+        touch(key, filter);
+        return true;
+    }
+
+    if (!isPlainText(filter))
+        return false;
+
+    // The longest shorter filter gives the smallest superset
+    const Entry *superset = nullptr;
+    QString supersetFilter;
+    for (auto sit = it->cbegin(); sit != it->cend(); ++sit) {
+        const auto &entry = sit.value();
+        if (entry.complete && !entry.filterColumns.isEmpty() &&
+                (superset == nullptr || sit.key().size() > supersetFilter.size()) &&
+                filter.contains(sit.key(), Qt::CaseInsensitive)) {
+            superset = &entry;
+            supersetFilter = sit.key();
+        }
+    }
+
+    if (!superset)
+        return false;
+
+    Entry entry;
+    entry.complete = true;
+    entry.filterColumns = superset->filterColumns;
+    for (const auto &row : superset->rows) {
+        if (matches(row, entry.filterColumns, filter))
+            entry.rows << row;
+    }
+
+    qDebug() << "Query result made from cached result for filter:"
+             << supersetFilter;
+
+    rows = entry.rows;
+    insertEntry(key, filter, entry); // superset pointer is invalid now
+
+    return true;
+}
+
+void QueryCache::insert(const QString &type, const QString &query,
+                        const QString &filter, int generation,
+                        const Rows &rows, bool complete,
+                        const QList<int> &filterColumns)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (generation != m_generation) {
+        qDebug() << "Media database has changed during query";
+        return;
+    }
+
+    Entry entry;
+    entry.rows = rows;
+    entry.complete = complete;
+    entry.filterColumns = filterColumns;
+
+    insertEntry(makeKey(type, query), filter, entry);
+}
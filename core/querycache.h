@@ -0,0 +1,80 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QVariantList>
+#include <QMutex>
+
+// Cache for media query results. Entries are keyed by model type and
+// query text without filter part. Result for a filter can be also made
+// from not truncated result for a shorter filter which is its substring.
+// Cache is cleared when media database changes.
+
+class QueryCache :
+        public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef QVector<QVariantList> Rows;
+
+    static QueryCache* instance(QObject *parent = nullptr);
+
+    // Generation is increased when cache is cleared, result of a query
+    // started before that is not inserted
+    int generation();
+    bool find(const QString &type, const QString &query,
+              const QString &filter, Rows &rows);
+    // 'complete' is false when result was truncated by query limit,
+    // 'filterColumns' are columns matched by filter (case insensitive
+    // substring), empty list means that result can be reused only for
+    // the same filter
+    void insert(const QString &type, const QString &query,
+                const QString &filter, int generation,
+                const Rows &rows, bool complete,
+                const QList<int> &filterColumns = QList<int>());
+
+public slots:
+    void clear();
+
+private slots:
+    void graphUpdatedHandler(const QString &className);
+
+private:
+    struct Entry {
+        Rows rows;
+        bool complete = false;
+        QList<int> filterColumns;
+    };
+
+    static QueryCache* m_instance;
+    static const int maxEntries = 64;
+
+    QMutex m_mutex;
+    int m_generation = 0;
+    QHash<QString, QHash<QString, Entry>> m_entries; // key => filter => entry
+    QList<QPair<QString, QString>> m_lru; // key and filter, oldest first
+
+    explicit QueryCache(QObject *parent = nullptr);
+    static QString makeKey(const QString &type, const QString &query);
+    static bool isPlainText(const QString &filter);
+    static bool matches(const QVariantList &row, const QList<int> &columns,
+                        const QString &filter);
+    void touch(const QString &key, const QString &filter);
+    void insertEntry(const QString &key, const QString &filter,
+                     const Entry &entry);
+};
+
+#endif // QUERYCACHE_H
@@ -134,9 +134,7 @@ RecItem::RecItem(const QString &id,
                  const QString &path,
                  const QString &title,
                  const QString &author,
-                 const QDateTime &date,
-                 QObject *parent) :
-    SelectableItem(parent),
+                 const QDateTime &date) :
     m_id(id),
     m_path(path),
     m_title(title),
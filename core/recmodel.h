@@ -7,7 +7,6 @@
 
 class RecItem: public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         TitleRole = Qt::DisplayRole,
@@ -18,13 +17,12 @@ public:
         DateRole
     };
 
-    RecItem(QObject* parent = nullptr) : SelectableItem(parent) {}
+    RecItem() {}
     explicit RecItem(const QString &id,
                      const QString &path,
                      const QString &title,
                      const QString &author,
-                     const QDateTime &date,
-                     QObject *parent = nullptr);
+                     const QDateTime &date);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
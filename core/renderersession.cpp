@@ -0,0 +1,202 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QDebug>
+#include <QUrlQuery>
+
+#include "renderersession.h"
+#include "contentserver.h"
+#include "utils.h"
+
+RendererSession::RendererSession(const QString &deviceId, QObject *parent) :
+    QObject(parent),
+    TaskExecutor(parent, 1),
+    renderingControl(new RenderingControl()),
+    avTransport(new AVTransport()),
+    m_deviceId(deviceId)
+{
+    connect(avTransport.get(), &AVTransport::trackEnded,
+            this, &RendererSession::handleTrackEnded);
+    connect(avTransport.get(), &AVTransport::currentURIChanged,
+            this, &RendererSession::handleCurrentURIChanged);
+    connect(avTransport.get(), &Service::error,
+            this, &RendererSession::handleError);
+    connect(this, &RendererSession::metaResolved,
+            this, &RendererSession::handleMetaResolved, Qt::QueuedConnection);
+}
+
+RendererSession::~RendererSession()
+{
+    // Tasks must not outlive service objects
+    waitForDone();
+    avTransport->deInit();
+    renderingControl->deInit();
+    avTransport->waitForDone();
+    renderingControl->waitForDone();
+}
+
+bool RendererSession::init()
+{
+    qDebug() << "Initing session for:" << m_deviceId;
+
+    return avTransport->init(m_deviceId) &&
+           renderingControl->init(m_deviceId);
+}
+
+QString RendererSession::deviceId() const
+{
+    return m_deviceId;
+}
+
+bool RendererSession::addUrl(const QUrl &url, const QString &name)
+{
+    if (!Utils::isUrlValid(url)) {
+        qWarning() << "Invalid url:" << url;
+        return false;
+    }
+
+    QUrl id(url);
+    QUrlQuery q(url);
+    if (q.hasQueryItem(Utils::cookieKey))
+        q.removeQueryItem(Utils::cookieKey);
+    q.addQueryItem(Utils::cookieKey, Utils::randString());
+    if (!name.isEmpty()) {
+        if (q.hasQueryItem(Utils::nameKey))
+            q.removeQueryItem(Utils::nameKey);
+        q.addQueryItem(Utils::nameKey, name);
+    }
+    id.setQuery(q);
+
+    // Probing of remote URL or local file can take long, so it is
+    // not done in the calling (main) thread
+    auto sid = id.toString();
+    int generation = m_generation;
+    return startTask([this, url, sid, generation]() {
+        if (!ContentServer::instance()->getMetaRefreshed(url)) {
+            qWarning() << "No meta item found for:" << url;
+            return;
+        }
+        emit metaResolved(sid, generation);
+    });
+}
+
+void RendererSession::handleMetaResolved(const QString &id, int generation)
+{
+    if (generation != m_generation) {
+        qDebug() << "Session was cleared, item dropped:" << id;
+        return;
+    }
+
+    m_ids << id;
+
+    if (m_playWhenReady) {
+        m_playWhenReady = false;
+        playIndex(m_ids.size() - 1);
+        return;
+    }
+
+    // Next item is known now, so renderer can continue without gap
+    if (m_current == m_ids.size() - 2 &&
+            avTransport->getNextURISupported() &&
+            avTransport->getTransportState() == AVTransport::Playing)
+        avTransport->setLocalContent("", m_ids.last());
+}
+
+void RendererSession::clear()
+{
+    m_ids.clear();
+    m_current = -1;
+    m_generation++;
+    m_playWhenReady = false;
+}
+
+int RendererSession::count() const
+{
+    return m_ids.size();
+}
+
+int RendererSession::currentIndex() const
+{
+    return m_current;
+}
+
+void RendererSession::playIndex(int idx)
+{
+    if (idx < 0 || idx >= m_ids.size()) {
+        qWarning() << "Invalid session item index:" << idx;
+        return;
+    }
+
+    m_current = idx;
+    auto nid = idx + 1 < m_ids.size() ? m_ids.at(idx + 1) : QString();
+    avTransport->setLocalContent(m_ids.at(idx), nid);
+}
+
+void RendererSession::play()
+{
+    if (avTransport->getTransportState() == AVTransport::PausedPlayback)
+        avTransport->play();
+    else if (m_ids.isEmpty() && taskActive())
+        m_playWhenReady = true; // first item is still being resolved
+    else
+        playIndex(m_current < 0 ? 0 : m_current);
+}
+
+void RendererSession::pause()
+{
+    avTransport->pause();
+}
+
+void RendererSession::stop()
+{
+    avTransport->stop();
+}
+
+void RendererSession::next()
+{
+    playIndex(m_current + 1);
+}
+
+void RendererSession::prev()
+{
+    playIndex(m_current > 0 ? m_current - 1 : 0);
+}
+
+void RendererSession::setVolume(int value)
+{
+    renderingControl->setVolume(value);
+}
+
+void RendererSession::handleTrackEnded()
+{
+    // With next URI renderer switches to next item by itself
+    if (!avTransport->getNextURISupported() && m_current + 1 < m_ids.size())
+        playIndex(m_current + 1);
+}
+
+void RendererSession::handleCurrentURIChanged()
+{
+    // Renderer could switch to next URI by itself
+    auto id = ContentServer::instance()->idFromUrl(avTransport->getCurrentURI());
+    int idx = m_ids.indexOf(id);
+    if (idx < 0 || idx == m_current)
+        return;
+
+    qDebug() << "Session" << m_deviceId << "moved to item:" << idx;
+    m_current = idx;
+
+    if (idx + 1 < m_ids.size() && avTransport->getNextURISupported())
+        avTransport->setLocalContent("", m_ids.at(idx + 1));
+}
+
+void RendererSession::handleError(Service::ErrorType code)
+{
+    if (code == Service::E_LostConnection) {
+        qWarning() << "Session" << m_deviceId << "lost connection";
+        emit closed();
+    }
+}
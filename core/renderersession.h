@@ -0,0 +1,75 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef RENDERERSESSION_H
+#define RENDERERSESSION_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+#include <memory>
+
+#include "renderingcontrol.h"
+#include "avtransport.h"
+#include "taskexecutor.h"
+
+// Playback on additional renderer, next to the one controlled by UI.
+// Session has its own AVTransport and RenderingControl (each with own
+// task queue) and simple playlist cursor. Content is served by shared
+// ContentServer. Meta data of added items is resolved in session's own
+// task queue, so items are appended in order of adding.
+
+class RendererSession :
+        public QObject,
+        public TaskExecutor
+{
+    Q_OBJECT
+
+public:
+    explicit RendererSession(const QString &deviceId, QObject *parent = nullptr);
+    ~RendererSession();
+
+    std::shared_ptr<RenderingControl> renderingControl;
+    std::shared_ptr<AVTransport> avTransport;
+
+    bool init();
+    QString deviceId() const;
+    // Returns immediately, item is appended when its meta data is ready
+    bool addUrl(const QUrl &url, const QString &name);
+    void clear();
+    int count() const;
+    int currentIndex() const;
+    void play();
+    void pause();
+    void stop();
+    void next();
+    void prev();
+    void setVolume(int value);
+
+signals:
+    void closed();
+    void metaResolved(const QString &id, int generation);
+
+private slots:
+    void handleTrackEnded();
+    void handleCurrentURIChanged();
+    void handleError(Service::ErrorType code);
+    void handleMetaResolved(const QString &id, int generation);
+
+private:
+    QString m_deviceId;
+    QStringList m_ids;
+    int m_current = -1;
+    int m_generation = 0; // incremented on clear, drops pending items
+    bool m_playWhenReady = false;
+
+    void playIndex(int idx);
+};
+
+#endif // RENDERERSESSION_H
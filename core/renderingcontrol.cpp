@@ -75,9 +75,7 @@ void RenderingControl::reset()
 
 void RenderingControl::update()
 {
-    auto app = static_cast<QGuiApplication*>(QGuiApplication::instance());
-
-    if (app->applicationState() == Qt::ApplicationActive) {
+    if (isUiVisible()) {
         updateVolume();
         updateMute();
     }
@@ -90,7 +88,12 @@ void RenderingControl::asyncUpdate()
         return;
     }
 
-    startTask([this](){
+    if (getEventsActive()) {
+        qDebug() << "Volume and mute are evented, update not needed";
+        return;
+    }
+
+    startTask("update", TP_Background, [this](){
         update();
     });
 }
@@ -131,7 +134,7 @@ void RenderingControl::volumeTimeout()
     }
 
     if (m_volume != m_futureVolume) {
-        startTask([this](){
+        startTask("volume", TP_User, [this](){
             auto srv = s();
 
             if (!getInited() || !srv) {
@@ -161,7 +164,7 @@ bool RenderingControl::getMute()
 void RenderingControl::setMute(bool value)
 {
     if (m_mute != value) {
-        startTask([this, value](){
+        startTask("mute", TP_User, [this, value](){
             auto srv = s();
 
             if (!getInited() || !srv) {
@@ -179,8 +182,8 @@ void RenderingControl::setMute(bool value)
 
 void RenderingControl::handleApplicationStateChanged(Qt::ApplicationState state)
 {
-    Q_UNUSED(state)
-    update();
+    if (isUiVisible(state))
+        asyncUpdate();
 }
 
 void RenderingControl::asyncUpdateVolume()
@@ -190,7 +193,7 @@ void RenderingControl::asyncUpdateVolume()
         return;
     }
 
-    startTask([this](){
+    startTask("volumeInfo", TP_Background, [this](){
         updateVolume();
     });
 }
@@ -224,7 +227,7 @@ void RenderingControl::asyncUpdateMute()
         return;
     }
 
-    startTask([this](){
+    startTask("muteInfo", TP_Background, [this](){
         updateMute();
     });
 }
@@ -257,7 +260,8 @@ void RenderingControl::showVolNofification() const
 void RenderingControl::volumeUpTimeout()
 {
     if (m_volUpMutex.tryLock()) {
-        startTask([this](){
+        // Separate key, volUp mutex must be always unlocked by this task
+        startTask("volumeUp", TP_User, [this](){
             auto srv = s();
 
             if (!getInited() || !srv) {
@@ -0,0 +1,269 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "rowstore.h"
+
+template<typename T>
+RowStore::Pool<T>::Pool()
+{
+    clear();
+}
+
+template<typename T>
+quint32 RowStore::Pool<T>::acquire(const T &value)
+{
+    if (value.isEmpty())
+        return 0;
+
+    auto it = m_ids.constFind(value);
+    if (it != m_ids.constEnd()) {
+        m_refs[it.value()]++;
+        return it.value();
+    }
+
+    quint32 id;
+    if (m_free.isEmpty()) {
+        id = static_cast<quint32>(m_values.size());
+        m_values.append(value);
+        m_refs.append(1);
+    } else {
+        id = m_free.takeLast();
+        m_values[id] = value;
+        m_refs[id] = 1;
+    }
+
+    m_ids.insert(value, id);
+
+    return id;
+}
+
+template<typename T>
+void RowStore::Pool<T>::release(quint32 id)
+{
+    if (id == 0)
+        return;
+
+    if (--m_refs[id] == 0) {
+        m_ids.remove(m_values.at(id));
+        m_values[id] = T();
+        m_free.append(id);
+    }
+}
+
+template<typename T>
+void RowStore::Pool<T>::clear()
+{
+    m_values.clear();
+    m_refs.clear();
+    m_ids.clear();
+    m_free.clear();
+
+    // empty value
+    m_values.append(T());
+    m_refs.append(0);
+}
+
+static QVariant convert(RowStore::Type type, const QVariant &value)
+{
+    switch (type) {
+    case RowStore::String:
+        return value.toString();
+    case RowStore::Url:
+        return value.toUrl();
+    case RowStore::Int:
+        return value.toInt();
+    case RowStore::Int64:
+        return value.toLongLong();
+    case RowStore::Bool:
+        return value.toBool();
+    default:
+        return value;
+    }
+}
+
+RowStore::RowStore(const QList<Column> &columns)
+{
+    for (const auto &def : columns) {
+        m_roleColumns.insert(def.role, m_columns.size());
+        ColumnData column;
+        column.def = def;
+        m_columns.append(column);
+    }
+}
+
+int RowStore::add(const Values &values)
+{
+    int slot;
+
+    if (m_freeSlots.isEmpty()) {
+        slot = m_slotCount++;
+        for (auto &column : m_columns) {
+            switch (column.def.type) {
+            case Int64:
+                column.wideCells.append(0);
+                break;
+            case Variant:
+                column.variantCells.append(QVariant());
+                break;
+            default:
+                column.cells.append(0);
+            }
+        }
+    } else {
+        slot = m_freeSlots.takeLast();
+    }
+
+    for (const auto &value : values) {
+        auto it = m_roleColumns.constFind(value.first);
+        if (it != m_roleColumns.constEnd())
+            setCell(m_columns[it.value()], slot, value.second);
+    }
+
+    return slot;
+}
+
+RowStore::Values RowStore::take(int slot)
+{
+    Values values;
+    values.reserve(m_columns.size());
+
+    for (const auto &column : m_columns)
+        values.append(qMakePair(column.def.role, cell(column, slot)));
+
+    remove(slot);
+
+    return values;
+}
+
+void RowStore::remove(int slot)
+{
+    for (auto &column : m_columns)
+        releaseCell(column, slot);
+
+    m_freeSlots.append(slot);
+}
+
+void RowStore::clear()
+{
+    for (auto &column : m_columns) {
+        column.cells.clear();
+        column.wideCells.clear();
+        column.variantCells.clear();
+    }
+
+    m_strings.clear();
+    m_urls.clear();
+    m_freeSlots.clear();
+    m_slotCount = 0;
+}
+
+bool RowStore::contains(int role) const
+{
+    return m_roleColumns.contains(role);
+}
+
+QVariant RowStore::value(int slot, int role) const
+{
+    auto it = m_roleColumns.constFind(role);
+    if (it == m_roleColumns.constEnd())
+        return QVariant();
+
+    return cell(m_columns.at(it.value()), slot);
+}
+
+bool RowStore::setValue(int slot, int role, const QVariant &value)
+{
+    auto it = m_roleColumns.constFind(role);
+    if (it == m_roleColumns.constEnd())
+        return false;
+
+    auto &column = m_columns[it.value()];
+
+    // Variant values can't be always compared, so they are just replaced
+    if (column.def.type != Variant &&
+            cell(column, slot) == convert(column.def.type, value))
+        return false;
+
+    setCell(column, slot, value);
+
+    return true;
+}
+
+void RowStore::setCell(ColumnData &column, int slot, const QVariant &value)
+{
+    switch (column.def.type) {
+    case String: {
+        // New value is acquired first, so the same value is not dropped
+        auto id = m_strings.acquire(value.toString());
+        m_strings.release(column.cells.at(slot));
+        column.cells[slot] = id;
+        break;
+    }
+    case Url: {
+        auto id = m_urls.acquire(value.toUrl());
+        m_urls.release(column.cells.at(slot));
+        column.cells[slot] = id;
+        break;
+    }
+    case Int:
+        column.cells[slot] = static_cast<quint32>(value.toInt());
+        break;
+    case Bool:
+        column.cells[slot] = value.toBool() ? 1 : 0;
+        break;
+    case Int64:
+        column.wideCells[slot] = value.toLongLong();
+        break;
+    case Variant:
+        column.variantCells[slot] = value;
+        break;
+    }
+}
+
+void RowStore::releaseCell(ColumnData &column, int slot)
+{
+    switch (column.def.type) {
+    case String:
+        m_strings.release(column.cells.at(slot));
+        column.cells[slot] = 0;
+        break;
+    case Url:
+        m_urls.release(column.cells.at(slot));
+        column.cells[slot] = 0;
+        break;
+    case Int:
+    case Bool:
+        column.cells[slot] = 0;
+        break;
+    case Int64:
+        column.wideCells[slot] = 0;
+        break;
+    case Variant:
+        column.variantCells[slot] = QVariant();
+        break;
+    }
+}
+
+QVariant RowStore::cell(const ColumnData &column, int slot) const
+{
+    switch (column.def.type) {
+    case String:
+        return m_strings.at(column.cells.at(slot));
+    case Url:
+        return m_urls.at(column.cells.at(slot));
+    case Int:
+        return static_cast<int>(static_cast<qint32>(column.cells.at(slot)));
+    case Bool:
+        return column.cells.at(slot) != 0;
+    case Int64:
+        return column.wideCells.at(slot);
+    case Variant:
+        return column.variantCells.at(slot);
+    }
+
+    return QVariant();
+}
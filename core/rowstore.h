@@ -0,0 +1,91 @@
+/* Copyright (C) 2019 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ROWSTORE_H
+#define ROWSTORE_H
+
+#include <QString>
+#include <QUrl>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QVariant>
+
+// Column oriented storage of list model rows. Value of each role is
+// kept in a flat array indexed by row slot. Strings and URLs are kept
+// once in a pool and cells contain only their numbers, so values
+// repeated across rows (artist, album, icon) cost 4 bytes per row.
+// Slots of removed rows are reused.
+
+class RowStore
+{
+public:
+    enum Type {
+        String,
+        Url,
+        Int,
+        Int64,
+        Bool,
+        Variant // not pooled, for values without hash (e.g. QIcon)
+    };
+
+    struct Column {
+        int role;
+        Type type;
+    };
+
+    typedef QVector<QPair<int, QVariant>> Values; // role => value
+
+    explicit RowStore(const QList<Column> &columns);
+    int add(const Values &values);
+    // Returns values of the row and frees the slot
+    Values take(int slot);
+    void remove(int slot);
+    void clear();
+    QVariant value(int slot, int role) const;
+    // Returns true when value has changed
+    bool setValue(int slot, int role, const QVariant &value);
+    bool contains(int role) const;
+
+private:
+    // Values with reference counts, number 0 is empty value
+    template<typename T>
+    class Pool {
+    public:
+        Pool();
+        quint32 acquire(const T &value);
+        void release(quint32 id);
+        inline const T& at(quint32 id) const { return m_values.at(id); }
+        void clear();
+    private:
+        QVector<T> m_values;
+        QVector<quint32> m_refs;
+        QHash<T, quint32> m_ids;
+        QVector<quint32> m_free;
+    };
+
+    struct ColumnData {
+        Column def;
+        QVector<quint32> cells; // String, Url, Int and Bool
+        QVector<qint64> wideCells; // Int64
+        QVector<QVariant> variantCells; // Variant
+    };
+
+    QVector<ColumnData> m_columns;
+    QHash<int, int> m_roleColumns; // role => column
+    Pool<QString> m_strings;
+    Pool<QUrl> m_urls;
+    QVector<int> m_freeSlots;
+    int m_slotCount = 0;
+
+    void setCell(ColumnData &column, int slot, const QVariant &value);
+    void releaseCell(ColumnData &column, int slot);
+    QVariant cell(const ColumnData &column, int slot) const;
+};
+
+#endif // ROWSTORE_H
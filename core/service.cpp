@@ -6,6 +6,8 @@
  */
 
 #include <QDebug>
+#include <QUrl>
+#include <QDateTime>
 #include <QThreadPool>
 #include <QGuiApplication>
 
@@ -13,20 +15,25 @@
 #include "directory.h"
 #include "devicemodel.h"
 #include "taskexecutor.h"
+#include "actionstats.h"
 
 Service::Service(QObject *parent) :
     QObject(parent),
     TaskExecutor(parent, 5),
-    m_timer(parent)
+    m_timer(parent),
+    m_resubscribeTimer(parent)
 {
     QObject::connect(&m_timer, &QTimer::timeout, this, &Service::timerEvent);
     QObject::connect(this, &Service::needTimer, this, &Service::timer);
 
-#ifdef SAILFISH
+    m_resubscribeTimer.setInterval(5000);
+    m_resubscribeTimer.setSingleShot(true);
+    QObject::connect(&m_resubscribeTimer, &QTimer::timeout, this, &Service::resubscribe);
+    QObject::connect(this, &Service::subscriptionLost, this, &Service::handleSubscriptionLost);
+
     auto app = static_cast<QGuiApplication*>(QGuiApplication::instance());
     QObject::connect(app, &QGuiApplication::applicationStateChanged,
-                     this, &Service::handleApplicationStateChanged);
-#endif
+                     this, &Service::applicationStateChanged);
 }
 
 Service::~Service()
@@ -46,15 +53,54 @@ Service::~Service()
 void Service::changed(const char *nm, const char *value)
 {
     qDebug() << "changed char*:" << nm << value;
+    handleEvent();
     changed(QString(nm), QVariant::fromValue(QString(value)));
 }
 
 void Service::changed(const char *nm, int value)
 {
     qDebug() << "changed int:" << nm << value;
+    handleEvent();
     changed(QString(nm), QVariant::fromValue(value));
 }
 
+void Service::changed(const char *nm, UPnPClient::UPnPDirObject meta)
+{
+    qDebug() << "changed meta:" << nm << QString::fromStdString(meta.m_id);
+    handleEvent();
+    metaChanged(QString(nm), meta);
+}
+
+void Service::handleEvent()
+{
+    if (!m_eventsActive && QDateTime::currentMSecsSinceEpoch() -
+            m_subscribeTime > initialEventTime) {
+        qDebug() << "Events are active";
+        m_eventsActive = true;
+    }
+}
+
+void Service::autorenew_failed()
+{
+    // Called from libupnp thread, resubscribing is done from main thread
+    qWarning() << "Event subscription lost";
+    m_eventsActive = false;
+    emit subscriptionLost();
+}
+
+void Service::action_done(const char *nm, int ms, int ret)
+{
+    // Called from task thread, so m_deviceId can't be used here
+    QString deviceId;
+    {
+        QMutexLocker locker(&m_reporterMutex);
+        deviceId = m_reporterDeviceId;
+    }
+
+    if (!deviceId.isEmpty())
+        ActionStats::instance()->record(deviceId, QString(nm), ms, ret);
+}
+
 bool Service::getInited()
 {
     return m_inited;
@@ -65,6 +111,11 @@ bool Service::isInitedOrIniting()
     return m_inited || m_initing;
 }
 
+bool Service::getEventsActive() const
+{
+    return m_eventsActive;
+}
+
 bool Service::getBusy()
 {
     return m_busy;
@@ -103,20 +154,53 @@ QString Service::getDeviceFriendlyName() const
     return m_deviceFriendlyName;
 }
 
+QString Service::getDeviceHost() const
+{
+    return m_deviceHost;
+}
+
 void Service::handleApplicationStateChanged(Qt::ApplicationState state)
 {
     qDebug() << "State changed:" << state;
 }
 
+bool Service::isUiVisible()
+{
+    auto app = static_cast<QGuiApplication*>(QGuiApplication::instance());
+    return isUiVisible(app->applicationState());
+}
+
+bool Service::isUiVisible(Qt::ApplicationState state)
+{
+#ifdef SAILFISH
+    // Inactive means that only app cover is shown
+    return state == Qt::ApplicationActive;
+#else
+    return state == Qt::ApplicationActive || state == Qt::ApplicationInactive;
+#endif
+}
+
+void Service::applicationStateChanged(Qt::ApplicationState state)
+{
+    bool visible = isUiVisible(state);
+    if (m_uiVisible != visible) {
+        m_uiVisible = visible;
+        handleApplicationStateChanged(state);
+    }
+}
+
 void Service::deInit()
 {
     qDebug() << "Deiniting";
 
     setInited(false);
     m_initing = false;
+    m_eventsActive = false;
     timer(false);
+    m_resubscribeTimer.stop();
     m_deviceId.clear();
     m_deviceFriendlyName.clear();
+    setReporterDeviceId(QString());
     reset();
     setBusy(false);
 }
@@ -160,12 +244,20 @@ bool Service::init(const QString &deviceId)
     }
 
     timer(false);
+    m_resubscribeTimer.stop();
     setInited(false);
+    m_eventsActive = false;
 
     reset();
 
+    // Device id is set before init task is started, so it is valid
+    // for all actions done by the task
+    m_deviceId = deviceId;
+    m_deviceFriendlyName = QString::fromStdString(ddesc.friendlyName);
+    m_deviceHost = QUrl(QString::fromStdString(ddesc.URLBase)).host();
+
     setBusy(true);
-    startTask([this, ddesc, sdesc](){
+    startTask("init", TP_User, [this, deviceId, ddesc, sdesc](){
         qDebug() << "Initing task";
         m_initing = true;
 
@@ -177,8 +269,12 @@ bool Service::init(const QString &deviceId)
         if (!m_ser) {
             qWarning() << "Unable to create UPnP service";
         } else {
-            postInit();
+            // Reporter is installed before postInit so that initial event
+            // sent by device just after subscribing is not lost
+            setReporterDeviceId(deviceId);
+            m_subscribeTime = QDateTime::currentMSecsSinceEpoch();
             m_ser->installReporter(this);
+            postInit();
             setInited(true);
             m_initing = false;
         }
@@ -187,12 +283,15 @@ bool Service::init(const QString &deviceId)
         qDebug() << "Initing task done";
     });
 
-    m_deviceId = deviceId;
-    m_deviceFriendlyName = QString::fromStdString(ddesc.friendlyName);
-
     return true;
 }
 
+void Service::setReporterDeviceId(const QString &deviceId)
+{
+    QMutexLocker locker(&m_reporterMutex);
+    m_reporterDeviceId = deviceId;
+}
+
 void Service::reset()
 {
 }
@@ -205,6 +304,52 @@ void Service::postDeInit()
 {
 }
 
+void Service::postResubscribe()
+{
+}
+
+void Service::metaChanged(const QString &name, const UPnPClient::UPnPDirObject &meta)
+{
+    Q_UNUSED(name)
+    Q_UNUSED(meta)
+}
+
+void Service::handleSubscriptionLost()
+{
+    if (!m_inited) {
+        qDebug() << "Service is not inited, resubscribe not needed";
+        return;
+    }
+
+    if (!m_resubscribeTimer.isActive())
+        m_resubscribeTimer.start();
+}
+
+void Service::resubscribe()
+{
+    if (!m_inited || !m_ser) {
+        qWarning() << "Service is not inited";
+        return;
+    }
+
+    startTask("resubscribe", TP_Background, [this](){
+        if (!m_inited || !m_ser)
+            return;
+
+        qDebug() << "Resubscribing events";
+
+        m_subscribeTime = QDateTime::currentMSecsSinceEpoch();
+        if (m_ser->reSubscribe()) {
+            // Device sends initial event with all variables after
+            // subscribing, but we could have missed changes meanwhile
+            postResubscribe();
+        } else {
+            qWarning() << "Unable to resubscribe events, retrying later";
+            emit subscriptionLost();
+        }
+    });
+}
+
 void Service::timerEvent()
 {
 }
@@ -11,9 +11,11 @@
 #include <QObject>
 #include <QRunnable>
 #include <QTimer>
+#include <QMutex>
 #include <QString>
 #include <QVariant>
 #include <functional>
+#include <atomic>
 
 #include <libupnpp/control/avtransport.hxx>
 #include <libupnpp/control/service.hxx>
@@ -51,6 +53,10 @@ public:
     bool getBusy();
     QString getDeviceId() const;
     QString getDeviceFriendlyName() const;
+    QString getDeviceHost() const;
+    bool getEventsActive() const;
+    static bool isUiVisible();
+    static bool isUiVisible(Qt::ApplicationState state);
 
 signals:
     void initedChanged();
@@ -58,16 +64,30 @@ signals:
     void deviceIdChanged();
     void error(ErrorType code);
     void needTimer(bool start);
+    void subscriptionLost();
 
 protected slots:
     virtual void timerEvent();
     void timer(bool start);
+    void resubscribe();
+    void handleSubscriptionLost();
 
 protected:
     UPnPClient::Service* m_ser = nullptr;
     QTimer m_timer;
+    QTimer m_resubscribeTimer;
     bool m_initing = false;
 
+    // True when the device delivers events for our subscription,
+    // so its state variables don't need to be polled. Set from
+    // libupnp event thread.
+    std::atomic<bool> m_eventsActive{false};
+    // Every device sends initial event just after subscribing, even
+    // one which doesn't event later changes, so events received during
+    // initialEventTime after subscribing don't make events active
+    static const qint64 initialEventTime = 5000; // ms
+    std::atomic<qint64> m_subscribeTime{0};
+
     void setBusy(bool busy);
     void setInited(bool inited);
 
@@ -76,6 +96,8 @@ protected:
                                                    const UPnPClient::UPnPServiceDesc &sdesc) = 0;
     virtual void postInit();
     virtual void postDeInit();
+    virtual void postResubscribe();
+    virtual void metaChanged(const QString &name, const UPnPClient::UPnPDirObject &meta);
     virtual void reset();
     virtual std::string type() const = 0;
 
@@ -86,10 +108,21 @@ protected:
 private:
     QString m_deviceId;
     QString m_deviceFriendlyName;
+    QString m_deviceHost;
+    // Copy of device id for reporter callbacks done in task threads
+    QString m_reporterDeviceId;
+    QMutex m_reporterMutex;
     bool m_busy = false;
     bool m_inited = false;
+    bool m_uiVisible = true;
+    void applicationStateChanged(Qt::ApplicationState state);
     void changed(const char *nm, int value);
     void changed(const char *nm, const char *value);
+    void changed(const char *nm, UPnPClient::UPnPDirObject meta);
+    void autorenew_failed();
+    void action_done(const char *nm, int ms, int ret);
+    void handleEvent();
+    void setReporterDeviceId(const QString &deviceId);
 };
 
 #endif // SERVICE_H
@@ -1,3 +1,5 @@
+#include <QDebug>
+
 #include "services.h"
 
 Services* Services::m_instance = nullptr;
@@ -16,4 +18,60 @@ Services::Services(QObject* parent) :
     renderingControl(new RenderingControl(parent)),
     avTransport(new AVTransport(parent))
 {
+    // UI takes over renderer from its session
+    connect(avTransport.get(), &Service::initedChanged, this, [this]{
+        if (avTransport->getInited())
+            closeSession(avTransport->getDeviceId());
+    });
+}
+
+std::shared_ptr<RendererSession> Services::openSession(const QString &deviceId)
+{
+    if (deviceId.isEmpty()) {
+        qWarning() << "Device id is empty";
+        return nullptr;
+    }
+
+    if (avTransport->getDeviceId() == deviceId) {
+        qWarning() << "Device is controlled by UI, session not needed";
+        return nullptr;
+    }
+
+    auto it = m_sessions.find(deviceId);
+    if (it != m_sessions.end())
+        return it.value();
+
+    std::shared_ptr<RendererSession> session(new RendererSession(deviceId));
+    if (!session->init()) {
+        qWarning() << "Cannot init session for:" << deviceId;
+        return nullptr;
+    }
+
+    connect(session.get(), &RendererSession::closed, this, [this, deviceId]{
+        closeSession(deviceId);
+    }, Qt::QueuedConnection);
+
+    m_sessions.insert(deviceId, session);
+    qDebug() << "Session opened:" << deviceId << "sessions:" << m_sessions.size();
+    emit sessionsChanged();
+
+    return session;
+}
+
+void Services::closeSession(const QString &deviceId)
+{
+    if (m_sessions.remove(deviceId) > 0) {
+        qDebug() << "Session closed:" << deviceId;
+        emit sessionsChanged();
+    }
+}
+
+std::shared_ptr<RendererSession> Services::session(const QString &deviceId) const
+{
+    return m_sessions.value(deviceId);
+}
+
+QStringList Services::sessionIds() const
+{
+    return m_sessions.keys();
 }
@@ -2,11 +2,15 @@
 #define SERVICES_H
 
 #include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
 
 #include <memory>
 
 #include "renderingcontrol.h"
 #include "avtransport.h"
+#include "renderersession.h"
 
 class Services : public QObject
 {
@@ -14,11 +18,22 @@ class Services : public QObject
 public:
     static Services* instance(QObject *parent = nullptr);
 
+    // Renderer controlled by UI
     std::shared_ptr<RenderingControl> renderingControl;
     std::shared_ptr<AVTransport> avTransport;
 
+    // Additional renderers playing at the same time
+    std::shared_ptr<RendererSession> openSession(const QString &deviceId);
+    void closeSession(const QString &deviceId);
+    std::shared_ptr<RendererSession> session(const QString &deviceId) const;
+    QStringList sessionIds() const;
+
+signals:
+    void sessionsChanged();
+
 private:
     static Services* m_instance;
+    QHash<QString, std::shared_ptr<RendererSession>> m_sessions;
     explicit Services(QObject* parent = nullptr);
 };
 
@@ -114,14 +114,14 @@ QString Settings::getPlaylistDir()
 
 void Settings::asyncAddFavDevice(const QString &id)
 {
-    startTask([this, &id](){
+    startTask([this, id](){
         addFavDevice(id);
     });
 }
 
 void Settings::asyncRemoveFavDevice(const QString &id)
 {
-    startTask([this, &id](){
+    startTask([this, id](){
         removeFavDevice(id);
     });
 }
@@ -263,6 +263,21 @@ QStringList Settings::getLastPlaylist()
     return settings.value("lastplaylist").toStringList();
 }
 
+void Settings::setLibraryDirs(const QStringList& value)
+{
+    if (getLibraryDirs() != value) {
+        settings.setValue("librarydirs", value);
+        emit libraryDirsChanged();
+    }
+}
+
+QStringList Settings::getLibraryDirs()
+{
+    return settings.value("librarydirs", QStringList() <<
+                          QStandardPaths::writableLocation(
+                              QStandardPaths::MusicLocation)).toStringList();
+}
+
 void Settings::setShowAllDevices(bool value)
 {
     if (getShowAllDevices() != value) {
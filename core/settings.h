@@ -45,6 +45,7 @@ class Settings:
     Q_PROPERTY (int albumQueryType READ getAlbumQueryType WRITE setAlbumQueryType NOTIFY albumQueryTypeChanged)
     Q_PROPERTY (int albumRecType READ getRecQueryType WRITE setRecQueryType NOTIFY recQueryTypeChanged)
     Q_PROPERTY (int playMode READ getPlayMode WRITE setPlayMode NOTIFY playModeChanged)
+    Q_PROPERTY (QStringList libraryDirs READ getLibraryDirs WRITE setLibraryDirs NOTIFY libraryDirsChanged)
 public:
     static Settings* instance();
 
@@ -124,6 +125,9 @@ public:
     QString getPrefNetInf();
     void setPrefNetInf(const QString& value);
 
+    QStringList getLibraryDirs();
+    void setLibraryDirs(const QStringList& value);
+
     void setRemoteContentMode(int value);
     int getRemoteContentMode();
 
@@ -152,6 +156,7 @@ signals:
     void albumQueryTypeChanged();
     void recQueryTypeChanged();
     void playModeChanged();
+    void libraryDirsChanged();
 
 private:
     QSettings settings;
@@ -19,6 +19,7 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <memory>
+#include <algorithm>
 
 #include "somafmmodel.h"
 #include "utils.h"
@@ -43,7 +44,7 @@ bool SomafmModel::parseData()
         qDebug() << "Parsing Somafm channels";
         QDomDocument doc; QString error;
         if (doc.setContent(data, false, &error)) {
-            m_entries = doc.elementsByTagName("channel");
+            m_entries = sortedEntries(doc.elementsByTagName("channel"));
             return true;
         } else {
             qWarning() << "Parse error:" << error;
@@ -55,6 +56,30 @@ bool SomafmModel::parseData()
     return false;
 }
 
+// Entries are sorted once, so pages are parts of one sorted list
+QList<QDomElement> SomafmModel::sortedEntries(const QDomNodeList &nodes)
+{
+    QList<QPair<QString, QDomElement>> list;
+    int l = nodes.length();
+    for (int i = 0; i < l; ++i) {
+        auto entry = nodes.at(i).toElement();
+        if (!entry.isNull())
+            list << qMakePair(entry.elementsByTagName("title").at(0).toElement().text(), entry);
+    }
+
+    std::stable_sort(list.begin(), list.end(), [](const QPair<QString, QDomElement> &a,
+                                                  const QPair<QString, QDomElement> &b) {
+        return a.first.compare(b.first, Qt::CaseInsensitive) < 0;
+    });
+
+    QList<QDomElement> entries;
+    entries.reserve(list.size());
+    for (const auto &p : list)
+        entries << p.second;
+
+    return entries;
+}
+
 bool SomafmModel::isRefreshing()
 {
     return m_refreshing;
@@ -214,9 +239,11 @@ QList<ListItem*> SomafmModel::makeItems()
 
     auto filter = getFilter();
 
-    int l = filter.isEmpty() ? 50 : m_entries.length();
+    // Page key is the position of the next entry in the directory
+    auto after = pageKey();
+    int l = m_entries.length();
 
-    for (int i = 0; i < l; ++i) {
+    for (int i = after.isEmpty() ? 0 : after.first().toInt(); i < l; ++i) {
         auto entry = m_entries.at(i).toElement();
         if (!entry.isNull() && entry.hasAttribute("id")) {
             auto id = entry.attribute("id");
@@ -259,17 +286,13 @@ QList<ListItem*> SomafmModel::makeItems()
             }
         }
 
-        if (items.length() > 49)
+        if (items.length() >= pageSize) {
+            if (i + 1 < l)
+                setNextPageKey(QVariantList() << i + 1);
             break;
+        }
     }
 
-    // Sorting
-    std::sort(items.begin(), items.end(), [](ListItem *a, ListItem *b) {
-        auto aa = dynamic_cast<SomafmItem*>(a);
-        auto bb = dynamic_cast<SomafmItem*>(b);
-        return aa->name().compare(bb->name(), Qt::CaseInsensitive) < 0;
-    });
-
     return items;
 }
 
@@ -285,12 +308,11 @@ SomafmItem::SomafmItem(const QString &id,
                    const QString &description,
                    const QUrl &url,
 #ifdef SAILFISH
-                   const QUrl &icon,
+                   const QUrl &icon
 #else
-                   const QIcon &icon,
+                   const QIcon &icon
 #endif
-                   QObject *parent) :
-    SelectableItem(parent),
+                   ) :
     m_id(id),
     m_name(name),
     m_description(description),
@@ -19,6 +19,7 @@
 #include <QNetworkAccessManager>
 #include <QDomNodeList>
 #include <QDomElement>
+#include <QList>
 #include <memory>
 
 #ifdef DESKTOP
@@ -30,7 +31,6 @@
 
 class SomafmItem : public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         NameRole = Qt::DisplayRole,
@@ -42,17 +42,17 @@ public:
     };
 
 public:
-    SomafmItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    SomafmItem() {}
     explicit SomafmItem(const QString &id,
                       const QString &name,
                       const QString &description,
                       const QUrl &url,
 #ifdef SAILFISH
-                      const QUrl &icon,
+                      const QUrl &icon
 #else
-                      const QIcon &icon,
+                      const QIcon &icon
 #endif
-                      QObject *parent = nullptr);
+                      );
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
     inline QString id() const { return m_id; }
@@ -98,14 +98,16 @@ private:
     static const QString m_dirFilename;
     static const QString m_imageFilename;
     static const int httpTimeout = 100000;
+    static const int pageSize = 50;
 
     std::unique_ptr<QNetworkAccessManager> nam;
-    QDomNodeList m_entries;
+    QList<QDomElement> m_entries; // sorted by name
     QList<QPair<QString,QString>> m_imagesToDownload;  // <id, image URL>
     bool m_refreshing = false;
 
     QList<ListItem*> makeItems();
     bool parseData();
+    static QList<QDomElement> sortedEntries(const QDomNodeList &nodes);
     void downloadImages();
     void downloadImage();
     QString bestImage(const QDomElement& entry);
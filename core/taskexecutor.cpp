@@ -7,6 +7,7 @@
 
 #include <QDebug>
 #include <QThread>
+#include <QMutexLocker>
 
 #include "taskexecutor.h"
 
@@ -27,26 +28,108 @@ TaskExecutor::TaskExecutor(QObject* parent, int threadCount) :
 
 bool TaskExecutor::startTask(const std::function<void()> &job)
 {
-    if (m_pool.activeThreadCount() >= m_pool.maxThreadCount()) {
-        qWarning() << "Too many task. Droping new task";
-        return false;
+    return startTask(QString(), TP_Normal, job);
+}
+
+bool TaskExecutor::startTask(const QString &key, TaskPriority priority,
+                             const std::function<void()> &job)
+{
+    QMutexLocker locker(&m_queueMutex);
+
+    if (!key.isEmpty()) {
+        for (auto &task : m_queue) {
+            if (task.key == key) {
+                // Newer task makes queued one obsolete, e.g. seek
+                // to another position or next volume change
+                task.job = job;
+                if (task.priority < priority)
+                    task.priority = priority;
+                m_stats.coalesced++;
+                qDebug() << "Task coalesced:" << key;
+                return true;
+            }
+        }
     }
 
-    auto task = new Task(job);
-    task->setAutoDelete(true);
-    m_pool.start(task);
+    QueuedTask task;
+    task.key = key;
+    task.priority = priority;
+    task.job = job;
+    task.queued.start();
+    m_queue.append(task);
+
+    m_stats.depth = m_queue.size();
+    if (m_stats.depth > m_stats.maxDepth)
+        m_stats.maxDepth = m_stats.depth;
+
+    dispatch();
 
     return true;
 }
 
+void TaskExecutor::dispatch()
+{
+    // Queue mutex must be locked
+
+    while (m_running < m_pool.maxThreadCount() && !m_queue.isEmpty()) {
+        int next = 0;
+        for (int i = 1; i < m_queue.size(); ++i) {
+            if (m_queue.at(i).priority > m_queue.at(next).priority)
+                next = i;
+        }
+
+        auto task = m_queue.takeAt(next);
+        m_stats.depth = m_queue.size();
+        m_stats.lastWait = task.queued.elapsed();
+        if (m_stats.lastWait > m_stats.maxWait)
+            m_stats.maxWait = m_stats.lastWait;
+
+        if (m_stats.lastWait > 1000 || m_stats.depth > 0) {
+            qDebug() << "Task started:" << task.key
+                     << "wait:" << m_stats.lastWait
+                     << "queue depth:" << m_stats.depth;
+        }
+
+        ++m_running;
+
+        auto job = task.job;
+        auto runnable = new Task([this, job]{
+            job();
+            taskDone();
+        });
+        runnable->setAutoDelete(true);
+        m_pool.start(runnable);
+    }
+}
+
+void TaskExecutor::taskDone()
+{
+    QMutexLocker locker(&m_queueMutex);
+    --m_running;
+    dispatch();
+}
+
 void TaskExecutor::waitForDone()
 {
+    // Tasks that have not been started are dropped
+    m_queueMutex.lock();
+    m_queue.clear();
+    m_stats.depth = 0;
+    m_queueMutex.unlock();
+
     m_pool.waitForDone();
 }
 
 bool TaskExecutor::taskActive()
 {
-    return m_pool.activeThreadCount() > 0;
+    QMutexLocker locker(&m_queueMutex);
+    return m_running > 0 || !m_queue.isEmpty();
+}
+
+TaskExecutor::QueueStats TaskExecutor::queueStats()
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_stats;
 }
 
 void TaskExecutor::tsleep(int ms)
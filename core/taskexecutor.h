@@ -11,12 +11,32 @@
 #include <QRunnable>
 #include <QThreadPool>
 #include <QObject>
+#include <QString>
+#include <QMutex>
+#include <QList>
+#include <QElapsedTimer>
 
 #include <functional>
 
 class TaskExecutor
 {
 public:
+    // Higher priority tasks are started before lower ones,
+    // tasks with the same priority are started in order
+    enum TaskPriority {
+        TP_Background = 0,
+        TP_Normal,
+        TP_User
+    };
+
+    struct QueueStats {
+        int depth = 0;
+        int maxDepth = 0;
+        int coalesced = 0;
+        qint64 lastWait = 0; // ms
+        qint64 maxWait = 0; // ms
+    };
+
     class Task : public QRunnable
     {
     public:
@@ -30,14 +50,32 @@ public:
     TaskExecutor(QObject* parent = nullptr, int threadCount = 1);
 
     bool startTask(const std::function<void()> &job);
+    // Task replaces not yet started task with the same key
+    bool startTask(const QString &key, TaskPriority priority,
+                   const std::function<void()> &job);
     void waitForDone();
     bool taskActive();
+    QueueStats queueStats();
 
 protected:
     void tsleep(int ms = 500);
 
 private:
+    struct QueuedTask {
+        QString key;
+        TaskPriority priority;
+        std::function<void()> job;
+        QElapsedTimer queued;
+    };
+
     QThreadPool m_pool;
+    QMutex m_queueMutex;
+    QList<QueuedTask> m_queue;
+    int m_running = 0;
+    QueueStats m_stats;
+
+    void dispatch();
+    void taskDone();
 };
 
 #endif // TASKEXECUTOR_H
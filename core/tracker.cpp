@@ -20,6 +20,9 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
 
 Tracker* Tracker::m_instance = nullptr;
 
@@ -64,15 +67,74 @@ bool Tracker::query(const QString &query, bool emitSignal)
     m_dbusReplyData.clear();
     m_pipeData.clear();
 
+    bool ok = runQuery(query, [this](const QByteArray& rows) {
+        m_pipeData.append(rows);
+        return true;
+    }, CancelCheck(), &m_dbusReplyData);
+
+    if (!ok) {
+        emit queryError();
+        return false;
+    }
+
+    if (m_pipeData.isEmpty())
+        qWarning() << "No data received from pipe";
+
+    if (emitSignal)
+        emit queryFinished(m_dbusReplyData, m_pipeData);
+
+    return true;
+}
+
+bool Tracker::queryStream(const QString &query, const RowsHandler &handler,
+                          const CancelCheck &cancelled)
+{
+    return runQuery(query, [&handler](const QByteArray& rows) {
+        TrackerCursor cursor(QStringList(), rows);
+        return handler(cursor);
+    }, cancelled, nullptr);
+}
+
+int Tracker::completeRowsSize(const QByteArray &data)
+{
+    // Row layout: n_columns, types[n], offsets[n], data[last offset + 1]
+    const char* buf = data.constData();
+    const int size = data.size();
+    int idx = 0;
+
+    while (idx + 4 <= size) {
+        int n = *((const int*) (buf + idx));
+        if (n <= 0) {
+            qWarning() << "Invalid number of columns in Tracker result:" << n;
+            return idx;
+        }
+
+        int header = 4 + 8 * n;
+        if (idx + header > size)
+            break;
+
+        int last_offset = *((const int*) (buf + idx + header - 4));
+        int row_end = idx + header + last_offset + 1;
+        if (row_end > size)
+            break;
+
+        idx = row_end;
+    }
+
+    return idx;
+}
+
+bool Tracker::runQuery(const QString &query,
+                       const std::function<bool(const QByteArray& rows)> &handler,
+                       const CancelCheck &cancelled, QStringList *varNames)
+{
     if (m_tracker_inf == nullptr) {
         qWarning() << "Tracker Dbus interface is not created";
-        emit queryError();
         return false;
     }
 
     if (!m_tracker_inf->isValid()) {
         qWarning() << "Tracker Dbus interface is invalid";
-        emit queryError();
         return false;
     }
 
@@ -80,48 +142,84 @@ bool Tracker::query(const QString &query, bool emitSignal)
 
     if (!createUnixPipe(readFd, writeFd)) {
         qWarning() << "Cannot create Unix pipe";
-        emit queryError();
         return false;
     }
 
-    QDBusUnixFileDescriptor qfd(writeFd);
-    close(writeFd);
+    QDBusPendingReply<QStringList> reply;
 
-    auto reply = m_tracker_inf->Query(query, qfd);
+    {
+        QDBusUnixFileDescriptor qfd(writeFd);
+        close(writeFd);
+        reply = m_tracker_inf->Query(query, qfd);
+    } // our copy of write end is closed here, so EOF is received
+      // when Tracker finishes writing
 
-    reply.waitForFinished();
+    // Pipe is read while Tracker is still writing, so rows can be
+    // processed before whole result is ready
 
-    close(qfd.fileDescriptor());
+    QByteArray buf;
+    QByteArray chunk(pipeBufSize, Qt::Uninitialized);
+    bool aborted = false;
 
-    if (reply.isError()) {
-        auto error = reply.error();
-        qWarning() << "Dbus query failed:" << error.name() << error.message();
-        close(readFd);
-        emit queryError();
-        return false;
-    }
+    while (true) {
+        if (cancelled && cancelled()) {
+            qDebug() << "Tracker query cancelled";
+            aborted = true;
+            break;
+        }
 
-    m_dbusReplyData << reply.value();
+        pollfd pfd;
+        pfd.fd = readFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int ret = ::poll(&pfd, 1, pipePollTimeout);
+        if (ret == 0)
+            continue;
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            qWarning() << "Cannot poll pipe:" << strerror(errno);
+            break;
+        }
 
-    const int pipe_buf_len = 1024;
-    char pipe_buf[pipe_buf_len];
+        ssize_t bytes_read = read(readFd, chunk.data(), pipeBufSize);
+        if (bytes_read < 0 && errno == EINTR)
+            continue;
+        if (bytes_read <= 0)
+            break;
+
+        buf.append(chunk.constData(), int(bytes_read));
+
+        int size = completeRowsSize(buf);
+        if (size > 0) {
+            QByteArray rows = buf.left(size);
+            buf.remove(0, size);
+            if (!handler(rows)) {
+                aborted = true;
+                break;
+            }
+        }
+    }
 
-    ssize_t bytes_read;
+    close(readFd);
 
-    while ((bytes_read = read(readFd, &pipe_buf, pipe_buf_len)) > 0) {
-        //qDebug() << "Pipe bytes received:" << bytes_read;
-        m_pipeData.append(pipe_buf, bytes_read);
-    }
+    if (aborted) // Tracker gets EPIPE and stops query
+        return false;
 
-    //qDebug() << "Pipe last bytes_read: " << bytes_read;
+    if (!buf.isEmpty())
+        qWarning() << "Incomplete row in Tracker result:" << buf.size();
 
-    close(readFd);
+    reply.waitForFinished();
 
-    if (m_pipeData.isEmpty())
-        qWarning() << "No data received from pipe";
+    if (reply.isError()) {
+        auto error = reply.error();
+        qWarning() << "Dbus query failed:" << error.name() << error.message();
+        return false;
+    }
 
-    if (emitSignal)
-        emit queryFinished(m_dbusReplyData, m_pipeData);
+    if (varNames)
+        *varNames << reply.value();
 
     return true;
 }
@@ -13,17 +13,28 @@
 #include <QStringList>
 #include <QRegExp>
 #include <utility>
+#include <functional>
 
 #include "dbus_tracker_inf.h"
 
+class TrackerCursor;
+
 class Tracker :
         public QObject
 {
     Q_OBJECT
 
 public:
+    // Returns false to stop reading of the result
+    typedef std::function<bool(TrackerCursor& cursor)> RowsHandler;
+    typedef std::function<bool()> CancelCheck;
+
     static Tracker* instance(QObject *parent = nullptr);
     bool query(const QString& query, bool emitSignal = true);
+    // Result rows are passed to handler in parts as soon as they are
+    // received from pipe. Can be called from any thread.
+    bool queryStream(const QString& query, const RowsHandler& handler,
+                     const CancelCheck& cancelled = CancelCheck());
     std::pair<const QStringList&, const QByteArray&> getResult();
     QString genAlbumArtFile(const QString& albumName,
                             const QString& artistName);
@@ -34,6 +45,8 @@ signals:
 
 private:
     static Tracker* m_instance;
+    static const int pipeBufSize = 65536;
+    static const int pipePollTimeout = 100; // ms
 
     const QRegExp m_re1;
     const QRegExp m_re2;
@@ -51,6 +64,10 @@ private:
     QString genTrackerId(const QString& name);
 
     bool createUnixPipe(int& readFd, int& writeFd);
+    bool runQuery(const QString& query,
+                  const std::function<bool(const QByteArray& rows)>& handler,
+                  const CancelCheck& cancelled, QStringList* varNames);
+    static int completeRowsSize(const QByteArray& data);
 };
 
 #endif // TRACKER_H
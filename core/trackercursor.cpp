@@ -49,6 +49,14 @@ QVariant TrackerCursor::value(int column)
     }
 }
 
+QVariantList TrackerCursor::values()
+{
+    QVariantList list;
+    for (int i = 0; i < _n_columns; ++i)
+        list << value(i);
+    return list;
+}
+
 TrackerCursor::ValueType TrackerCursor::type(int column)
 {
     if (column >= _n_columns)
@@ -59,6 +67,10 @@ TrackerCursor::ValueType TrackerCursor::type(int column)
 
 QString TrackerCursor::name(int column)
 {
+    // names are not known when result is read in parts
+    if (column >= variable_names.size())
+        return QString();
+
     return variable_names.at(column);
 }
 
@@ -27,6 +27,7 @@ public:
     QString name(int column);
     ValueType type(int column);
     QVariant value(int column);
+    QVariantList values();
 
     bool next();
     void rewind();
@@ -14,6 +14,9 @@
 #include "trackmodel.h"
 #include "trackercursor.h"
 #include "utils.h"
+#ifdef DESKTOP
+#include "library.h"
+#endif
 
 const QString TrackModel::queryByAlbumTemplate =
       "SELECT ?song " \
@@ -30,7 +33,7 @@ const QString TrackModel::queryByAlbumTemplate =
       "FILTER regex(nie:title(?song), \"%2\", \"i\") " \
       "} " \
       "ORDER BY nmm:trackNumber(?song) " \
-      "LIMIT 50";
+      "LIMIT 50 OFFSET %3";
 
 const QString TrackModel::queryByArtistTemplate =
       "SELECT ?song " \
@@ -47,7 +50,9 @@ const QString TrackModel::queryByArtistTemplate =
       "FILTER regex(nie:title(?song), \"%2\", \"i\") " \
       "} " \
       "ORDER BY nie:title(nmm:musicAlbum(?song)) nmm:trackNumber(?song) " \
-      "LIMIT 50";
+      "LIMIT 50 OFFSET %3";
+
+const int TrackModel::queryLimit = 50;
 
 const QString TrackModel::queryByPlaylistTemplate =
         "SELECT nfo:hasMediaFileListEntry(?list) " \
@@ -65,20 +70,80 @@ const QString TrackModel::queryByEntriesTemplate =
 TrackModel::TrackModel(QObject *parent) :
     SelectableItemModel(new TrackItem, parent)
 {
+#ifdef DESKTOP
+    connect(Library::instance(), &Library::changed,
+            this, [this]{ updateModel(); });
+#endif
 }
 
 QList<ListItem*> TrackModel::makeItems()
 {
+    const QString type = metaObject()->className();
+    const QString filter = getFilter();
+    auto cache = QueryCache::instance();
+    const QVariantList after = pageKey();
+    QueryCache::Rows rows;
+
+#ifdef DESKTOP
+    QString key;
+
+    if (!m_albumId.isEmpty()) {
+        key = "library:album:" + m_albumId;
+    } else if (!m_artistId.isEmpty()) {
+        key = "library:artist:" + m_artistId;
+    } else if (!m_playlistId.isEmpty()) {
+        qWarning() << "Playlists are not supported by library";
+        return QList<ListItem*>();
+    } else {
+        qWarning() << "Id not defined";
+        return QList<ListItem*>();
+    }
+
+    // Only first page is cached
+    if (after.isEmpty() && cache->find(type, key, filter, rows)) {
+        setNextPageKey(nextPageKey(rows, after));
+        return makeItemsFromRows(rows);
+    }
+
+    int generation = cache->generation();
+
+    auto cancelled = [this]{ return isCancelled(); };
+    auto tracks = !m_albumId.isEmpty() ?
+                Library::instance()->tracksByAlbum(m_albumId.toLongLong(), filter,
+                                                   after, queryLimit, cancelled) :
+                Library::instance()->tracksByArtist(m_artistId.toLongLong(), filter,
+                                                    after, queryLimit, cancelled);
+    if (isCancelled())
+        return QList<ListItem*>();
+
+    for (const auto &track : tracks) {
+        rows << QVariantList{QString::number(track.id), track.title,
+                             track.artist, track.album,
+                             QUrl::fromLocalFile(track.path), track.number,
+                             track.length, track.mime};
+    }
+
+    if (after.isEmpty())
+        cache->insert(type, key, filter, generation, rows, false);
+
+    setNextPageKey(nextPageKey(rows, after));
+
+    return makeItemsFromRows(rows);
+#else
     auto tracker = Tracker::instance();
 
     QString query;
+    QString key; // query without filter
     TrackerTasks task;
+    const QString offset = QString::number(after.isEmpty() ? 0 : after.first().toInt());
 
     if (!m_albumId.isEmpty()) {
-        query = queryByAlbumTemplate.arg(m_albumId, getFilter());
+        query = queryByAlbumTemplate.arg(m_albumId, filter, offset);
+        key = "album:" + m_albumId;
         task = TaskAlbum;
     } else if (!m_artistId.isEmpty()) {
-        query = queryByArtistTemplate.arg(m_artistId, getFilter());
+        query = queryByArtistTemplate.arg(m_artistId, filter, offset);
+        key = "artist:" + m_artistId;
         task = TaskArtist;
     } else if (!m_playlistId.isEmpty()) {
         query = queryByPlaylistTemplate.arg(m_playlistId);
@@ -87,7 +152,39 @@ QList<ListItem*> TrackModel::makeItems()
         qWarning() << "Id not defined";
     }
 
-    if (!query.isEmpty()) {
+    if (!key.isEmpty()) {
+        // Only first page is cached
+        if (after.isEmpty() && cache->find(type, key, filter, rows)) {
+            setNextPageKey(nextPageKey(rows, after));
+            return makeItemsFromRows(rows);
+        }
+
+        int generation = cache->generation();
+
+        bool ok = tracker->queryStream(query, [this, &rows](TrackerCursor& cursor) {
+            QueryCache::Rows part;
+            while (cursor.next()) {
+                if (cursor.columnCount() != 8) {
+                    qWarning() << "Tracker reply is incorrect";
+                    return false;
+                }
+                part << cursor.values();
+            }
+
+            rows << part;
+            deliverItems(makeItemsFromRows(part));
+            return !isCancelled();
+        }, [this]{ return isCancelled(); });
+
+        if (ok) {
+            if (after.isEmpty())
+                cache->insert(type, key, filter, generation, rows,
+                              rows.size() < queryLimit, QList<int>() << 1);
+            setNextPageKey(nextPageKey(rows, after));
+        } else if (!isCancelled()) {
+            qWarning() << "Tracker query error";
+        }
+    } else if (!query.isEmpty()) {
         if (tracker->query(query, false)) {
             auto result = tracker->getResult();
             return processTrackerReply(task, result.first, result.second);
@@ -97,6 +194,48 @@ QList<ListItem*> TrackModel::makeItems()
     }
 
     return QList<ListItem*>();
+#endif
+}
+
+QVariantList TrackModel::nextPageKey(const QueryCache::Rows& rows,
+                                     const QVariantList& after)
+{
+    if (rows.size() < queryLimit)
+        return QVariantList(); // no more rows
+
+#ifdef DESKTOP
+    Q_UNUSED(after)
+    const auto &last = rows.last();
+    if (!m_albumId.isEmpty())
+        return QVariantList{last.at(5), last.at(0).toLongLong()};
+    return QVariantList{last.at(3), last.at(5), last.at(0).toLongLong()};
+#else
+    // Tracker results are paged with offset
+    int offset = after.isEmpty() ? 0 : after.first().toInt();
+    return QVariantList{offset + rows.size()};
+#endif
+}
+
+QList<ListItem*> TrackModel::makeItemsFromRows(const QueryCache::Rows& rows)
+{
+    QList<ListItem*> items;
+
+    for (const auto &row : rows) {
+        auto type = ContentServer::typeFromMime(row.at(7).toString());
+        items << new TrackItem(
+                     row.at(0).toString(), // id
+                     row.at(1).toString(),
+                     row.at(2).toString(),
+                     row.at(3).toString(),
+                     row.at(4).toUrl(), // url
+                     QUrl(), // icon
+                     type,
+                     row.at(5).toInt(),
+                     row.at(6).toInt()
+                     );
+    }
+
+    return items;
 }
 
 QList<ListItem*> TrackModel::processTrackerReply(
@@ -275,19 +414,31 @@ TrackItem::TrackItem(const QString &id,
                    const QUrl &icon,
                    ContentServer::Type type,
                    int number,
-                   int length,
-                   QObject *parent) :
-    SelectableItem(parent),
-    m_id(id),
-    m_title(title),
-    m_artist(artist),
-    m_album(album),
-    m_url(url),
-    m_icon(icon),
-    m_type(type),
-    m_number(number),
-    m_length(length)
+                   int length)
+{
+    setValue(IdRole, id);
+    setValue(TitleRole, title);
+    setValue(ArtistRole, artist);
+    setValue(AlbumRole, album);
+    setValue(UrlRole, url);
+    setValue(IconRole, icon);
+    setValue(TypeRole, type);
+    setValue(NumberRole, number);
+    setValue(LengthRole, length);
+}
+
+QList<RowStore::Column> TrackItem::columns() const
 {
+    return QList<RowStore::Column>()
+            << RowStore::Column{IdRole, RowStore::String}
+            << RowStore::Column{TitleRole, RowStore::String}
+            << RowStore::Column{ArtistRole, RowStore::String}
+            << RowStore::Column{AlbumRole, RowStore::String}
+            << RowStore::Column{UrlRole, RowStore::Url}
+            << RowStore::Column{IconRole, RowStore::Url}
+            << RowStore::Column{TypeRole, RowStore::Int}
+            << RowStore::Column{NumberRole, RowStore::Int}
+            << RowStore::Column{LengthRole, RowStore::Int};
 }
 
 QHash<int, QByteArray> TrackItem::roleNames() const
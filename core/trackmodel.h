@@ -20,10 +20,10 @@
 #include "contentserver.h"
 #include "listmodel.h"
 #include "itemmodel.h"
+#include "querycache.h"
 
 class TrackItem : public SelectableItem
 {
-    Q_OBJECT
 public:
     enum Roles {
         IdRole = Qt::UserRole,
@@ -39,7 +39,7 @@ public:
     };
 
 public:
-    TrackItem(QObject *parent = nullptr): SelectableItem(parent) {}
+    TrackItem() {}
     explicit TrackItem(const QString &id,
                       const QString &title,
                       const QString &artist,
@@ -48,30 +48,22 @@ public:
                       const QUrl &icon,
                       ContentServer::Type type,
                       int number,
-                      int length,
-                      QObject *parent = 0);
+                      int length);
     QVariant data(int role) const;
     QHash<int, QByteArray> roleNames() const;
-    inline QString id() const { return m_id; }
-    inline QString title() const { return m_title; }
-    inline QString artist() const { return m_artist; }
-    inline QString album() const { return m_album; }
-    inline QUrl url() const { return m_url; }
-    inline QUrl icon() const { return m_icon; }
-    inline ContentServer::Type type() const { return m_type; }
-    inline int number() const { return m_number; }
-    inline int length() const { return m_length; }
+    inline QString id() const { return value(IdRole).toString(); }
+    inline QString title() const { return value(TitleRole).toString(); }
+    inline QString artist() const { return value(ArtistRole).toString(); }
+    inline QString album() const { return value(AlbumRole).toString(); }
+    inline QUrl url() const { return value(UrlRole).toUrl(); }
+    inline QUrl icon() const { return value(IconRole).toUrl(); }
+    inline ContentServer::Type type() const {
+        return static_cast<ContentServer::Type>(value(TypeRole).toInt()); }
+    inline int number() const { return value(NumberRole).toInt(); }
+    inline int length() const { return value(LengthRole).toInt(); }
 
-private:
-    QString m_id;
-    QString m_title;
-    QString m_artist;
-    QString m_album;
-    QUrl m_url;
-    QUrl m_icon;
-    ContentServer::Type m_type = ContentServer::TypeUnknown;
-    int m_number = 0;
-    int m_length = 0;
+protected:
+    QList<RowStore::Column> columns() const;
 };
 
 class TrackModel : public SelectableItemModel
@@ -109,6 +101,7 @@ private:
     static const QString queryByArtistTemplate;
     static const QString queryByPlaylistTemplate;
     static const QString queryByEntriesTemplate;
+    static const int queryLimit;
 
     QString m_albumId;
     QString m_artistId;
@@ -119,6 +112,9 @@ private:
             TrackerTasks task,
             const QStringList& varNames,
             const QByteArray& data);
+    QVariantList nextPageKey(const QueryCache::Rows& rows,
+                             const QVariantList& after);
+    QList<ListItem*> makeItemsFromRows(const QueryCache::Rows& rows);
 };
 
 #endif // TRACKMODEL_H
@@ -21,10 +21,21 @@
 #include <QDir>
 #include <QUrlQuery>
 #include <QTime>
+#include <QMutexLocker>
+#include <QSocketNotifier>
+#include <QUdpSocket>
 #ifdef SAILFISH
 #include <QMetaObject>
 #endif
 
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
 #include "settings.h"
 #include "gpoddermodel.h"
 #include "services.h"
@@ -43,6 +54,103 @@ Utils* Utils::m_instance = nullptr;
 Utils::Utils(QObject *parent) : QObject(parent)
 {
     createCacheDir();
+
+    m_netTimer.setInterval(500);
+    m_netTimer.setSingleShot(true);
+    connect(&m_netTimer, &QTimer::timeout, this, &Utils::refreshNetworkIf);
+    connect(Settings::instance(), &Settings::prefNetInfChanged,
+            this, &Utils::refreshNetworkIf);
+
+    initNetlink();
+}
+
+void Utils::initNetlink()
+{
+#ifdef Q_OS_LINUX
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    NETLINK_ROUTE);
+    if (fd < 0) {
+        qWarning() << "Cannot open netlink socket";
+        return;
+    }
+
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa)) < 0) {
+        qWarning() << "Cannot bind netlink socket";
+        close(fd);
+        return;
+    }
+
+    m_netlinkFd = fd;
+    m_netlinkNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_netlinkNotifier, &QSocketNotifier::activated,
+            this, &Utils::handleNetlink);
+#endif
+}
+
+void Utils::handleNetlink()
+{
+#ifdef Q_OS_LINUX
+    char buf[8192];
+    bool changed = false;
+    ssize_t ret;
+
+    while ((ret = recv(m_netlinkFd, buf, sizeof(buf), 0)) > 0) {
+        int len = static_cast<int>(ret);
+        for (auto nh = reinterpret_cast<struct nlmsghdr*>(buf);
+             NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            switch (nh->nlmsg_type) {
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                changed = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    if (changed)
+        m_netTimer.start();
+#endif
+}
+
+void Utils::refreshNetworkIf()
+{
+    QString ifname, address;
+    bool ok = findNetworkIf(ifname, address);
+
+    // Change of not default interface (e.g. second LAN) matters as well,
+    // because renderers on that subnet use its address
+    auto entries = findNetEntries();
+    QSet<QString> addrs;
+    for (const auto &e : entries)
+        addrs.insert(e.ifname + '/' + e.ip.toString() + '/' +
+                     QString::number(e.prefix));
+
+    {
+        QMutexLocker locker(&m_netMutex);
+        m_netEntries = entries;
+        m_entriesCached = true;
+        m_hostIfs.clear();
+        if (m_netCached && ok == m_netOk &&
+                ifname == m_ifname && address == m_address &&
+                addrs == m_netAddrs)
+            return;
+        m_netOk = ok;
+        m_ifname = ifname;
+        m_address = address;
+        m_netAddrs = addrs;
+        m_netCached = true;
+    }
+
+    qDebug() << "Net interfaces changed:" << ok << ifname << address << addrs;
+    emit networkIfChanged();
 }
 
 Utils* Utils::instance(QObject *parent)
@@ -114,6 +222,141 @@ QStringList Utils::getNetworkIfs(bool onlyUp)
 }
 
 bool Utils::getNetworkIf(QString& ifname, QString& address)
+{
+    QMutexLocker locker(&m_netMutex);
+
+    // Without netlink there are no change notifications,
+    // so interface is searched every time
+    if (!m_netCached || m_netlinkFd < 0) {
+        m_netOk = findNetworkIf(m_ifname, m_address);
+        m_netCached = true;
+    }
+
+    if (m_netOk) {
+        ifname = m_ifname;
+        address = m_address;
+    }
+
+    return m_netOk;
+}
+
+bool Utils::getNetworkIfFor(const QString &host, QString &ifname,
+                            QString &address)
+{
+    QHostAddress ha(host);
+    if (ha.isNull() || ha.isLoopback())
+        return getNetworkIf(ifname, address);
+
+    {
+        QMutexLocker locker(&m_netMutex);
+
+        if (m_netlinkFd < 0) {
+            m_entriesCached = false;
+            m_hostIfs.clear();
+        }
+
+        auto it = m_hostIfs.constFind(host);
+        if (it != m_hostIfs.constEnd()) {
+            ifname = it.value().first;
+            address = it.value().second;
+            return true;
+        }
+
+        if (!m_entriesCached) {
+            m_netEntries = findNetEntries();
+            m_entriesCached = true;
+        }
+
+        auto prefNetInf = Settings::instance()->getPrefNetInf();
+        const NetEntry *found = nullptr;
+        for (const auto &e : m_netEntries) {
+            if (ha.isInSubnet(e.ip, e.prefix) &&
+                    (!found || e.ifname == prefNetInf)) {
+                found = &e;
+                if (e.ifname == prefNetInf)
+                    break;
+            }
+        }
+
+        if (found) {
+            ifname = found->ifname;
+            address = found->ip.toString();
+            m_hostIfs.insert(host, qMakePair(ifname, address));
+            qDebug() << "Net interface for" << host << "(subnet):" << ifname << address;
+            return true;
+        }
+    }
+
+    // Host is not on local subnet, so address is taken from route to host
+    QString raddr;
+    if (routeAddress(ha, raddr)) {
+        QMutexLocker locker(&m_netMutex);
+        for (const auto &e : m_netEntries) {
+            if (e.ip.toString() == raddr) {
+                ifname = e.ifname;
+                address = raddr;
+                m_hostIfs.insert(host, qMakePair(ifname, address));
+                qDebug() << "Net interface for" << host << "(route):" << ifname << address;
+                return true;
+            }
+        }
+    }
+
+    return getNetworkIf(ifname, address);
+}
+
+// Kernel picks source address of route when UDP socket is connected,
+// no packet is sent
+bool Utils::routeAddress(const QHostAddress &host, QString &address)
+{
+    QUdpSocket socket;
+    socket.connectToHost(host, 1900);
+    if (socket.state() != QAbstractSocket::ConnectedState &&
+            !socket.waitForConnected(100))
+        return false;
+
+    auto local = socket.localAddress();
+    if (local.isNull() || local.isLoopback())
+        return false;
+
+    address = local.toString();
+    return true;
+}
+
+QList<Utils::NetEntry> Utils::findNetEntries()
+{
+    QList<NetEntry> entries;
+
+    for (const auto &interface : QNetworkInterface::allInterfaces()) {
+        if (interface.isValid() &&
+            !interface.flags().testFlag(QNetworkInterface::IsLoopBack) &&
+            interface.flags().testFlag(QNetworkInterface::IsUp) &&
+            interface.flags().testFlag(QNetworkInterface::IsRunning)) {
+            for (const auto &a : interface.addressEntries()) {
+                auto ha = a.ip();
+                if ((ha.protocol() == QAbstractSocket::IPv4Protocol ||
+                     ha.protocol() == QAbstractSocket::IPv6Protocol) &&
+                        a.prefixLength() >= 0) {
+                    NetEntry e;
+                    e.ifname = interface.name();
+                    e.ip = ha;
+                    e.prefix = a.prefixLength();
+                    entries << e;
+                }
+            }
+        }
+    }
+
+    return entries;
+}
+
+bool Utils::hasNetworkAddress(const QString &address)
+{
+    QHostAddress ha(address);
+    return QNetworkInterface::allAddresses().contains(ha);
+}
+
+bool Utils::findNetworkIf(QString& ifname, QString& address)
 {
     auto ifList = QNetworkInterface::allInterfaces();
 
@@ -414,6 +657,14 @@ bool Utils::isUrlScreen(const QUrl &url)
 
 QUrl Utils::urlFromText(const QString &text, const QString &context)
 {
+    // absolute network URL, no need to check files
+    if (text.startsWith("http://", Qt::CaseInsensitive) ||
+        text.startsWith("https://", Qt::CaseInsensitive)) {
+        QUrl url(text);
+        if (Utils::isUrlValid(url))
+            return url;
+    }
+
     if (!context.isEmpty()) {
         // check if text is a relative file path
         QDir dir(context);
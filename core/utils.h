@@ -13,11 +13,20 @@
 #include <QObject>
 #include <QByteArray>
 #include <QStringList>
+#include <QMutex>
+#include <QTimer>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QHostAddress>
 #ifdef SAILFISH
 #include <QQuickItem>
 #include <notification.h>
 #endif
 
+class QSocketNotifier;
+
 class Utils : public QObject
 {
     Q_OBJECT
@@ -32,9 +41,14 @@ public:
 
     static Utils* instance(QObject *parent = nullptr);
 
+    // Returns cached interface, refreshed on netlink address changes
     bool getNetworkIf(QString &ifname, QString &address);
+    // Interface to reach given host: the one with host in its subnet,
+    // otherwise the one with route to host, otherwise default one
+    bool getNetworkIfFor(const QString &host, QString &ifname, QString &address);
     bool checkNetworkIf();
     QStringList getNetworkIfs(bool onlyUp = true);
+    bool hasNetworkAddress(const QString &address);
 #ifdef SAILFISH
     void setQmlRootItem(QQuickItem* rootItem);
     void activateWindow();
@@ -96,8 +110,37 @@ public:
     bool createCacheDir();
     bool createPlaylistDir();
 
+signals:
+    // Selected interface or its address has changed
+    void networkIfChanged();
+
+private slots:
+    void handleNetlink();
+    void refreshNetworkIf();
+
 private:
     static Utils* m_instance;
+    QMutex m_netMutex;
+    bool m_netCached = false;
+    bool m_netOk = false;
+    QString m_ifname;
+    QString m_address;
+    struct NetEntry {
+        QString ifname;
+        QHostAddress ip;
+        int prefix;
+    };
+    bool m_entriesCached = false;
+    QList<NetEntry> m_netEntries; // addresses of all usable interfaces
+    QSet<QString> m_netAddrs; // ifname/address/prefix of all usable interfaces
+    QHash<QString, QPair<QString, QString>> m_hostIfs; // host => (ifname, address)
+    int m_netlinkFd = -1;
+    QSocketNotifier* m_netlinkNotifier = nullptr;
+    QTimer m_netTimer; // collects burst of netlink messages
+    void initNetlink();
+    bool findNetworkIf(QString &ifname, QString &address);
+    QList<NetEntry> findNetEntries();
+    bool routeAddress(const QHostAddress &host, QString &address);
 #ifdef SAILFISH
     qint32 notifId = 0;
     //Notification notif;
@@ -658,6 +658,19 @@ void MainWindow::on_actionFiles_triggered()
     playlist->addItemPaths(paths);
 }
 
+void MainWindow::on_actionFolder_triggered()
+{
+    auto path = QFileDialog::getExistingDirectory(this,
+        tr("Select folder"),
+        QStandardPaths::standardLocations(QStandardPaths::HomeLocation).last());
+
+    if (path.isEmpty())
+        return;
+
+    auto playlist = PlaylistModel::instance();
+    playlist->addItemPaths(QStringList() << path);
+}
+
 void MainWindow::on_actionURL_triggered()
 {
     AddUrlDialog dialog(this);
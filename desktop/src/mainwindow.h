@@ -70,6 +70,7 @@ private slots:
     void on_deviceList_customContextMenuRequested(const QPoint &pos);
     void on_actionConnect_triggered();
     void on_actionFiles_triggered();
+    void on_actionFolder_triggered();
     void on_actionURL_triggered();
     void on_actionClear_triggered();
     void on_actionMic_triggered();
@@ -38,15 +38,44 @@ protected:
     virtual void StartElement(const XML_Char *name, const XML_Char **attrs)
     {
         //LOGDEB("LastchangeParser: begin " << name << endl);
+        const XML_Char *val = 0;
+        const XML_Char *channel = 0;
         for (int i = 0; attrs[i] != 0; i += 2) {
             //LOGDEB("    " << attrs[i] << " -> " << attrs[i+1] << endl);
             if (!strcmp("val", attrs[i])) {
-                m_props[name] = attrs[i+1];
+                val = attrs[i+1];
+            } else if (!strcmp("channel", attrs[i])) {
+                channel = attrs[i+1];
             }
         }
+
+        if (!strcmp("InstanceID", name)) {
+            // We only ever control instance 0. Values from other
+            // instances must not overwrite ours.
+            m_ignore = val && strcmp("0", val);
+            if (!m_ignore && val)
+                m_props[name] = val;
+            return;
+        }
+
+        if (m_ignore || !val)
+            return;
+
+        // Volume, Mute, etc. can be reported for every channel. Only the
+        // master one is meaningful for us.
+        if (channel && strcmp("Master", channel))
+            return;
+
+        m_props[name] = val;
+    }
+    virtual void EndElement(const XML_Char *name)
+    {
+        if (!strcmp("InstanceID", name))
+            m_ignore = false;
     }
 private:
     std::unordered_map<string, string>& m_props;
+    bool m_ignore{false};
 };
 
 
@@ -31,6 +31,9 @@ namespace UPnPClient {
  *        <Volume val="24"/>
  *      </InstanceID>
  *    </Event>
+ *
+ * Only values from InstanceID 0 are returned. For per-channel variables
+ * (Volume, Mute...) only the Master channel is kept.
  */
 extern bool decodeAVLastChange(const std::string& xml,
                                std::unordered_map<std::string, std::string>& props);
@@ -158,6 +158,7 @@ UPnPDeviceDesc::UPnPDeviceDesc(const string& url, const string& description)
     }
 
     XMLText = description;
+    descURL = url;
     
     ok = true;
     //cerr << "URLBase: [" << URLBase << "]" << endl;
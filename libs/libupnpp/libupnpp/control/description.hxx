@@ -141,6 +141,9 @@ public:
     std::string UDN;
     // Base for all relative URLs. e.g. http://192.168.4.4:49152/
     std::string URLBase;
+    // Location the description was retrieved from.
+    // e.g. http://192.168.4.4:49152/description.xml
+    std::string descURL;
     // Manufacturer: e.g. D-Link, PacketVideo ("manufacturer")
     std::string manufacturer;
     // Model name: e.g. MediaTomb, DNS-327L ("modelName")
@@ -211,6 +211,40 @@ void UPnPDeviceDirectory::delCallback(unsigned int idx)
     o_callbacks.erase(o_callbacks.begin() + idx);
 }
 
+// Functions to be called when devices go away.
+static vector<UPnPDeviceDirectory::LostVisitor> o_lostcallbacks;
+
+unsigned int UPnPDeviceDirectory::addLostCallback(
+    UPnPDeviceDirectory::LostVisitor v)
+{
+    std::unique_lock<std::mutex> lock(o_callbacks_mutex);
+    o_lostcallbacks.push_back(v);
+    return o_lostcallbacks.size() - 1;
+}
+
+void UPnPDeviceDirectory::delLostCallback(unsigned int idx)
+{
+    std::unique_lock<std::mutex> lock(o_callbacks_mutex);
+    if (idx >= o_lostcallbacks.size())
+        return;
+    o_lostcallbacks.erase(o_lostcallbacks.begin() + idx);
+}
+
+static void reportLost(const vector<UPnPDeviceDesc>& devices)
+{
+    if (devices.empty())
+        return;
+    std::unique_lock<std::mutex> lock(o_callbacks_mutex);
+    for (auto& cbp : o_lostcallbacks) {
+        for (auto& dev : devices) {
+            (cbp)(dev.UDN);
+            for (auto& it1 : dev.embedded) {
+                (cbp)(it1.UDN);
+            }
+        }
+    }
+}
+
 // Descriptor kept in the device pool for each device found on the network.
 class DeviceDescriptor {
 public:
@@ -256,13 +290,18 @@ void *UPnPDeviceDirectory::discoExplorer(void *)
 
         if (!tsk->alive) {
             // Device signals it is going off.
-            std::unique_lock<std::mutex> lock(o_pool.m_mutex);
-            auto it = o_pool.m_devices.find(tsk->deviceId);
-            if (it != o_pool.m_devices.end()) {
-                o_pool.m_devices.erase(it);
-                //LOGDEB("discoExplorer: delete " << tsk->deviceId.c_str() <<
-                // endl);
+            vector<UPnPDeviceDesc> lost;
+            {
+                std::unique_lock<std::mutex> lock(o_pool.m_mutex);
+                auto it = o_pool.m_devices.find(tsk->deviceId);
+                if (it != o_pool.m_devices.end()) {
+                    lost.push_back(it->second.device);
+                    o_pool.m_devices.erase(it);
+                    //LOGDEB("discoExplorer: delete " << tsk->deviceId.c_str() <<
+                    // endl);
+                }
             }
+            reportLost(lost);
         } else {
             // Update or insert the device
             DeviceDescriptor d(tsk->url, tsk->description,
@@ -306,6 +345,7 @@ void UPnPDeviceDirectory::expireDevices()
     std::unique_lock<std::mutex> lock(o_pool.m_mutex);
     auto now = std::chrono::steady_clock::now();
     bool didsomething = false;
+    vector<UPnPDeviceDesc> lost;
 
     for (auto it = o_pool.m_devices.begin(); it != o_pool.m_devices.end();) {
         LOGDEB1("Dev in pool: type: " << it->second.device.deviceType <<
@@ -313,12 +353,16 @@ void UPnPDeviceDirectory::expireDevices()
         if (now - it->second.last_seen > it->second.expires) {
             LOGDEB1("expireDevices: deleting " <<  it->first.c_str() << " " <<
                     it->second.device.friendlyName.c_str() << endl);
+            lost.push_back(it->second.device);
             it = o_pool.m_devices.erase(it);
             didsomething = true;
         } else {
             ++it;
         }
     }
+    lock.unlock();
+    reportLost(lost);
+
     // start a search if something changed or 5 S
     // elapsed. upnp-inspector uses a 2 S permanent loop (in
     // msearch.py, __init__()). This ought not to be necessary of
@@ -85,6 +85,15 @@ public:
     static unsigned int addCallback(Visitor v);
     static void delCallback(unsigned int idx);
 
+    typedef std::function<void (const std::string& UDN)> LostVisitor;
+
+    /** Set a callback to be called when devices leave the network, either
+     *  by sending byebye or by expiration. Called once per device,
+     *  including embedded ones.
+     */
+    static unsigned int addLostCallback(LostVisitor v);
+    static void delLostCallback(unsigned int idx);
+
     /** Find device by 'friendly name'.
      *
      * This will wait for the remaining duration of the search window if the 
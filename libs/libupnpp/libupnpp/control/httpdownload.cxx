@@ -23,9 +23,13 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
 #include <sys/types.h>
 
 #include <curl/curl.h>
+#include <upnp/upnp.h>
 
 #include "libupnpp/log.hxx"
 #include "libupnpp/control/httpdownload.hxx"
@@ -71,3 +75,140 @@ bool downloadUrlWithCurl(const string& url, string& out, long timeoutsecs)
 
     return ret;
 }
+
+// Idle handles are kept per host, each one holding its open
+// connection. A handle serves one request at a time, so requests to a
+// host are serialized on a connection, or spread over a few connections
+// when they run concurrently.
+static const size_t maxIdleHandles = 2;
+// Hosts closing kept-alive connections too often get a new connection
+// for every request
+static const int maxReuseFailures = 2;
+static std::mutex o_pool_mutex;
+static std::unordered_map<string, std::vector<CURL*> > o_idle;
+static std::unordered_map<string, int> o_reuse_failures;
+
+static string hostKey(const string& url)
+{
+    string::size_type pos = url.find("://");
+    pos = pos == string::npos ? 0 : pos + 3;
+    return url.substr(0, url.find('/', pos));
+}
+
+static CURL *takeHandle(const string& key, bool *reuse)
+{
+    std::unique_lock<std::mutex> lock(o_pool_mutex);
+    *reuse = o_reuse_failures[key] < maxReuseFailures;
+    std::vector<CURL*>& idle = o_idle[key];
+    if (!idle.empty()) {
+        CURL *curl = idle.back();
+        idle.pop_back();
+        return curl;
+    }
+    return curl_easy_init();
+}
+
+static void releaseHandle(const string& key, CURL *curl, bool keep)
+{
+    if (keep) {
+        std::unique_lock<std::mutex> lock(o_pool_mutex);
+        std::vector<CURL*>& idle = o_idle[key];
+        if (idle.size() < maxIdleHandles) {
+            idle.push_back(curl);
+            return;
+        }
+    }
+    curl_easy_cleanup(curl);
+}
+
+static int curlErrToUpnp(CURLcode res)
+{
+    switch (res) {
+    case CURLE_OPERATION_TIMEDOUT:
+        return UPNP_E_TIMEDOUT;
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+        return UPNP_E_SOCKET_CONNECT;
+    case CURLE_SEND_ERROR:
+        return UPNP_E_SOCKET_WRITE;
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+        return UPNP_E_SOCKET_READ;
+    case CURLE_URL_MALFORMAT:
+        return UPNP_E_INVALID_URL;
+    case CURLE_OUT_OF_MEMORY:
+        return UPNP_E_OUTOF_MEMORY;
+    default:
+        return UPNP_E_NETWORK_ERROR;
+    }
+}
+
+int postSoapWithCurl(const string& url, const string& soapaction,
+                     const string& body, string& out, long timeoutsecs)
+{
+    string key = hostKey(url);
+    bool reuse;
+    CURL *curl = takeHandle(key, &reuse);
+    if (!curl) {
+        LOGERR("postSoapWithCurl: curl_easy_init failed" << endl);
+        return UPNP_E_OUTOF_MEMORY;
+    }
+
+    struct curl_slist *headers = 0;
+    headers = curl_slist_append(headers,
+                                "Content-Type: text/xml; charset=\"utf-8\"");
+    headers = curl_slist_append(headers,
+                                ("SOAPACTION: \"" + soapaction + "\"").c_str());
+    // Some devices don't handle "100-continue"
+    headers = curl_slist_append(headers, "Expect:");
+
+    CURLcode res = CURLE_OK;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        out.clear();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutsecs);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+        curl_easy_setopt(curl, CURLOPT_POST, 1);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, long(body.size()));
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &out);
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, reuse ? 0L : 1L);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, attempt > 0 ? 1L : 0L);
+        res = curl_easy_perform(curl);
+        if (res == CURLE_OK)
+            break;
+
+        // Device may close kept-alive connection just when request is
+        // being sent. Nothing was received then, so request is sent again
+        // on a new connection. Other errors are not retried, because
+        // actions are not always idempotent.
+        long connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        if (connects != 0 ||
+            (res != CURLE_SEND_ERROR && res != CURLE_GOT_NOTHING))
+            break;
+
+        LOGINF("postSoapWithCurl: reused connection closed by " << key <<
+               ": " << curl_easy_strerror(res) << endl);
+        std::unique_lock<std::mutex> lock(o_pool_mutex);
+        o_reuse_failures[key]++;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, (struct curl_slist *)0);
+    curl_slist_free_all(headers);
+
+    if (res != CURLE_OK) {
+        LOGERR("postSoapWithCurl: curl_easy_perform(): " <<
+               curl_easy_strerror(res) << " for " << url << endl);
+        releaseHandle(key, curl, false);
+        return curlErrToUpnp(res);
+    }
+
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    releaseHandle(key, curl, reuse);
+
+    return int(code);
+}
@@ -23,4 +23,13 @@
 extern bool downloadUrlWithCurl(const std::string& url,
                                 std::string& out, long timeoutsecs);
 
+/** Send a SOAP action request. Connection is kept open and reused by the
+ * next request to the same host.
+ * @return HTTP status code or negative UPNP_E_XXX code on transport error.
+ */
+extern int postSoapWithCurl(const std::string& url,
+                            const std::string& soapaction,
+                            const std::string& body,
+                            std::string& out, long timeoutsecs);
+
 #endif /* _HTTPDOWNLOAD.H_X_INCLUDED_ */
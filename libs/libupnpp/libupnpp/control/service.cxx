@@ -22,10 +22,15 @@
 #include <upnp/upnp.h>                  // for Upnp_Event, UPNP_E_SUCCESS, etc
 #include <upnp/upnptools.h>             // for UpnpGetErrorMessage
 
+#include <string.h>                     // for strchr
+#include <stdlib.h>                     // for atoi
+
 #include <string>                       // for string, char_traits, etc
 #include <utility>                      // for pair
+#include <chrono>
 
 #include "libupnpp/control/description.hxx"  // for UPnPDeviceDesc, etc
+#include "libupnpp/control/httpdownload.hxx"
 #include "libupnpp/ixmlwrap.hxx"
 #include "libupnpp/log.hxx"             // for LOGDEB1, LOGINF, LOGERR, etc
 #include "libupnpp/upnpp_p.hxx"         // for caturl
@@ -64,6 +69,8 @@ public:
     std::string manufacturer;
     std::string modelName;
     Upnp_SID    SID; /* Subscription Id */
+    /* Kept so that we can subscribe again after losing the SID */
+    evtCBFunc   callback;
 };
 
 /** Registered callbacks for the service objects. The map is
@@ -74,6 +81,10 @@ public:
  * an event. */
 static std::unordered_map<std::string, evtCBFunc> o_calls;
 
+/** Same as above, for reporting lost subscriptions (renewal failure or
+ * expiry) to the object which owns the SID. */
+static std::unordered_map<std::string, std::function<void()>> o_lost;
+
 
 Service::Service(const UPnPDeviceDesc& devdesc,
                  const UPnPServiceDesc& servdesc)
@@ -198,6 +209,99 @@ void Service::installReporter(VarEventReporter* reporter)
     m->reporter = reporter;
 }
 
+// Local name of element, without namespace prefix
+static string localName(IXML_Node *node)
+{
+    const char *name = ixmlNode_getNodeName(node);
+    if (name == 0)
+        return string();
+    const char *colon = strchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+// First child element with given local name, or any when name is empty
+static IXML_Node *childElement(IXML_Node *node, const string& name)
+{
+    if (node == 0)
+        return 0;
+    for (IXML_Node *n = ixmlNode_getFirstChild(node); n != 0;
+         n = ixmlNode_getNextSibling(n)) {
+        if (ixmlNode_getNodeType(n) == eELEMENT_NODE &&
+            (name.empty() || localName(n) == name))
+            return n;
+    }
+    return 0;
+}
+
+// Sends action over persistent HTTP connection. Response is returned
+// the same way as by UpnpSendAction: document with the action response
+// element on success, or with the UPnPError element and its error code
+// on SOAP fault.
+static int sendAction(const string& actionURL, const string& serviceType,
+                      const string& actionName, IXML_Document *request,
+                      IXML_Document **response)
+{
+    DOMString act = ixmlPrintNode(ixmlNode_getFirstChild((IXML_Node*)request));
+    if (act == 0)
+        return UPNP_E_OUTOF_MEMORY;
+    string body =
+        "<?xml version=\"1.0\"?>\r\n"
+        "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+        "s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+        "<s:Body>" + string(act) + "</s:Body></s:Envelope>";
+    ixmlFreeDOMString(act);
+
+    string out;
+    int code = postSoapWithCurl(actionURL, serviceType + "#" + actionName,
+                                body, out, 30);
+    if (code < 0)
+        return code;
+    if (code != 200 && code != 500) {
+        LOGERR("Service::runAction: HTTP status " << code << endl);
+        return UPNP_E_BAD_RESPONSE;
+    }
+
+    IXML_Document *doc = 0;
+    if (ixmlParseBufferEx(out.c_str(), &doc) != IXML_SUCCESS) {
+        LOGERR("Service::runAction: cannot parse response" << endl);
+        return UPNP_E_BAD_RESPONSE;
+    }
+
+    IXML_Node *node = childElement(childElement(childElement(
+        (IXML_Node*)doc, "Envelope"), "Body"), "");
+    int ret = UPNP_E_SUCCESS;
+    if (node != 0 && localName(node) == "Fault") {
+        node = childElement(childElement(node, "detail"), "UPnPError");
+        ret = UPNP_E_BAD_RESPONSE;
+        IXML_Node *ecode = childElement(node, "errorCode");
+        if (ecode != 0) {
+            const char *val = ixmlNode_getNodeValue(ixmlNode_getFirstChild(ecode));
+            if (val != 0 && atoi(val) > 0)
+                ret = atoi(val);
+        }
+    } else if (code != 200) {
+        node = 0;
+    }
+
+    if (node == 0) {
+        LOGERR("Service::runAction: unexpected response: " << out << endl);
+        ixmlDocument_free(doc);
+        return UPNP_E_BAD_RESPONSE;
+    }
+
+    IXML_Node *imported = 0;
+    *response = ixmlDocument_createDocument();
+    if (*response == 0 ||
+        ixmlDocument_importNode(*response, node, 1, &imported) != IXML_SUCCESS ||
+        ixmlNode_appendChild((IXML_Node*)*response, imported) != IXML_SUCCESS) {
+        ixmlDocument_free(doc);
+        return UPNP_E_OUTOF_MEMORY;
+    }
+
+    ixmlDocument_free(doc);
+    return ret;
+}
+
 int Service::runAction(const SoapOutgoing& args, SoapIncoming& data)
 {
     LibUPnP* lib = LibUPnP::getLibUPnP();
@@ -205,7 +309,6 @@ int Service::runAction(const SoapOutgoing& args, SoapIncoming& data)
         LOGINF("Service::runAction: no lib" << endl);
         return UPNP_E_OUTOF_MEMORY;
     }
-    UpnpClient_Handle hdl = lib->getclh();
 
     IXML_Document *request(0);
     IXML_Document *response(0);
@@ -220,8 +323,14 @@ int Service::runAction(const SoapOutgoing& args, SoapIncoming& data)
            " serviceType " << m->serviceType <<
            " rqst: [" << ixmlwPrintDoc(request) << "]" << endl);
 
-    int ret = UpnpSendAction(hdl, m->actionURL.c_str(), m->serviceType.c_str(),
-                             0 /*devUDN*/, request, &response);
+    auto start = std::chrono::steady_clock::now();
+    int ret = sendAction(m->actionURL, m->serviceType, args.getName(),
+                         request, &response);
+    if (m->reporter) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        m->reporter->action_done(args.getName().c_str(), int(ms), ret);
+    }
 
     if (ret != UPNP_E_SUCCESS) {
         if (ret < 0) {
@@ -302,11 +411,28 @@ int Service::srvCB(Upnp_EventType et, void* vevp, void*)
     case UPNP_EVENT_RENEWAL_COMPLETE:
     case UPNP_EVENT_SUBSCRIBE_COMPLETE:
     case UPNP_EVENT_UNSUBSCRIBE_COMPLETE:
+    {
+        struct Upnp_Event_Subscribe *esp =
+            (struct Upnp_Event_Subscribe *)vevp;
+        (void)esp;
+        LOGDEB1("Service:srvCB: subs event: sid " << esp->Sid <<
+                " err " << esp->ErrCode << endl);
+        break;
+    }
+
     case UPNP_EVENT_AUTORENEWAL_FAILED:
+    case UPNP_EVENT_SUBSCRIPTION_EXPIRED:
     {
-        const char *ff = (const char *)vevp;
-        (void)ff;
-        LOGDEB1("Service:srvCB: subs event: " << ff << endl);
+        struct Upnp_Event_Subscribe *esp =
+            (struct Upnp_Event_Subscribe *)vevp;
+        LOGERR("Service:srvCB: subscription lost: " <<
+               LibUPnP::evTypeAsString(et) << " sid " << esp->Sid <<
+               " err " << esp->ErrCode << endl);
+        std::unordered_map<std::string, std::function<void()>>::iterator it =
+            o_lost.find(esp->Sid);
+        if (it != o_lost.end()) {
+            (it->second)();
+        }
         break;
     }
 
@@ -368,6 +494,7 @@ bool Service::initEvents()
     lib->registerHandler(UPNP_EVENT_SUBSCRIBE_COMPLETE, srvCB, 0);
     lib->registerHandler(UPNP_EVENT_UNSUBSCRIBE_COMPLETE, srvCB, 0);
     lib->registerHandler(UPNP_EVENT_AUTORENEWAL_FAILED, srvCB, 0);
+    lib->registerHandler(UPNP_EVENT_SUBSCRIPTION_EXPIRED, srvCB, 0);
     lib->registerHandler(UPNP_EVENT_RECEIVED, srvCB, 0);
     return true;
 }
@@ -421,11 +548,16 @@ bool Service::unSubscribe()
 
 void Service::registerCallback(evtCBFunc c)
 {
+    m->callback = c;
     if (!subscribe())
         return;
     std::unique_lock<std::mutex> lock(cblock);
     LOGDEB1("Service::registerCallback: " << m->SID << endl);
     o_calls[m->SID] = c;
+    o_lost[m->SID] = [this]() {
+        if (m->reporter)
+            m->reporter->autorenew_failed();
+    };
 }
 
 void Service::unregisterCallback()
@@ -435,34 +567,28 @@ void Service::unregisterCallback()
         unSubscribe();
         std::unique_lock<std::mutex> lock(cblock);
         o_calls.erase(m->SID);
+        o_lost.erase(m->SID);
         m->SID[0] = 0;
     }
 }
 
-#if 0
-void Service::reSubscribe()
+bool Service::isSubscribed() const
+{
+    return m && m->SID[0];
+}
+
+bool Service::reSubscribe()
 {
     LOGDEB("Service::reSubscribe()------------------------\n");
-    if (m->SID[0] == 0) {
-        LOGINF("Service::reSubscribe: no subscription (null SID)\n");
-        return;
-    }
-    evtCBFunc c;
-    {
-        std::unique_lock<std::mutex> lock(cblock);
-        std::unordered_map<std::string, evtCBFunc>::iterator it =
-            o_calls.find(m->SID);
-        if (it == o_calls.end()) {
-            LOGINF("Service::reSubscribe: no callback found for m->SID " <<
-                   m->SID << endl);
-            return;
-        }
-        c = it->second;
+    if (!m->callback) {
+        LOGINF("Service::reSubscribe: no callback registered\n");
+        return false;
     }
+    // Unsubscribing a lost subscription fails, this is expected
     unregisterCallback();
-    registerCallback(c);
+    registerCallback(m->callback);
+    return m->SID[0] != 0;
 }
-#endif
 
 template int Service::runSimpleAction<int>(string const&, string const&, int);
 template int Service::runSimpleGet<int>(string const&, string const&, int*);
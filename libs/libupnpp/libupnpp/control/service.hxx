@@ -60,6 +60,15 @@ public:
     virtual void changed(const char * /*nm*/, UPnPDirObject /*meta*/) {}
     // Used by ohplaylist. Not always needed
     virtual void changed(const char * /*nm*/, std::vector<int> /*ids*/) {}
+    // Called when the event subscription could not be renewed or has
+    // expired. No more events will be received until reSubscribe() is
+    // called. This is called from the libupnp event thread with the
+    // callback lock held, so reSubscribe() must not be called from here.
+    virtual void autorenew_failed() {}
+    // Called after each action with its round-trip time in milliseconds
+    // and result (UPNP_E_SUCCESS, negative libupnp error or UPnP error
+    // code). Runs in the thread which called the action.
+    virtual void action_done(const char * /*nm*/, int /*ms*/, int /*ret*/) {}
 };
 
 typedef
@@ -77,10 +86,16 @@ public:
 
     virtual ~Service();
 
-    // This can be useful to restart the subscription and get all the
-    // State variable values, in case we get the events before we are
-    // ready (e.g. before the connections are set in a qt app
-    // we'll do this next abi change virtual void reSubscribe();
+    /** Restart the subscription. This also makes the device send all
+     * its evented state variables again, which is useful if we got the
+     * initial event before we were ready (e.g. before the reporter is
+     * installed), or after the subscription was lost.
+     * @return false if the service is not subscribed or subscribing
+     *  again failed */
+    virtual bool reSubscribe();
+
+    /** True if we currently hold an event subscription */
+    bool isSubscribed() const;
 
     /* Re-init with new dev and serv desc */
     virtual bool reInit(const UPnPDeviceDesc& devdesc,